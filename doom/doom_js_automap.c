@@ -0,0 +1,203 @@
+/**
+ * OpenTUI automap bridge for doomgeneric
+ *
+ * Exports the automap's line list so JavaScript can draw it straight into
+ * terminal glyphs, instead of sampling the rasterized automap back down from
+ * the framebuffer (where thin lines vanish or alias).
+ *
+ * The classification mirrors AM_drawWalls in am_map.c, including what the
+ * iddt cheat reveals, and the view is the automap's own: its window, zoom
+ * and follow mode, so the engine's pan and zoom keys move both drawings.
+ */
+
+// Include DOOM headers first to define 'boolean' type before emscripten's
+// macros
+#include "doomdata.h"
+#include "doomstat.h"
+#include "m_fixed.h"
+#include "p_local.h"
+#include "r_state.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <emscripten.h>
+
+// Defined in am_map.c (made non-static by scripts/build-doom.sh)
+extern int cheating;
+extern int f_w;
+extern fixed_t m_x, m_y;
+extern fixed_t m_w, m_h;
+extern fixed_t scale_mtof;
+extern boolean followplayer;
+
+// Line kinds (same colour classes the rasterized automap uses)
+#define AM_LINE_WALL 0     // One-sided wall (red)
+#define AM_LINE_TELEPORT 1 // Teleporter line (dark red)
+#define AM_LINE_FLOOR 2    // Floor height change (brown)
+#define AM_LINE_CEILING 3  // Ceiling height change (yellow)
+#define AM_LINE_UNSEEN 4   // Not yet seen, revealed by the computer map (grey)
+#define AM_LINE_TWOSIDED 5 // No height change, shown by the iddt cheat (grey)
+
+// Buffer layout (int32):
+//   [0] line count
+//   [1] player x, [2] player y (map units)
+//   [3] player angle (BAM, reinterpret as unsigned)
+//   [4] view centre x, [5] view centre y (map units): the automap window's
+//       centre, or the player while it follows the player
+//   [6] scale_mtof: automap window pixels per map unit (16.16)
+//   [7] automap window width in pixels
+//   [8] iddt cheat level (2 shows things)
+//   [9] thing count
+//   then per line: x1, y1, x2, y2, kind
+//   then per thing: x, y, angle
+#define AM_HEADER_SIZE 10
+#define AM_LINE_STRIDE 5
+#define AM_THING_STRIDE 3
+
+static int32_t *line_buffer = NULL;
+static int buffer_capacity = 0; // int32 entries after the header
+
+static int ClassifyLine(line_t *line, boolean allmap) {
+  if (cheating || (line->flags & ML_MAPPED)) {
+    if ((line->flags & ML_DONTDRAW) && !cheating) {
+      return -1;
+    }
+
+    if (!line->backsector) {
+      return AM_LINE_WALL;
+    }
+
+    if (line->special == 39) {
+      // Teleporters
+      return AM_LINE_TELEPORT;
+    }
+
+    if (line->flags & ML_SECRET) {
+      // Secret doors look like plain walls
+      return AM_LINE_WALL;
+    }
+
+    if (line->backsector->floorheight != line->frontsector->floorheight) {
+      return AM_LINE_FLOOR;
+    }
+
+    if (line->backsector->ceilingheight != line->frontsector->ceilingheight) {
+      return AM_LINE_CEILING;
+    }
+
+    // Two-sided lines with no height change are only drawn when cheating
+    return cheating ? AM_LINE_TWOSIDED : -1;
+  }
+
+  if (allmap && !(line->flags & ML_DONTDRAW)) {
+    return AM_LINE_UNSEEN;
+  }
+
+  return -1;
+}
+
+// Whether the automap is currently being displayed
+EMSCRIPTEN_KEEPALIVE
+int DG_IsAutomapActive(void) {
+  return gamestate == GS_LEVEL && automapactive;
+}
+
+// Things the iddt cheat draws (AM_drawThings): every mobj in every sector
+static int CountThings(void) {
+  int count = 0;
+  int i;
+
+  for (i = 0; i < numsectors; i++) {
+    mobj_t *mo;
+    for (mo = sectors[i].thinglist; mo; mo = mo->snext) {
+      count++;
+    }
+  }
+  return count;
+}
+
+// Fill and return the automap line buffer for the current frame
+EMSCRIPTEN_KEEPALIVE
+int32_t *DG_GetAutomapLines(void) {
+  player_t *plr = &players[displayplayer];
+  boolean allmap;
+  int32_t *out;
+  int count = 0;
+  int things = 0;
+  int needed;
+  int i;
+
+  if (DG_IsAutomapActive() && cheating == 2) {
+    things = CountThings();
+  }
+  needed = numlines * AM_LINE_STRIDE + things * AM_THING_STRIDE;
+
+  if (needed > buffer_capacity || !line_buffer) {
+    int32_t *grown = realloc(line_buffer, (AM_HEADER_SIZE + needed) * sizeof(int32_t));
+    if (!grown) {
+      if (line_buffer) {
+        line_buffer[0] = 0;
+        line_buffer[9] = 0;
+      }
+      return line_buffer;
+    }
+    line_buffer = grown;
+    buffer_capacity = needed;
+  }
+
+  line_buffer[0] = 0;
+  line_buffer[9] = 0;
+
+  if (!DG_IsAutomapActive() || !plr->mo) {
+    return line_buffer;
+  }
+
+  allmap = plr->powers[pw_allmap] != 0;
+  out = line_buffer + AM_HEADER_SIZE;
+
+  for (i = 0; i < numlines; i++) {
+    line_t *line = &lines[i];
+    int kind = ClassifyLine(line, allmap);
+
+    if (kind < 0) {
+      continue;
+    }
+
+    *out++ = line->v1->x >> FRACBITS;
+    *out++ = line->v1->y >> FRACBITS;
+    *out++ = line->v2->x >> FRACBITS;
+    *out++ = line->v2->y >> FRACBITS;
+    *out++ = kind;
+    count++;
+  }
+
+  if (things > 0) {
+    for (i = 0; i < numsectors; i++) {
+      mobj_t *mo;
+      for (mo = sectors[i].thinglist; mo; mo = mo->snext) {
+        *out++ = mo->x >> FRACBITS;
+        *out++ = mo->y >> FRACBITS;
+        *out++ = (int32_t)mo->angle;
+      }
+    }
+  }
+
+  line_buffer[0] = count;
+  line_buffer[1] = plr->mo->x >> FRACBITS;
+  line_buffer[2] = plr->mo->y >> FRACBITS;
+  line_buffer[3] = (int32_t)plr->mo->angle;
+  if (followplayer) {
+    line_buffer[4] = line_buffer[1];
+    line_buffer[5] = line_buffer[2];
+  } else {
+    line_buffer[4] = (m_x + m_w / 2) >> FRACBITS;
+    line_buffer[5] = (m_y + m_h / 2) >> FRACBITS;
+  }
+  line_buffer[6] = scale_mtof;
+  line_buffer[7] = f_w;
+  line_buffer[8] = cheating;
+  line_buffer[9] = things;
+
+  return line_buffer;
+}
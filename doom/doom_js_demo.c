@@ -0,0 +1,67 @@
+/**
+ * OpenTUI demo bridge for doomgeneric
+ *
+ * Exposes the demo that g_game.c records with -record, so JavaScript can
+ * save the inputs of a session at any moment (not only when DOOM quits),
+ * together with the game tic they belong to, and the result of a timedemo.
+ */
+
+// Include DOOM headers first to define 'boolean' type before emscripten's
+// macros
+#include "doomstat.h"
+#include "i_system.h"
+
+#include "doom_js_demo.h"
+
+#include <stdint.h>
+
+#include <emscripten.h>
+
+// Defined in g_game.c
+extern byte *demobuffer;
+extern byte *demo_p;
+extern int vanilla_demo_limit;
+
+// Demo state layout, read by src/doom-engine.ts as an Int32Array
+typedef struct {
+  int32_t gametic;
+  int32_t recording;
+  int32_t playback;
+  int32_t buffer; // Pointer to the demo recorded so far, 0 if none
+  int32_t length; // Bytes recorded so far (without the end marker)
+  int32_t timed; // 1 once a -timedemo run has ended
+  int32_t timed_gametics;
+  int32_t timed_realtics;
+} dg_demo_state_t;
+
+static dg_demo_state_t demo_state;
+
+EMSCRIPTEN_KEEPALIVE
+int32_t *DG_GetDemoState(void) {
+  demo_state.gametic = gametic;
+  demo_state.recording = demorecording;
+  demo_state.playback = demoplayback;
+  if (demorecording && demobuffer != NULL) {
+    demo_state.buffer = (int32_t)(intptr_t)demobuffer;
+    demo_state.length = (int32_t)(demo_p - demobuffer);
+  } else {
+    demo_state.buffer = 0;
+    demo_state.length = 0;
+  }
+  return (int32_t *)&demo_state;
+}
+
+// Called by G_CheckDemoStatus (patched by build-doom.sh) when a timedemo
+// ends, in place of the I_Error that reports it in vanilla: the result is
+// kept for DG_GetDemoState and DOOM quits normally
+void DG_TimeDemoDone(int gametics, int realtics) {
+  demo_state.timed = 1;
+  demo_state.timed_gametics = gametics;
+  demo_state.timed_realtics = realtics;
+  I_Quit();
+}
+
+// Grow the demo buffer as needed instead of ending the recording when the
+// vanilla size limit is reached
+EMSCRIPTEN_KEEPALIVE
+void DG_SetDemoLimit(int enabled) { vanilla_demo_limit = enabled; }
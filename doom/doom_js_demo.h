@@ -0,0 +1,15 @@
+/**
+ * OpenTUI timedemo hook for doomgeneric
+ *
+ * scripts/build-doom.sh makes G_CheckDemoStatus (g_game.c) end a timedemo
+ * through DG_TimeDemoDone instead of I_Error, so the result reaches
+ * JavaScript as numbers and not as an error message.
+ */
+
+#ifndef DOOM_JS_DEMO_H
+#define DOOM_JS_DEMO_H
+
+// Keeps the timedemo result for DG_GetDemoState and quits
+void DG_TimeDemoDone(int gametics, int realtics);
+
+#endif
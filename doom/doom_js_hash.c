@@ -0,0 +1,277 @@
+/**
+ * OpenTUI state hash for doomgeneric
+ *
+ * A fast hash of the playsim state that decides demo sync: every map
+ * object, every sector and the movers acting on it, the players and the RNG
+ * index. Compared tic by tic
+ * between two builds (scripts/desync-check.ts), the first difference
+ * shows where an optimization broke vanilla compatibility, and the part
+ * hashes say which part of the state diverged.
+ */
+
+// Include DOOM headers first to define 'boolean' type before emscripten's
+// macros
+#include "d_player.h"
+#include "doomstat.h"
+#include "info.h"
+#include "p_local.h"
+#include "p_spec.h"
+#include "r_state.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <emscripten.h>
+
+// Defined in m_random.c
+extern int prndindex;
+
+// Hash layout, read by src/doom-engine.ts as a Uint32Array
+typedef struct {
+  uint32_t total;
+  uint32_t mobjs;
+  uint32_t sectors;
+  uint32_t players;
+  uint32_t rng;
+  uint32_t mobjcount;
+} dg_state_hash_t;
+
+static dg_state_hash_t state_hash;
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+// FNV-1a over whole 32-bit words: enough to spot any change, cheap enough
+// to run every tic
+static inline uint32_t Mix(uint32_t hash, int32_t value) {
+  return (hash ^ (uint32_t)value) * FNV_PRIME;
+}
+
+// Every thinker by address, sorted, so a pointer hashes as the thinker's
+// place in the thinker list: the same in both builds, unlike the address
+typedef struct {
+  const thinker_t *thinker;
+  int32_t index;
+} thinker_ref_t;
+
+static thinker_ref_t *thinker_refs = NULL;
+static int thinker_ref_count = 0;
+static int thinker_ref_capacity = 0;
+
+static int CompareThinkerRefs(const void *a, const void *b) {
+  uintptr_t left = (uintptr_t)((const thinker_ref_t *)a)->thinker;
+  uintptr_t right = (uintptr_t)((const thinker_ref_t *)b)->thinker;
+  return left < right ? -1 : left > right;
+}
+
+// If the table cannot grow, every pointer hashes as not in the list
+static void IndexThinkers(void) {
+  thinker_t *th;
+  int count = 0;
+
+  for (th = thinkercap.next; th != &thinkercap; th = th->next) {
+    count++;
+  }
+
+  if (count > thinker_ref_capacity) {
+    thinker_ref_t *grown = realloc(thinker_refs, count * sizeof(*thinker_refs));
+    if (!grown) {
+      thinker_ref_count = 0;
+      return;
+    }
+    thinker_refs = grown;
+    thinker_ref_capacity = count;
+  }
+
+  thinker_ref_count = 0;
+  for (th = thinkercap.next; th != &thinkercap; th = th->next) {
+    thinker_refs[thinker_ref_count].thinker = th;
+    thinker_refs[thinker_ref_count].index = thinker_ref_count;
+    thinker_ref_count++;
+  }
+  qsort(thinker_refs, thinker_ref_count, sizeof(*thinker_refs), CompareThinkerRefs);
+}
+
+// Place of a thinker in the thinker list: -1 for NULL, -2 if it is not in
+// the list (a removed mobj still held as a target)
+static int32_t ThinkerIndex(const void *thinker) {
+  int low = 0;
+  int high = thinker_ref_count - 1;
+
+  if (!thinker) return -1;
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    uintptr_t at = (uintptr_t)thinker_refs[mid].thinker;
+    if (at == (uintptr_t)thinker) return thinker_refs[mid].index;
+    if (at < (uintptr_t)thinker) {
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return -2;
+}
+
+static int32_t SectorIndex(const sector_t *sector) {
+  return sector ? (int32_t)(sector - sectors) : -1;
+}
+
+static uint32_t HashMobj(uint32_t hash, const mobj_t *mo) {
+  hash = Mix(hash, mo->type);
+  hash = Mix(hash, mo->x);
+  hash = Mix(hash, mo->y);
+  hash = Mix(hash, mo->z);
+  hash = Mix(hash, (int32_t)mo->angle);
+  hash = Mix(hash, mo->momx);
+  hash = Mix(hash, mo->momy);
+  hash = Mix(hash, mo->momz);
+  hash = Mix(hash, mo->floorz);
+  hash = Mix(hash, mo->ceilingz);
+  hash = Mix(hash, mo->health);
+  hash = Mix(hash, mo->flags);
+  hash = Mix(hash, mo->tics);
+  hash = Mix(hash, mo->state ? (int32_t)(mo->state - states) : -1);
+  hash = Mix(hash, mo->movedir);
+  hash = Mix(hash, mo->movecount);
+  hash = Mix(hash, mo->reactiontime);
+  hash = Mix(hash, mo->threshold);
+  hash = Mix(hash, mo->lastlook);
+  hash = Mix(hash, ThinkerIndex(mo->target));
+  hash = Mix(hash, ThinkerIndex(mo->tracer));
+  return hash;
+}
+
+// Floors, ceilings, doors and platforms: their counters and speeds decide
+// where the sector is next tic. Lights only change lightlevel, hashed with
+// the sector.
+static uint32_t HashMover(uint32_t hash, const thinker_t *th) {
+  if (th->function.acp1 == (actionf_p1)T_MoveFloor) {
+    const floormove_t *floor = (const floormove_t *)th;
+    hash = Mix(hash, 1);
+    hash = Mix(hash, SectorIndex(floor->sector));
+    hash = Mix(hash, floor->type);
+    hash = Mix(hash, floor->crush);
+    hash = Mix(hash, floor->direction);
+    hash = Mix(hash, floor->newspecial);
+    hash = Mix(hash, floor->texture);
+    hash = Mix(hash, floor->floordestheight);
+    hash = Mix(hash, floor->speed);
+  } else if (th->function.acp1 == (actionf_p1)T_MoveCeiling) {
+    const ceiling_t *ceiling = (const ceiling_t *)th;
+    hash = Mix(hash, 2);
+    hash = Mix(hash, SectorIndex(ceiling->sector));
+    hash = Mix(hash, ceiling->type);
+    hash = Mix(hash, ceiling->bottomheight);
+    hash = Mix(hash, ceiling->topheight);
+    hash = Mix(hash, ceiling->speed);
+    hash = Mix(hash, ceiling->crush);
+    hash = Mix(hash, ceiling->direction);
+    hash = Mix(hash, ceiling->tag);
+    hash = Mix(hash, ceiling->olddirection);
+  } else if (th->function.acp1 == (actionf_p1)T_VerticalDoor) {
+    const vldoor_t *door = (const vldoor_t *)th;
+    hash = Mix(hash, 3);
+    hash = Mix(hash, SectorIndex(door->sector));
+    hash = Mix(hash, door->type);
+    hash = Mix(hash, door->topheight);
+    hash = Mix(hash, door->speed);
+    hash = Mix(hash, door->direction);
+    hash = Mix(hash, door->topwait);
+    hash = Mix(hash, door->topcountdown);
+  } else if (th->function.acp1 == (actionf_p1)T_PlatRaise) {
+    const plat_t *plat = (const plat_t *)th;
+    hash = Mix(hash, 4);
+    hash = Mix(hash, SectorIndex(plat->sector));
+    hash = Mix(hash, plat->type);
+    hash = Mix(hash, plat->speed);
+    hash = Mix(hash, plat->low);
+    hash = Mix(hash, plat->high);
+    hash = Mix(hash, plat->wait);
+    hash = Mix(hash, plat->count);
+    hash = Mix(hash, plat->status);
+    hash = Mix(hash, plat->oldstatus);
+    hash = Mix(hash, plat->crush);
+    hash = Mix(hash, plat->tag);
+  }
+  return hash;
+}
+
+static uint32_t HashPlayer(uint32_t hash, const player_t *plr) {
+  int i;
+
+  hash = Mix(hash, plr->playerstate);
+  hash = Mix(hash, plr->health);
+  hash = Mix(hash, plr->armorpoints);
+  hash = Mix(hash, plr->armortype);
+  hash = Mix(hash, plr->readyweapon);
+  hash = Mix(hash, plr->pendingweapon);
+  hash = Mix(hash, plr->viewz);
+  hash = Mix(hash, plr->viewheight);
+  hash = Mix(hash, plr->deltaviewheight);
+  hash = Mix(hash, plr->bob);
+  hash = Mix(hash, plr->refire);
+  hash = Mix(hash, plr->killcount);
+  hash = Mix(hash, plr->itemcount);
+  hash = Mix(hash, plr->secretcount);
+  for (i = 0; i < NUMAMMO; i++) {
+    hash = Mix(hash, plr->ammo[i]);
+  }
+  for (i = 0; i < NUMPOWERS; i++) {
+    hash = Mix(hash, plr->powers[i]);
+  }
+  return hash;
+}
+
+// Hash the current playsim state and return the hashes
+EMSCRIPTEN_KEEPALIVE
+dg_state_hash_t *DG_GetStateHash(void) {
+  thinker_t *th;
+  uint32_t mobjs = FNV_OFFSET;
+  uint32_t sector_hash = FNV_OFFSET;
+  uint32_t player_hash = FNV_OFFSET;
+  uint32_t count = 0;
+  uint32_t total;
+  int i;
+
+  if (gamestate == GS_LEVEL) {
+    IndexThinkers();
+
+    // Thinker order is part of the state: it decides who acts first
+    for (th = thinkercap.next; th != &thinkercap; th = th->next) {
+      if (th->function.acp1 == (actionf_p1)P_MobjThinker) {
+        mobjs = HashMobj(mobjs, (const mobj_t *)th);
+        count++;
+      } else {
+        sector_hash = HashMover(sector_hash, th);
+      }
+    }
+
+    for (i = 0; i < numsectors; i++) {
+      sector_hash = Mix(sector_hash, sectors[i].floorheight);
+      sector_hash = Mix(sector_hash, sectors[i].ceilingheight);
+      sector_hash = Mix(sector_hash, sectors[i].lightlevel);
+      sector_hash = Mix(sector_hash, sectors[i].special);
+      sector_hash = Mix(sector_hash, ThinkerIndex(sectors[i].specialdata));
+    }
+  }
+
+  for (i = 0; i < MAXPLAYERS; i++) {
+    if (playeringame[i]) {
+      player_hash = HashPlayer(Mix(player_hash, i), &players[i]);
+    }
+  }
+
+  state_hash.mobjs = mobjs;
+  state_hash.sectors = sector_hash;
+  state_hash.players = player_hash;
+  state_hash.rng = (uint32_t)prndindex;
+  state_hash.mobjcount = count;
+
+  total = Mix(FNV_OFFSET, gamestate);
+  total = Mix(total, leveltime);
+  total = Mix(total, mobjs);
+  total = Mix(total, sector_hash);
+  total = Mix(total, player_hash);
+  state_hash.total = Mix(total, prndindex);
+  return &state_hash;
+}
@@ -0,0 +1,169 @@
+/**
+ * OpenTUI HUD bridge for doomgeneric
+ *
+ * Exports the status bar and hu_stuff message state so JavaScript can show
+ * it as real terminal text, instead of sampling the rasterized status bar
+ * down to half-block cells.
+ *
+ * In text HUD mode the view is kept full screen (no status bar), and
+ * HU_Ticker (patched by scripts/build-doom.sh) hands the player's messages
+ * here instead of drawing them; a copy numbered in sequence is kept for
+ * JavaScript. The player's showMessages setting (F8) is left alone and
+ * still decides which messages are shown.
+ */
+
+// Include DOOM headers first to define 'boolean' type before emscripten's
+// macros
+#include "d_items.h"
+#include "doomstat.h"
+#include "r_main.h"
+
+#include "doom_js_hud.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <emscripten.h>
+
+// Defined in m_menu.c
+extern int screenblocks;
+extern int detailLevel;
+extern int showMessages;
+
+// Defined in hu_stuff.c
+extern boolean message_dontfuckwithme;
+
+// Full screen view without the status bar
+#define FULLSCREEN_BLOCKS 11
+
+#define MESSAGE_SIZE 128
+
+// HUD state layout, read by src/doom-hud.ts as an Int32Array
+typedef struct {
+  int32_t active; // In a level with a live player object
+  int32_t health;
+  int32_t armor;
+  int32_t armortype;
+  int32_t readyweapon;
+  int32_t readyammo; // -1 if the weapon uses no ammo
+  int32_t ammo[NUMAMMO];
+  int32_t maxammo[NUMAMMO];
+  int32_t cards[NUMCARDS];
+  int32_t weaponowned[NUMWEAPONS];
+  int32_t kills;
+  int32_t totalkills;
+  int32_t items;
+  int32_t totalitems;
+  int32_t secrets;
+  int32_t totalsecrets;
+  int32_t message;     // Pointer to the latest message, 0 if none yet
+  int32_t message_seq; // Counts the messages taken; a new value means a new message
+} dg_hud_state_t;
+
+static dg_hud_state_t hud_state;
+static char hud_message[MESSAGE_SIZE];
+static int hud_message_seq = 0;
+
+static boolean text_hud = false;
+static int saved_screenblocks;
+
+// Switch text HUD mode on or off
+EMSCRIPTEN_KEEPALIVE
+void DG_SetTextHud(int enabled) {
+  if (enabled && !text_hud) {
+    saved_screenblocks = screenblocks;
+    screenblocks = FULLSCREEN_BLOCKS;
+    R_SetViewSize(screenblocks, detailLevel);
+  } else if (!enabled && text_hud) {
+    screenblocks = saved_screenblocks;
+    R_SetViewSize(screenblocks, detailLevel);
+  }
+
+  text_hud = enabled != 0;
+}
+
+// Called by HU_Ticker before it looks at the player's message; returns
+// true if the message was taken for the text HUD, so hu_stuff leaves it
+boolean DG_HudTakeMessage(player_t *plr) {
+  if (!text_hud || !plr->message) {
+    return false;
+  }
+
+  // Same rule as HU_Ticker: with messages off (F8) only the message
+  // saying so gets through
+  if (showMessages || message_dontfuckwithme) {
+    strncpy(hud_message, plr->message, MESSAGE_SIZE - 1);
+    hud_message[MESSAGE_SIZE - 1] = '\0';
+    hud_message_seq++;
+  }
+  plr->message = NULL;
+  message_dontfuckwithme = false;
+  return true;
+}
+
+// Called by the platform layer after each drawn frame
+void DG_HudFrameDone(void) {
+  if (!text_hud) {
+    return;
+  }
+
+  // The view size keys (M_SizeDisplay) change screenblocks; keep the full
+  // screen view, and restore their choice when text HUD mode ends
+  if (screenblocks != FULLSCREEN_BLOCKS) {
+    saved_screenblocks = screenblocks;
+    screenblocks = FULLSCREEN_BLOCKS;
+    R_SetViewSize(screenblocks, detailLevel);
+  }
+}
+
+// Fill and return the HUD state for the current frame
+EMSCRIPTEN_KEEPALIVE
+dg_hud_state_t *DG_GetHudState(void) {
+  player_t *plr = &players[displayplayer];
+  int i;
+
+  memset(&hud_state, 0, sizeof(hud_state));
+
+  if (gamestate != GS_LEVEL || !plr->mo) {
+    return &hud_state;
+  }
+
+  hud_state.active = 1;
+  hud_state.health = plr->health;
+  hud_state.armor = plr->armorpoints;
+  hud_state.armortype = plr->armortype;
+  hud_state.readyweapon = plr->readyweapon;
+
+  if (weaponinfo[plr->readyweapon].ammo == am_noammo) {
+    hud_state.readyammo = -1;
+  } else {
+    hud_state.readyammo = plr->ammo[weaponinfo[plr->readyweapon].ammo];
+  }
+
+  for (i = 0; i < NUMAMMO; i++) {
+    hud_state.ammo[i] = plr->ammo[i];
+    hud_state.maxammo[i] = plr->maxammo[i];
+  }
+
+  for (i = 0; i < NUMCARDS; i++) {
+    hud_state.cards[i] = plr->cards[i];
+  }
+
+  for (i = 0; i < NUMWEAPONS; i++) {
+    hud_state.weaponowned[i] = plr->weaponowned[i];
+  }
+
+  hud_state.kills = plr->killcount;
+  hud_state.totalkills = totalkills;
+  hud_state.items = plr->itemcount;
+  hud_state.totalitems = totalitems;
+  hud_state.secrets = plr->secretcount;
+  hud_state.totalsecrets = totalsecret;
+
+  if (hud_message_seq) {
+    hud_state.message = (int32_t)(uintptr_t)hud_message;
+    hud_state.message_seq = hud_message_seq;
+  }
+
+  return &hud_state;
+}
@@ -0,0 +1,19 @@
+/**
+ * OpenTUI HUD message hook for doomgeneric
+ *
+ * scripts/build-doom.sh makes HU_Ticker (hu_stuff.c) offer the player's
+ * message to DG_HudTakeMessage first, so that in text HUD mode
+ * doom_js_hud.c shows it in the terminal instead of hu_stuff drawing it.
+ */
+
+#ifndef DOOM_JS_HUD_H
+#define DOOM_JS_HUD_H
+
+#include "doomtype.h"
+
+struct player_s;
+
+// True if the player's message was taken for the text HUD
+boolean DG_HudTakeMessage(struct player_s *plr);
+
+#endif
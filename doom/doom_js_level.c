@@ -0,0 +1,446 @@
+/**
+ * OpenTUI level loading for doomgeneric
+ *
+ * Times every stage of P_SetupLevel (see doom_js_level.h) into a block
+ * JavaScript reads after a level starts, and builds the blockmap when the
+ * map's BLOCKMAP lump is empty, too large for vanilla's 16-bit offsets, or
+ * -blockmap asks for it. A built blockmap is kept on disk by JavaScript,
+ * keyed by a hash of the map's vertexes and linedefs, so loading the same
+ * map again only reads it back.
+ *
+ * JavaScript side (see src/doom-engine.ts):
+ *   Module.levelCacheRead(key)         -> Uint8Array, or null if not cached
+ *   Module.levelCacheWrite(key, bytes)
+ */
+
+// Include DOOM headers first to define 'boolean' type before emscripten's
+// macros
+#include "doomdata.h"
+#include "doomstat.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "p_local.h"
+#include "r_state.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <emscripten.h>
+
+#include "doom_js_level.h"
+
+// Stages, in the order P_SetupLevel runs them; names match the calls
+enum {
+  STAGE_BLOCKMAP,
+  STAGE_VERTEXES,
+  STAGE_SECTORS,
+  STAGE_SIDEDEFS,
+  STAGE_LINEDEFS,
+  STAGE_SUBSECTORS,
+  STAGE_NODES,
+  STAGE_SEGS,
+  STAGE_GROUPLINES,
+  STAGE_REJECT,
+  STAGE_THINGS,
+  STAGE_SPECIALS,
+  STAGE_PRECACHE,
+  STAGE_BUILD_BLOCKMAP, // Ours: building or reading back the blockmap
+  NUM_STAGES
+};
+
+static const char *stage_names[STAGE_BUILD_BLOCKMAP] = {
+    "P_LoadBlockMap", "P_LoadVertexes",   "P_LoadSectors", "P_LoadSideDefs",
+    "P_LoadLineDefs", "P_LoadSubsectors", "P_LoadNodes",   "P_LoadSegs",
+    "P_GroupLines",   "P_LoadReject",     "P_LoadThings",  "P_SpawnSpecials",
+    "R_PrecacheLevel",
+};
+
+// Where the level's blockmap came from
+#define BLOCKMAP_LUMP 0
+#define BLOCKMAP_BUILT 1
+#define BLOCKMAP_CACHED 2
+
+// Bump when the blockmap builder changes, so old cache entries are not used
+#define BLOCKMAP_VERSION 1
+
+// Level timings layout, read by src/doom-engine.ts as an Int32Array
+typedef struct {
+  int32_t loads; // Levels loaded since startup
+  int32_t episode;
+  int32_t map;
+  int32_t blockmap; // BLOCKMAP_LUMP, BLOCKMAP_BUILT or BLOCKMAP_CACHED
+  int32_t total_us; // Microseconds, first stage to last
+  int32_t stage_us[NUM_STAGES];
+} dg_level_timings_t;
+
+static dg_level_timings_t level_timings;
+
+static int stage = -1;
+static double stage_start;
+static double load_start;
+
+// What the blockmap stage found: the lump is missing or unusable
+static boolean blockmap_missing;
+static boolean blockmap_wanted;
+
+// Maps whose built blockmap was too large to install, by hash, so loading
+// them again goes straight to the lump instead of building it once more
+#define REJECTED_MAX 16
+
+typedef struct {
+  uint64_t hash;
+  int words;
+} rejected_blockmap_t;
+
+static rejected_blockmap_t rejected[REJECTED_MAX];
+static int rejected_count = 0;
+
+// Defined in i_system.c
+extern boolean dg_quit_requested;
+
+#define FNV64_OFFSET 14695981039346656037ull
+#define FNV64_PRIME 1099511628211ull
+
+static inline uint64_t Mix64(uint64_t hash, int32_t value) {
+  return (hash ^ (uint32_t)value) * FNV64_PRIME;
+}
+
+// The map's lump (ExMy or MAPxx), or -1
+static int MapLump(void) {
+  char name[9];
+
+  if (gamemode == commercial) {
+    M_snprintf(name, sizeof(name), "MAP%02i", gamemap);
+  } else {
+    M_snprintf(name, sizeof(name), "E%iM%i", gameepisode, gamemap);
+  }
+  return W_CheckNumForName(name);
+}
+
+// Whether the BLOCKMAP lump needs replacing; sets blockmap_missing if it
+// cannot even be loaded
+static boolean BlockmapWanted(void) {
+  int lump = MapLump();
+  int words;
+
+  blockmap_missing = false;
+  if (lump < 0) {
+    return false;
+  }
+  words = W_LumpLength(lump + ML_BLOCKMAP) / 2;
+  if (words < 4) {
+    blockmap_missing = true;
+    return true;
+  }
+  // Offsets past 32767 wrap in 16-bit blockmaps
+  if (sizeof(*blockmaplump) < sizeof(int32_t) && words > 0x8000) {
+    return true;
+  }
+  return M_CheckParm("-blockmap") > 0;
+}
+
+// Add line 'line' to every block it crosses: counts the entries of each
+// block when 'data' is NULL, else writes them at slots[block]
+static void MarkLine(int line, int orgx, int orgy, int width, int *slots,
+                     int32_t *data) {
+  const line_t *li = &lines[line];
+  int64_t x1 = (li->v1->x >> FRACBITS) - orgx;
+  int64_t y1 = (li->v1->y >> FRACBITS) - orgy;
+  int64_t x2 = (li->v2->x >> FRACBITS) - orgx;
+  int64_t y2 = (li->v2->y >> FRACBITS) - orgy;
+  int64_t dx = x2 - x1;
+  int64_t dy = y2 - y1;
+  int bx0 = (int)((x1 < x2 ? x1 : x2) / MAPBLOCKUNITS);
+  int bx1 = (int)((x1 < x2 ? x2 : x1) / MAPBLOCKUNITS);
+  int by0 = (int)((y1 < y2 ? y1 : y2) / MAPBLOCKUNITS);
+  int by1 = (int)((y1 < y2 ? y2 : y1) / MAPBLOCKUNITS);
+  int bx, by;
+
+  for (by = by0; by <= by1; by++) {
+    for (bx = bx0; bx <= bx1; bx++) {
+      int64_t left = (int64_t)bx * MAPBLOCKUNITS - x1;
+      int64_t bottom = (int64_t)by * MAPBLOCKUNITS - y1;
+      int64_t right = left + MAPBLOCKUNITS;
+      int64_t top = bottom + MAPBLOCKUNITS;
+      // The line's box covers this block; the line misses it only if all
+      // four corners are on one side
+      int64_t s0 = dx * bottom - dy * left;
+      int64_t s1 = dx * bottom - dy * right;
+      int64_t s2 = dx * top - dy * left;
+      int64_t s3 = dx * top - dy * right;
+      int block = by * width + bx;
+
+      if ((s0 > 0 && s1 > 0 && s2 > 0 && s3 > 0) ||
+          (s0 < 0 && s1 < 0 && s2 < 0 && s3 < 0)) {
+        continue;
+      }
+      if (data) {
+        data[slots[block]++] = line;
+      } else {
+        slots[block]++;
+      }
+    }
+  }
+}
+
+// Blockmap header for the loaded vertexes: origin and size in blocks
+static void BlockmapBounds(int32_t header[4]) {
+  int minx = INT_MAX, miny = INT_MAX, maxx = INT_MIN, maxy = INT_MIN;
+  int i;
+
+  for (i = 0; i < numvertexes; i++) {
+    int x = vertexes[i].x >> FRACBITS;
+    int y = vertexes[i].y >> FRACBITS;
+    minx = x < minx ? x : minx;
+    miny = y < miny ? y : miny;
+    maxx = x > maxx ? x : maxx;
+    maxy = y > maxy ? y : maxy;
+  }
+  if (numvertexes == 0) {
+    minx = miny = maxx = maxy = 0;
+  }
+  header[0] = minx;
+  header[1] = miny;
+  header[2] = (maxx - minx) / MAPBLOCKUNITS + 1;
+  header[3] = (maxy - miny) / MAPBLOCKUNITS + 1;
+}
+
+// Build the blockmap as a BLOCKMAP lump would hold it: the header, one list
+// offset per block, then each list as 0, lines..., -1 (vanilla checks line
+// 0 in every block through that leading 0). Empty blocks share one list.
+// Returns the size in words; *out is malloc'd.
+static int BuildBlockmap(const int32_t header[4], int32_t **out) {
+  int width = header[2];
+  int blocks = width * header[3];
+  int empty = 4 + blocks;
+  int *slots = calloc(blocks, sizeof(int));
+  int32_t *data;
+  int words, pos, i;
+
+  for (i = 0; i < numlines; i++) {
+    MarkLine(i, header[0], header[1], width, slots, NULL);
+  }
+
+  words = empty + 2;
+  for (i = 0; i < blocks; i++) {
+    words += slots[i] ? slots[i] + 2 : 0;
+  }
+  data = malloc(words * sizeof(int32_t));
+  memcpy(data, header, 4 * sizeof(int32_t));
+  data[empty] = 0;
+  data[empty + 1] = -1;
+
+  pos = empty + 2;
+  for (i = 0; i < blocks; i++) {
+    int count = slots[i];
+    if (!count) {
+      data[4 + i] = empty;
+      continue;
+    }
+    data[4 + i] = pos;
+    data[pos] = 0;
+    data[pos + count + 1] = -1;
+    slots[i] = pos + 1;
+    pos += count + 2;
+  }
+
+  for (i = 0; i < numlines; i++) {
+    MarkLine(i, header[0], header[1], width, slots, data);
+  }
+
+  free(slots);
+  *out = data;
+  return words;
+}
+
+// A blockmap read back from the cache, if it fits this map
+static boolean BlockmapValid(const int32_t header[4], const int32_t *data,
+                             int words) {
+  int blocks = header[2] * header[3];
+  int i;
+
+  if (words < 4 + blocks || memcmp(data, header, 4 * sizeof(int32_t))) {
+    return false;
+  }
+  for (i = 0; i < blocks; i++) {
+    if (data[4 + i] < 4 + blocks || data[4 + i] >= words) {
+      return false;
+    }
+  }
+  return data[words - 1] == -1;
+}
+
+// Replace the level's blockmap; false if it does not fit the engine's
+// offset type
+static boolean InstallBlockmap(const int32_t *data, int words) {
+  int64_t limit = ((int64_t)1 << (8 * sizeof(*blockmaplump) - 1)) - 1;
+  int blocks = data[2] * data[3];
+  int i;
+
+  if (words - 1 > limit || numlines > limit) {
+    return false;
+  }
+
+  blockmaplump = Z_Malloc(words * sizeof(*blockmaplump), PU_LEVEL, 0);
+  for (i = 0; i < words; i++) {
+    blockmaplump[i] = data[i];
+  }
+  blockmap = blockmaplump + 4;
+  bmaporgx = data[0] * FRACUNIT;
+  bmaporgy = data[1] * FRACUNIT;
+  bmapwidth = data[2];
+  bmapheight = data[3];
+
+  blocklinks = Z_Malloc(blocks * sizeof(*blocklinks), PU_LEVEL, 0);
+  memset(blocklinks, 0, blocks * sizeof(*blocklinks));
+  return true;
+}
+
+// Fall back to the BLOCKMAP lump, which is fatal if there is none
+static void KeepBlockmapLump(int words) {
+  level_timings.blockmap = BLOCKMAP_LUMP;
+  if (blockmap_missing) {
+    I_Error("P_SetupLevel: map too large for a blockmap (%i words)", words);
+  }
+}
+
+// Build the blockmap, or read it back from the cache, and install it
+static void ReplaceBlockmap(void) {
+  int32_t header[4];
+  int32_t *data;
+  uint64_t hash = FNV64_OFFSET;
+  char key[40];
+  boolean built = false;
+  int words = 0;
+  int i;
+
+  // Keyed by what the blockmap is built from
+  hash = Mix64(hash, numvertexes);
+  for (i = 0; i < numvertexes; i++) {
+    hash = Mix64(hash, vertexes[i].x);
+    hash = Mix64(hash, vertexes[i].y);
+  }
+  hash = Mix64(hash, numlines);
+  for (i = 0; i < numlines; i++) {
+    hash = Mix64(hash, (int32_t)(lines[i].v1 - vertexes));
+    hash = Mix64(hash, (int32_t)(lines[i].v2 - vertexes));
+  }
+  M_snprintf(key, sizeof(key), "blockmap-%i-%08x%08x", BLOCKMAP_VERSION,
+             (unsigned int)(hash >> 32), (unsigned int)hash);
+
+  for (i = 0; i < rejected_count; i++) {
+    if (rejected[i].hash == hash) {
+      KeepBlockmapLump(rejected[i].words);
+      return;
+    }
+  }
+
+  BlockmapBounds(header);
+
+  data = (int32_t *)EM_ASM_INT(
+      {
+        if (typeof Module.levelCacheRead !== 'function') return 0;
+        var bytes = Module.levelCacheRead(UTF8ToString($0));
+        if (!bytes || bytes.length < 16) return 0;
+        var ptr = _malloc(bytes.length);
+        HEAPU8.set(bytes, ptr);
+        HEAP32[$1 >> 2] = bytes.length >> 2;
+        return ptr;
+      },
+      key, &words);
+
+  if (data && BlockmapValid(header, data, words)) {
+    level_timings.blockmap = BLOCKMAP_CACHED;
+  } else {
+    free(data);
+    words = BuildBlockmap(header, &data);
+    level_timings.blockmap = BLOCKMAP_BUILT;
+    built = true;
+  }
+
+  if (!InstallBlockmap(data, words)) {
+    // Oldest entry first out once the list is full
+    if (rejected_count == REJECTED_MAX) {
+      memmove(rejected, rejected + 1, (REJECTED_MAX - 1) * sizeof(*rejected));
+      rejected_count--;
+    }
+    rejected[rejected_count].hash = hash;
+    rejected[rejected_count].words = words;
+    rejected_count++;
+    KeepBlockmapLump(words);
+  } else if (built) {
+    // Only a blockmap that could be installed is worth reading back
+    EM_ASM(
+        {
+          if (typeof Module.levelCacheWrite !== 'function') return;
+          Module.levelCacheWrite(UTF8ToString($0),
+                                 HEAPU8.slice($1, $1 + $2 * 4));
+        },
+        key, data, words);
+  }
+  free(data);
+}
+
+int DG_LevelStageBegin(const char *name) {
+  int i;
+
+  // I_Error returns in this port: after one (e.g. no usable blockmap) the
+  // rest of the level must not load on top of what is missing
+  if (dg_quit_requested) {
+    stage = -1;
+    return 0;
+  }
+
+  stage = -1;
+  for (i = 0; i < STAGE_BUILD_BLOCKMAP; i++) {
+    if (!strcmp(name, stage_names[i])) {
+      stage = i;
+      break;
+    }
+  }
+  stage_start = emscripten_get_now();
+
+  if (stage == STAGE_BLOCKMAP) {
+    // The first stage: a new level
+    memset(level_timings.stage_us, 0, sizeof(level_timings.stage_us));
+    level_timings.loads++;
+    level_timings.episode = gameepisode;
+    level_timings.map = gamemap;
+    level_timings.blockmap = BLOCKMAP_LUMP;
+    load_start = stage_start;
+    blockmap_wanted = BlockmapWanted();
+    return !blockmap_missing;
+  }
+
+  // Lines are in, and grouping them needs the blockmap for sector boxes
+  if (stage == STAGE_GROUPLINES && blockmap_wanted) {
+    ReplaceBlockmap();
+    blockmap_wanted = false;
+    level_timings.stage_us[STAGE_BUILD_BLOCKMAP] =
+        (int32_t)((emscripten_get_now() - stage_start) * 1000);
+    stage_start = emscripten_get_now();
+    // Without a blockmap to group them with, the lines stay as they are
+    return !dg_quit_requested;
+  }
+  return 1;
+}
+
+void DG_LevelStageEnd(const char *name) {
+  double now = emscripten_get_now();
+
+  if (stage < 0) {
+    return;
+  }
+  level_timings.stage_us[stage] = (int32_t)((now - stage_start) * 1000);
+  level_timings.total_us = (int32_t)((now - load_start) * 1000);
+  stage = -1;
+}
+
+// Address of the block; it never moves, so JavaScript asks once
+EMSCRIPTEN_KEEPALIVE
+dg_level_timings_t *DG_GetLevelTimings(void) { return &level_timings; }
@@ -0,0 +1,24 @@
+/**
+ * OpenTUI level load hooks for doomgeneric
+ *
+ * scripts/build-doom.sh wraps every loading stage of P_SetupLevel
+ * (p_setup.c) in DG_LEVEL_STAGE, so that doom_js_level.c can time each one
+ * and stand in for the ones it has better data for.
+ */
+
+#ifndef DOOM_JS_LEVEL_H
+#define DOOM_JS_LEVEL_H
+
+// Called around each stage; Begin returns 0 if the stage must not run
+int DG_LevelStageBegin(const char *stage);
+void DG_LevelStageEnd(const char *stage);
+
+#define DG_LEVEL_STAGE(stage, args)                                            \
+  do {                                                                         \
+    if (DG_LevelStageBegin(#stage)) {                                          \
+      stage args;                                                              \
+    }                                                                          \
+    DG_LevelStageEnd(#stage);                                                  \
+  } while (0)
+
+#endif
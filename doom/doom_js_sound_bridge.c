@@ -3,6 +3,13 @@
  *
  * This file implements the sound_module_t and music_module_t interfaces
  * that DOOM uses for audio. It calls out to JavaScript via Emscripten.
+ *
+ * Sound effects started during a tic are collected and sent to JavaScript
+ * together when the tic's sounds are updated: the same effect started from
+ * several origins (a room full of imps waking up) plays once, as loud as
+ * the loudest start and panned between them, and at most
+ * MAX_STARTS_PER_TIC effects start per tic, so a big fight cannot start an
+ * unbounded number of voices.
  */
 
 // Include DOOM headers first to define 'boolean' type before emscripten's
@@ -31,6 +38,19 @@ float libsamplerate_scale = 0.65f;
 static boolean sound_initialized = false;
 static boolean use_sfx_prefix = true;
 
+// Distinct effects started per tic; quieter ones beyond that are dropped
+#define MAX_STARTS_PER_TIC 8
+
+typedef struct {
+  sfxinfo_t *sfx;
+  int vol;     // Loudest start
+  int sep_sum; // Separation of each start, weighted by its volume
+  int vol_sum;
+} pending_sound_t;
+
+static pending_sound_t pending_sounds[MAX_STARTS_PER_TIC];
+static int num_pending_sounds = 0;
+
 // Initialize sound
 static boolean I_JS_InitSound(boolean _use_sfx_prefix) {
   use_sfx_prefix = _use_sfx_prefix;
@@ -56,6 +76,7 @@ static void I_JS_ShutdownSound(void) {
     }
   });
 
+  num_pending_sounds = 0;
   sound_initialized = false;
 }
 
@@ -75,31 +96,72 @@ static int I_JS_GetSfxLumpNum(sfxinfo_t *sfx) {
   return W_GetNumForName(namebuf);
 }
 
+// Send the effects started since the last update to JavaScript
 static void I_JS_UpdateSound(void) {
-  // No-op - JavaScript handles its own updates
+  int i;
+
+  for (i = 0; i < num_pending_sounds; i++) {
+    const pending_sound_t *sound = &pending_sounds[i];
+    int sep = sound->vol_sum > 0 ? sound->sep_sum / sound->vol_sum : 128;
+
+    EM_ASM(
+        {
+          var name = UTF8ToString($0);
+          if (typeof Module.playSound === 'function') {
+            Module.playSound(name, $1, $2);
+          }
+        },
+        sound->sfx->name, sound->vol, sep);
+  }
+  num_pending_sounds = 0;
 }
 
 static void I_JS_UpdateSoundParams(int channel, int vol, int sep) {
   // No-op - we don't support stereo positioning currently
 }
 
-// Play a sound effect with volume
+// Play a sound effect with volume: merged into an effect already started
+// this tic, or queued for I_JS_UpdateSound
 static int I_JS_StartSound(sfxinfo_t *sfxinfo, int channel, int vol, int sep) {
+  pending_sound_t *sound = NULL;
+  int i;
+
   if (!sound_initialized || !sfxinfo)
     return -1;
 
-  const char *name = sfxinfo->name;
+  for (i = 0; i < num_pending_sounds; i++) {
+    if (pending_sounds[i].sfx == sfxinfo) {
+      sound = &pending_sounds[i];
+      break;
+    }
+  }
 
-  // Call JavaScript to play the sound with volume
-  EM_ASM(
-      {
-        var name = UTF8ToString($0);
-        var volume = $1;
-        if (typeof Module.playSound === 'function') {
-          Module.playSound(name, volume);
+  if (sound == NULL) {
+    if (num_pending_sounds < MAX_STARTS_PER_TIC) {
+      sound = &pending_sounds[num_pending_sounds++];
+    } else {
+      // Full: take the place of the quietest effect, if this one is louder
+      sound = &pending_sounds[0];
+      for (i = 1; i < num_pending_sounds; i++) {
+        if (pending_sounds[i].vol < sound->vol) {
+          sound = &pending_sounds[i];
         }
-      },
-      name, vol);
+      }
+      if (sound->vol >= vol) {
+        return channel;
+      }
+    }
+    sound->sfx = sfxinfo;
+    sound->vol = 0;
+    sound->sep_sum = 0;
+    sound->vol_sum = 0;
+  }
+
+  if (vol > sound->vol) {
+    sound->vol = vol;
+  }
+  sound->sep_sum += sep * vol;
+  sound->vol_sum += vol;
 
   return channel;
 }
@@ -0,0 +1,160 @@
+/**
+ * OpenTUI engine state block for doomgeneric
+ *
+ * A fixed-layout, versioned struct in linear memory that the platform layer
+ * refreshes after every tic: what the engine is showing (level, menu,
+ * pause, automap, intermission), the palette in use and the player's stats.
+ * JavaScript keeps one typed view on it and reads it every frame without
+ * calling into the module.
+ */
+
+// Include DOOM headers first to define 'boolean' type before emscripten's
+// macros
+#include "d_items.h"
+#include "d_player.h"
+#include "doomstat.h"
+
+#include <stdint.h>
+
+#include <emscripten.h>
+
+// Defined in m_menu.c
+extern boolean inhelpscreens;
+
+// Bump when fields change; src/doom-engine.ts refuses a layout it does not know
+#define ENGINE_STATE_VERSION 1
+
+// PLAYPAL palettes, as picked by ST_doPaletteStuff in st_stuff.c
+#define STARTREDPALS 1
+#define NUMREDPALS 8
+#define STARTBONUSPALS 9
+#define NUMBONUSPALS 4
+#define RADIATIONPAL 13
+
+// Engine state layout, read by src/doom-engine.ts as an Int32Array
+typedef struct {
+  int32_t version;
+  int32_t size; // Bytes
+  int32_t gametic;
+  int32_t leveltime; // Tics since the level started
+  int32_t gamestate; // GS_LEVEL, GS_INTERMISSION, GS_FINALE, GS_DEMOSCREEN
+  int32_t menuactive;
+  int32_t paused;
+  int32_t automapactive;
+  int32_t helpscreen; // A help or credits screen is up
+  int32_t demoplayback;
+  int32_t demorecording;
+  int32_t netgame;
+  int32_t palette; // PLAYPAL index: 0 normal, 1-8 pain, 9-12 pickup, 13 suit
+  int32_t episode;
+  int32_t map;
+  int32_t skill;
+  int32_t playerstate; // PST_LIVE, PST_DEAD, PST_REBORN
+  int32_t health;
+  int32_t armor;
+  int32_t armortype;
+  int32_t readyweapon;
+  int32_t readyammo; // -1 if the weapon uses no ammo
+  int32_t ammo[NUMAMMO];
+  int32_t kills;
+  int32_t totalkills;
+  int32_t items;
+  int32_t totalitems;
+  int32_t secrets;
+  int32_t totalsecrets;
+  int32_t damagecount;
+  int32_t bonuscount;
+} dg_engine_state_t;
+
+static dg_engine_state_t engine_state = {ENGINE_STATE_VERSION,
+                                         sizeof(dg_engine_state_t)};
+
+// The palette the status bar code sets for this player (ST_doPaletteStuff)
+static int PlayerPalette(player_t *plr) {
+  int cnt = plr->damagecount;
+  int palette;
+
+  if (gamestate != GS_LEVEL) {
+    return 0;
+  }
+
+  if (plr->powers[pw_strength]) {
+    // The berserk tint fades out slowly
+    int bzc = 12 - (plr->powers[pw_strength] >> 6);
+    if (bzc > cnt) {
+      cnt = bzc;
+    }
+  }
+
+  if (cnt) {
+    palette = (cnt + 7) >> 3;
+    if (palette >= NUMREDPALS) {
+      palette = NUMREDPALS - 1;
+    }
+    return palette + STARTREDPALS;
+  }
+
+  if (plr->bonuscount) {
+    palette = (plr->bonuscount + 7) >> 3;
+    if (palette >= NUMBONUSPALS) {
+      palette = NUMBONUSPALS - 1;
+    }
+    return palette + STARTBONUSPALS;
+  }
+
+  if (plr->powers[pw_ironfeet] > 4 * 32 || plr->powers[pw_ironfeet] & 8) {
+    return RADIATIONPAL;
+  }
+  return 0;
+}
+
+// Refresh the block; called by the platform layer once per tick
+void DG_UpdateEngineState(void) {
+  player_t *plr = &players[consoleplayer];
+  int i;
+
+  engine_state.gametic = gametic;
+  engine_state.leveltime = leveltime;
+  engine_state.gamestate = gamestate;
+  engine_state.menuactive = menuactive;
+  engine_state.paused = paused;
+  engine_state.automapactive = automapactive;
+  engine_state.helpscreen = inhelpscreens;
+  engine_state.demoplayback = demoplayback;
+  engine_state.demorecording = demorecording;
+  engine_state.netgame = netgame;
+  engine_state.palette = PlayerPalette(plr);
+  engine_state.episode = gameepisode;
+  engine_state.map = gamemap;
+  engine_state.skill = gameskill;
+
+  engine_state.playerstate = plr->playerstate;
+  engine_state.health = plr->health;
+  engine_state.armor = plr->armorpoints;
+  engine_state.armortype = plr->armortype;
+  engine_state.readyweapon = plr->readyweapon;
+  if (weaponinfo[plr->readyweapon].ammo == am_noammo) {
+    engine_state.readyammo = -1;
+  } else {
+    engine_state.readyammo = plr->ammo[weaponinfo[plr->readyweapon].ammo];
+  }
+  for (i = 0; i < NUMAMMO; i++) {
+    engine_state.ammo[i] = plr->ammo[i];
+  }
+
+  engine_state.kills = plr->killcount;
+  engine_state.totalkills = totalkills;
+  engine_state.items = plr->itemcount;
+  engine_state.totalitems = totalitems;
+  engine_state.secrets = plr->secretcount;
+  engine_state.totalsecrets = totalsecret;
+  engine_state.damagecount = plr->damagecount;
+  engine_state.bonuscount = plr->bonuscount;
+}
+
+// Palette index of the last refresh, for the platform layer
+int DG_GetPaletteIndex(void) { return engine_state.palette; }
+
+// Address of the block; it never moves, so JavaScript asks once
+EMSCRIPTEN_KEEPALIVE
+dg_engine_state_t *DG_GetEngineState(void) { return &engine_state; }
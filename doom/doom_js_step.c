@@ -0,0 +1,133 @@
+/**
+ * OpenTUI stepping bridge for doomgeneric
+ *
+ * Observations for programmatic stepping (automated play): the frame
+ * point-sampled down to the native resolution or below, and the player's
+ * key game variables. Both are written to static buffers that JavaScript
+ * reads in place, so a step copies nothing across the boundary.
+ */
+
+// Include DOOM headers first to define 'boolean' type before emscripten's
+// macros
+#include "d_items.h"
+#include "d_player.h"
+#include "doomgeneric.h"
+#include "doomstat.h"
+#include "m_fixed.h"
+
+#include <stdint.h>
+
+#include <emscripten.h>
+
+// DOOM renders at 320x200; the framebuffer is that, scaled up evenly
+#define NATIVE_WIDTH 320
+#define NATIVE_HEIGHT 200
+#define SCREEN_SCALE (DOOMGENERIC_RESX / NATIVE_WIDTH)
+
+// Game variables layout, read by src/doom-engine.ts as an Int32Array
+typedef struct {
+  int32_t gametic;
+  int32_t gamestate; // GS_LEVEL, GS_INTERMISSION, GS_FINALE, GS_DEMOSCREEN
+  int32_t episode;
+  int32_t map;
+  int32_t alive; // In a level with a live player
+  int32_t health;
+  int32_t armor;
+  int32_t readyweapon;
+  int32_t readyammo; // -1 if the weapon uses no ammo
+  int32_t ammo[NUMAMMO];
+  int32_t kills;
+  int32_t items;
+  int32_t secrets;
+  int32_t x; // Map units
+  int32_t y;
+  int32_t z;
+  int32_t angle; // Degrees, 0 = east, counterclockwise
+  int32_t damagecount; // Red flash strength: taken damage recently
+  int32_t attackdown; // Fire is held
+} dg_step_vars_t;
+
+static dg_step_vars_t step_vars;
+
+// Largest observation: native resolution, three bytes per pixel
+static uint8_t observation[NATIVE_WIDTH * NATIVE_HEIGHT * 3];
+
+// Sample the framebuffer every 'shrink' native pixels (1 = 320x200) into
+// the observation buffer, as RGB or as grayscale bytes
+EMSCRIPTEN_KEEPALIVE
+uint8_t *DG_GetObservation(int shrink, int gray) {
+  uint8_t *out = observation;
+  int step, width, height, x, y;
+
+  if (shrink < 1) {
+    shrink = 1;
+  }
+  step = SCREEN_SCALE * shrink;
+  width = NATIVE_WIDTH / shrink;
+  height = NATIVE_HEIGHT / shrink;
+
+  for (y = 0; y < height; y++) {
+    const uint32_t *row =
+        DG_ScreenBuffer + (y * step + step / 2) * DOOMGENERIC_RESX + step / 2;
+
+    for (x = 0; x < width; x++) {
+      uint32_t pixel = row[x * step];
+      uint8_t r = (pixel >> 16) & 0xff;
+      uint8_t g = (pixel >> 8) & 0xff;
+      uint8_t b = pixel & 0xff;
+
+      if (gray) {
+        *out++ = (uint8_t)((r * 77 + g * 150 + b * 29) >> 8);
+      } else {
+        *out++ = r;
+        *out++ = g;
+        *out++ = b;
+      }
+    }
+  }
+
+  return observation;
+}
+
+// Fill and return the game variables for the current tic
+EMSCRIPTEN_KEEPALIVE
+dg_step_vars_t *DG_GetStepVars(void) {
+  player_t *plr = &players[consoleplayer];
+  int i;
+
+  step_vars.gametic = gametic;
+  step_vars.gamestate = gamestate;
+  step_vars.episode = gameepisode;
+  step_vars.map = gamemap;
+  step_vars.alive = gamestate == GS_LEVEL && plr->mo != NULL &&
+                    plr->playerstate == PST_LIVE;
+  step_vars.health = plr->health;
+  step_vars.armor = plr->armorpoints;
+  step_vars.readyweapon = plr->readyweapon;
+
+  if (weaponinfo[plr->readyweapon].ammo == am_noammo) {
+    step_vars.readyammo = -1;
+  } else {
+    step_vars.readyammo = plr->ammo[weaponinfo[plr->readyweapon].ammo];
+  }
+
+  for (i = 0; i < NUMAMMO; i++) {
+    step_vars.ammo[i] = plr->ammo[i];
+  }
+
+  step_vars.kills = plr->killcount;
+  step_vars.items = plr->itemcount;
+  step_vars.secrets = plr->secretcount;
+
+  if (plr->mo != NULL) {
+    step_vars.x = plr->mo->x >> FRACBITS;
+    step_vars.y = plr->mo->y >> FRACBITS;
+    step_vars.z = plr->mo->z >> FRACBITS;
+    step_vars.angle = (int32_t)(((uint64_t)plr->mo->angle * 360) >> 32);
+  }
+
+  step_vars.damagecount = plr->damagecount;
+  step_vars.attackdown = plr->attackdown;
+
+  return &step_vars;
+}
@@ -0,0 +1,277 @@
+/**
+ * OpenTUI uncapped view rendering for doomgeneric
+ *
+ * The game runs at 35 tics a second, but the terminal can take frames
+ * faster than that. In uncapped mode JavaScript asks for frames between
+ * tics (DG_RenderView) and only the player view is drawn again, in the
+ * style of Crispy Doom: every mobj is drawn part of the way from where it
+ * was one tic ago to where it is now, and the view is turned by the part of
+ * the next tic's turn the held turn keys are going to give it. Everything
+ * is put back after drawing, so the playsim (and a demo) never sees it.
+ */
+
+// Include DOOM headers first to define 'boolean' type before emscripten's
+// macros
+#include "d_player.h"
+#include "doomstat.h"
+#include "hu_stuff.h"
+#include "i_video.h"
+#include "m_fixed.h"
+#include "p_local.h"
+#include "r_main.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <emscripten.h>
+
+#include "doom_js_view.h"
+
+// Defined in m_controls.c
+extern int key_left;
+extern int key_right;
+extern int key_speed;
+
+// Same as angleturn[] and SLOWTURNTICS in g_game.c
+#define TURN_NORMAL 640
+#define TURN_FAST 1280
+#define TURN_SLOW 320
+#define SLOWTURNTICS 6
+
+// Further than anything moves in one tic: a teleport or a respawn, which is
+// drawn where it ended up
+#define TELEPORT_DIST (64 * FRACUNIT)
+
+typedef struct {
+  mobj_t *mo;
+  fixed_t x, y, z;
+  angle_t angle;
+} view_mobj_t;
+
+// Where every mobj was at the end of one tic, in thinker order
+typedef struct {
+  int leveltime; // -1 if none
+  int map;       // gameepisode * 100 + gamemap
+  fixed_t viewz;
+  int count;
+  int size;
+  view_mobj_t *mobjs;
+} view_snapshot_t;
+
+static int uncapped = 0;
+static fixed_t view_frac = 0;
+
+// snapshots[current] is the latest tic, the other one the tic before it
+static view_snapshot_t snapshots[2] = {{-1}, {-1}};
+static int current = 0;
+
+// Turn keys as JavaScript last sent them
+static int turn_left = 0;
+static int turn_right = 0;
+static int run_held = 0;
+static int turn_tics = 0; // Like turnheld in g_game.c
+
+// Whether the last frame DOOM finished showed the player view (not a wipe,
+// the automap or an intermission), so drawing it again is all it takes
+static int view_in_frame = 0;
+static int view_on_screen = 0;
+static int between_tics = 0;
+
+EMSCRIPTEN_KEEPALIVE
+void DG_SetUncapped(int enabled) {
+  uncapped = enabled;
+  view_frac = 0;
+}
+
+void DG_ViewKeyEvent(int pressed, int key) {
+  if (key == key_left) {
+    turn_left = pressed;
+  }
+  if (key == key_right) {
+    turn_right = pressed;
+  }
+  if (key == key_speed) {
+    run_held = pressed;
+  }
+}
+
+void DG_ViewFrameDone(void) {
+  if (!between_tics) {
+    view_on_screen = view_in_frame;
+  }
+  view_in_frame = 0;
+}
+
+static int MapId(void) { return gameepisode * 100 + gamemap; }
+
+// Record where everything is, once per tic
+static void Capture(void) {
+  view_snapshot_t *snap = &snapshots[current];
+  int tics = leveltime - snap->leveltime;
+  thinker_t *th;
+
+  if (tics == 0 && snap->map == MapId()) {
+    return;
+  }
+
+  // Turning speeds up once the keys were held for SLOWTURNTICS, as in
+  // G_BuildTiccmd
+  if (turn_left != turn_right && tics > 0) {
+    turn_tics += tics;
+  } else {
+    turn_tics = 0;
+  }
+
+  current ^= 1;
+  snap = &snapshots[current];
+  snap->leveltime = leveltime;
+  snap->map = MapId();
+  snap->viewz = players[displayplayer].viewz;
+  snap->count = 0;
+  view_frac = 0;
+
+  for (th = thinkercap.next; th != &thinkercap; th = th->next) {
+    const mobj_t *mo = (const mobj_t *)th;
+    view_mobj_t *entry;
+
+    if (th->function.acp1 != (actionf_p1)P_MobjThinker) {
+      continue;
+    }
+    if (snap->count == snap->size) {
+      int size = snap->size ? snap->size * 2 : 256;
+      view_mobj_t *mobjs = realloc(snap->mobjs, size * sizeof(*mobjs));
+      if (mobjs == NULL) {
+        snap->leveltime = -1;
+        return;
+      }
+      snap->mobjs = mobjs;
+      snap->size = size;
+    }
+    entry = &snap->mobjs[snap->count++];
+    entry->mo = (mobj_t *)mo;
+    entry->x = mo->x;
+    entry->y = mo->y;
+    entry->z = mo->z;
+    entry->angle = mo->angle;
+  }
+}
+
+// Both snapshots are there, one tic apart, and the latest is this tic
+static int CanInterpolate(void) {
+  const view_snapshot_t *now = &snapshots[current];
+  const view_snapshot_t *old = &snapshots[current ^ 1];
+
+  return now->leveltime == leveltime && old->leveltime == leveltime - 1 &&
+         now->map == MapId() && old->map == MapId();
+}
+
+static fixed_t Lerp(fixed_t from, fixed_t to) {
+  return from + FixedMul(to - from, view_frac);
+}
+
+// Move every mobj view_frac of the way from the tic before to this one
+static void Interpolate(void) {
+  const view_snapshot_t *now = &snapshots[current];
+  const view_snapshot_t *old = &snapshots[current ^ 1];
+  int i, j = 0;
+
+  for (i = 0; i < now->count; i++) {
+    mobj_t *mo = now->mobjs[i].mo;
+    const view_mobj_t *from;
+    int k;
+
+    // Thinkers keep their order and new ones go at the end, so the search
+    // only goes forward; a mobj spawned this tic is not found
+    for (k = j; k < old->count && old->mobjs[k].mo != mo; k++) {
+    }
+    if (k == old->count) {
+      continue;
+    }
+    j = k + 1;
+    from = &old->mobjs[k];
+
+    if (abs(mo->x - from->x) > TELEPORT_DIST || abs(mo->y - from->y) > TELEPORT_DIST) {
+      continue;
+    }
+    mo->x = Lerp(from->x, mo->x);
+    mo->y = Lerp(from->y, mo->y);
+    mo->z = Lerp(from->z, mo->z);
+    mo->angle = from->angle + FixedMul((int)(mo->angle - from->angle), view_frac);
+  }
+}
+
+// Put every mobj back where the playsim left it
+static void Restore(player_t *player) {
+  const view_snapshot_t *now = &snapshots[current];
+  int i;
+
+  for (i = 0; i < now->count; i++) {
+    const view_mobj_t *entry = &now->mobjs[i];
+    entry->mo->x = entry->x;
+    entry->mo->y = entry->y;
+    entry->mo->z = entry->z;
+    entry->mo->angle = entry->angle;
+  }
+  player->viewz = now->viewz;
+}
+
+// The part of the next tic's turn the held turn keys will give the player
+static angle_t PredictedTurn(const player_t *player) {
+  int speed;
+
+  if (turn_left == turn_right || demoplayback || player != &players[consoleplayer] ||
+      player->playerstate != PST_LIVE) {
+    return 0;
+  }
+  if (turn_tics + 1 < SLOWTURNTICS) {
+    speed = TURN_SLOW;
+  } else {
+    speed = run_held ? TURN_FAST : TURN_NORMAL;
+  }
+  // angleturn is in units of 1 << FRACBITS, so this is speed * FRACUNIT * frac
+  return (angle_t)((turn_left ? speed : -speed) * view_frac);
+}
+
+void DG_RenderPlayerView(player_t *player) {
+  angle_t angle;
+
+  if (!between_tics) {
+    view_in_frame = 1;
+  }
+  if (!uncapped || player->mo == NULL) {
+    R_RenderPlayerView(player);
+    return;
+  }
+
+  Capture();
+  if (!CanInterpolate()) {
+    R_RenderPlayerView(player);
+    return;
+  }
+
+  angle = player->mo->angle;
+  Interpolate();
+  player->mo->angle = angle + PredictedTurn(player);
+  player->viewz = Lerp(snapshots[current ^ 1].viewz, player->viewz);
+  R_RenderPlayerView(player);
+  Restore(player);
+}
+
+// Draw the player view again, 'frac' (of FRACUNIT) of the way from the
+// previous tic to the latest one. Returns 0 if there is nothing to draw
+// between tics (no level, a menu, the automap, a wipe): run a tic instead.
+EMSCRIPTEN_KEEPALIVE
+int DG_RenderView(int frac) {
+  if (!uncapped || !view_on_screen || gamestate != GS_LEVEL || automapactive || menuactive ||
+      paused || players[displayplayer].mo == NULL || !CanInterpolate()) {
+    return 0;
+  }
+
+  view_frac = frac < 0 ? 0 : frac > FRACUNIT ? FRACUNIT : frac;
+  between_tics = 1;
+  DG_RenderPlayerView(&players[displayplayer]);
+  HU_Drawer();
+  I_FinishUpdate();
+  between_tics = 0;
+  return 1;
+}
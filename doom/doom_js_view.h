@@ -0,0 +1,17 @@
+/**
+ * OpenTUI view rendering hook for doomgeneric
+ *
+ * scripts/build-doom.sh points D_Display (d_main.c) at DG_RenderPlayerView
+ * instead of R_RenderPlayerView, so that doom_js_view.c can draw the view
+ * between two tics when frames come faster than the game runs.
+ */
+
+#ifndef DOOM_JS_VIEW_H
+#define DOOM_JS_VIEW_H
+
+struct player_s;
+
+// Draws the player view like R_RenderPlayerView, interpolated if uncapped
+void DG_RenderPlayerView(struct player_s *player);
+
+#endif
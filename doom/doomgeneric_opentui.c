@@ -11,12 +11,31 @@
 
 #include "doomgeneric.h"
 #include "doomkeys.h"
+#include "doomtype.h"
+#include "i_video.h"
+#include "w_wad.h"
+#include "z_zone.h"
 #include <emscripten.h>
 #include <stdint.h>
 #include <string.h>
 
 // NOTE: vanilla_keyboard_mapping is defined in i_input.c
 
+// Defined in doom_js_state.c
+extern void DG_UpdateEngineState(void);
+extern int DG_GetPaletteIndex(void);
+// Defined in doom_js_view.c
+extern void DG_ViewKeyEvent(int pressed, int key);
+extern void DG_ViewFrameDone(void);
+// Defined in doom_js_hud.c
+extern void DG_HudFrameDone(void);
+
+// Defined by the engine: D_Display only runs while the screen is visible
+extern boolean screenvisible;
+extern int gametic;
+// Defined in i_system.c
+extern boolean dg_quit_requested;
+
 // Key event queue
 #define KEY_QUEUE_SIZE 256
 static struct {
@@ -33,15 +52,19 @@ static uint32_t *frame_buffer = NULL;
 EMSCRIPTEN_KEEPALIVE
 uint32_t *DG_GetFrameBuffer(void) { return DG_ScreenBuffer; }
 
-// Push a key event from JavaScript
+// Push a key event from JavaScript; returns 0 if the queue was full and
+// the event was dropped
 EMSCRIPTEN_KEEPALIVE
-void DG_PushKeyEvent(int pressed, unsigned char key) {
+int DG_PushKeyEvent(int pressed, unsigned char key) {
   int next_write = (key_queue_write + 1) % KEY_QUEUE_SIZE;
-  if (next_write != key_queue_read) {
-    key_queue[key_queue_write].pressed = pressed;
-    key_queue[key_queue_write].key = key;
-    key_queue_write = next_write;
+  if (next_write == key_queue_read) {
+    return 0;
   }
+  key_queue[key_queue_write].pressed = pressed;
+  key_queue[key_queue_write].key = key;
+  key_queue_write = next_write;
+  DG_ViewKeyEvent(pressed, key);
+  return 1;
 }
 
 // NOTE: I_InitInput and I_GetEvent are defined in i_input.c
@@ -52,19 +75,155 @@ void DG_Init(void) {
   // Initialization done in JavaScript
 }
 
+// Steady palette: frames drawn under a pain, pickup or radiation suit
+// palette are converted again with the normal one, so a flash does not
+// recolor every pixel (and every terminal cell); JavaScript shows the flash
+// some cheaper way, from the palette index in the engine state block
+static int steady_palette = 0;
+static uint32_t steady_colors[256];
+static int steady_loaded = 0;
+
+#define SCREEN_SCALE (DOOMGENERIC_RESX / SCREENWIDTH)
+
+EMSCRIPTEN_KEEPALIVE
+void DG_SetSteadyPalette(int enabled) { steady_palette = enabled; }
+
+// Colors not seen yet come from PLAYPAL's first palette, without gamma
+static void LoadSteadyColors(void) {
+  const byte *palette = W_CacheLumpName("PLAYPAL", PU_CACHE);
+  int i;
+
+  for (i = 0; i < 256; i++, palette += 3) {
+    steady_colors[i] = (palette[0] << 16) | (palette[1] << 8) | palette[2];
+  }
+  steady_loaded = 1;
+}
+
+// Learn the normal palette from a frame drawn with it: the colors
+// I_SetPalette made, gamma included
+static void LearnSteadyColors(void) {
+  const byte *in = I_VideoBuffer;
+  int x, y;
+
+  if (!steady_loaded) {
+    LoadSteadyColors();
+  }
+  for (y = 0; y < SCREENHEIGHT; y++, in += SCREENWIDTH) {
+    const uint32_t *row = DG_ScreenBuffer + y * SCREEN_SCALE * DOOMGENERIC_RESX;
+    for (x = 0; x < SCREENWIDTH; x++) {
+      steady_colors[in[x]] = row[x * SCREEN_SCALE] & 0xffffff;
+    }
+  }
+}
+
+// Convert the 8-bit screen again, scaled up like I_FinishUpdate does
+static void DrawSteadyFrame(void) {
+  const byte *in = I_VideoBuffer;
+  int x, y, i;
+
+  for (y = 0; y < SCREENHEIGHT; y++, in += SCREENWIDTH) {
+    uint32_t *row = DG_ScreenBuffer + y * SCREEN_SCALE * DOOMGENERIC_RESX;
+    for (x = 0; x < SCREENWIDTH; x++) {
+      uint32_t color = steady_colors[in[x]];
+      for (i = 0; i < SCREEN_SCALE; i++) {
+        row[x * SCREEN_SCALE + i] = color;
+      }
+    }
+    for (i = 1; i < SCREEN_SCALE; i++) {
+      memcpy(row + i * DOOMGENERIC_RESX, row, DOOMGENERIC_RESX * sizeof(*row));
+    }
+  }
+}
+
 void DG_DrawFrame(void) {
   // The frame is drawn to DG_ScreenBuffer
   // JavaScript will read it via DG_GetFrameBuffer
   // Signal to JS that a frame is ready (handled by tick loop)
+  DG_UpdateEngineState();
+  DG_ViewFrameDone();
+  DG_HudFrameDone();
+  if (!steady_palette) {
+    return;
+  }
+  if (DG_GetPaletteIndex() == 0) {
+    LearnSteadyColors();
+  } else {
+    if (!steady_loaded) {
+      LoadSteadyColors();
+    }
+    DrawSteadyFrame();
+  }
 }
 
+// Virtual clock: time only moves when DOOM sleeps, so each tick runs one
+// game tic immediately, as fast as JavaScript calls it (headless replay)
+static int virtual_clock = 0;
+static uint32_t virtual_ms = 0;
+
+// Added to the real clock once DG_RunTics has moved game time ahead of it
+static double clock_offset_ms = 0;
+
+// Ticks in a row without a new tic before DG_RunTics gives up
+#define RUN_TICS_STALL 35
+
+EMSCRIPTEN_KEEPALIVE
+void DG_SetVirtualClock(int enabled) { virtual_clock = enabled; }
+
 void DG_SleepMs(uint32_t ms) {
   // No-op in WASM - JavaScript handles timing via game loop
   // Don't use emscripten_sleep as it requires ASYNCIFY
-  (void)ms; // Suppress unused warning
+  if (virtual_clock) {
+    virtual_ms += ms;
+  }
+}
+
+uint32_t DG_GetTicksMs(void) {
+  if (virtual_clock) {
+    return virtual_ms;
+  }
+  return (uint32_t)(emscripten_get_now() + clock_offset_ms);
 }
 
-uint32_t DG_GetTicksMs(void) { return (uint32_t)emscripten_get_now(); }
+// Run 'tics' game tics in one call without drawing them (fast-forward, or
+// catching up after a stall), drawing only the last one if 'render_last'.
+// Runs on the virtual clock, one tic per doomgeneric_Tick; on the real clock
+// game time jumps ahead and stays ahead. Returns the tics actually run,
+// fewer if the game quit on the way.
+EMSCRIPTEN_KEEPALIVE
+int DG_RunTics(int tics, int render_last) {
+  int start = gametic;
+  int real_clock = !virtual_clock;
+  int stalled;
+
+  if (real_clock) {
+    virtual_ms = DG_GetTicksMs();
+    virtual_clock = 1;
+  }
+
+  // Each tick runs at least one tic, so it is drawn if it can reach the
+  // target; a netgame waiting for its peers may run none, and is given up
+  // on after RUN_TICS_STALL ticks in a row without one
+  stalled = 0;
+  while (gametic - start < tics && stalled < RUN_TICS_STALL) {
+    int before = gametic;
+    screenvisible = render_last && gametic - start + 1 >= tics;
+    doomgeneric_Tick();
+    if (dg_quit_requested) {
+      break;
+    }
+    stalled = gametic == before ? stalled + 1 : 0;
+  }
+  screenvisible = true;
+
+  if (real_clock) {
+    clock_offset_ms = virtual_ms - emscripten_get_now();
+    virtual_clock = 0;
+  }
+
+  // Undrawn tics skip DG_DrawFrame, which refreshes the state block
+  DG_UpdateEngineState();
+  return gametic - start;
+}
 
 int DG_GetKey(int *pressed, unsigned char *key) {
   if (key_queue_read != key_queue_write) {
@@ -188,9 +188,15 @@ boolean I_ConsoleStdout(void) {
 // Modified for OpenTUI: Call JavaScript to properly exit the application
 //
 
+// Set once the game has asked to quit (or failed), so loops that run many
+// tics in one call (DG_RunTics) stop there
+boolean dg_quit_requested = false;
+
 void I_Quit(void) {
   atexit_listentry_t *entry;
 
+  dg_quit_requested = true;
+
   // Signal JavaScript to exit the application FIRST
   // This must happen before atexit handlers because they may prevent
   // this code from being reached (e.g., by calling exit() or longjmp)
@@ -226,6 +232,7 @@ void I_Error(char *error, ...) {
   } else {
     already_quitting = true;
   }
+  dg_quit_requested = true;
 
   // Message first.
   va_start(argptr, error);
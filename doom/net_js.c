@@ -0,0 +1,159 @@
+/**
+ * OpenTUI network module for doomgeneric
+ *
+ * A net_module_t that hands packets to JavaScript instead of a UDP
+ * socket. The JS side (src/doom-net.ts) moves them through shared-memory
+ * rings to other DOOM instances in the same process, or through a bridge
+ * worker to instances in other processes over a Unix socket.
+ *
+ * The build compiles this in place of net_sdl.c (-Dnet_sdl_module=
+ * net_js_module), so -server/-privateserver/-connect work unchanged.
+ * Nodes are small integers chosen by JS: a client's server is node 0,
+ * a server's clients are its link slots.
+ *
+ * Also provides NET_WaitForLaunch (normally in net_gui.c, which needs
+ * the textscreen library): wait without a GUI and let the controller
+ * launch the game once -nodes players have joined.
+ */
+
+// Include DOOM headers first to define 'boolean' type before emscripten's
+// macros
+#include "doomtype.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "net_client.h"
+#include "net_defs.h"
+#include "net_gui.h"
+#include "net_io.h"
+#include "net_packet.h"
+#include "net_server.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <emscripten.h>
+
+#define MAX_NODES 32
+
+// How long to block waiting for packets before looking again (ms)
+#define WAIT_MS 10
+
+extern net_module_t net_js_module;
+
+// One address per node, so the same node always gets the same pointer
+// (the client and server code compare addresses by pointer)
+static net_addr_t node_addrs[MAX_NODES];
+
+static net_addr_t *NET_JS_NodeAddress(int node) {
+  if (node < 0 || node >= MAX_NODES) {
+    return NULL;
+  }
+  node_addrs[node].module = &net_js_module;
+  node_addrs[node].handle = (void *)(intptr_t)node;
+  return &node_addrs[node];
+}
+
+static boolean NET_JS_Init(void) {
+  return EM_ASM_INT({ return typeof Module.netSend === 'function' ? 1 : 0; });
+}
+
+static void NET_JS_SendPacket(net_addr_t *addr, net_packet_t *packet) {
+  EM_ASM(
+      {
+        Module.netSend($0, HEAPU8.subarray($1, $1 + $2));
+      },
+      (int)(intptr_t)addr->handle, packet->data, packet->len);
+}
+
+static boolean NET_JS_RecvPacket(net_addr_t **addr, net_packet_t **packet) {
+  int length;
+  int node;
+  net_packet_t *result;
+
+  length = EM_ASM_INT({ return Module.netPeek(); });
+  if (length < 0) {
+    return false;
+  }
+
+  // Copied straight from the shared ring into the packet
+  result = NET_NewPacket(length);
+  node = EM_ASM_INT({ return Module.netRecv(HEAPU8.subarray($0, $0 + $1)); },
+                    result->data, length);
+  result->len = length;
+
+  *addr = NET_JS_NodeAddress(node);
+  if (*addr == NULL) {
+    // From a node we have no address for: dropped, not handed back
+    NET_FreePacket(result);
+    return false;
+  }
+  *packet = result;
+  return true;
+}
+
+static void NET_JS_AddrToString(net_addr_t *addr, char *buffer,
+                                int buffer_len) {
+  M_snprintf(buffer, buffer_len, "node %i", (int)(intptr_t)addr->handle);
+}
+
+static void NET_JS_FreeAddress(net_addr_t *addr) {
+  // Addresses live in node_addrs for the whole run
+  (void)addr;
+}
+
+static net_addr_t *NET_JS_ResolveAddress(char *address) {
+  int node = EM_ASM_INT(
+      {
+        if (typeof Module.netResolve !== 'function') return -1;
+        return Module.netResolve($0 ? UTF8ToString($0) : "");
+      },
+      address);
+  return NET_JS_NodeAddress(node);
+}
+
+net_module_t net_js_module = {
+    NET_JS_Init,        NET_JS_Init,         NET_JS_SendPacket,
+    NET_JS_RecvPacket,  NET_JS_AddrToString, NET_JS_FreeAddress,
+    NET_JS_ResolveAddress,
+};
+
+//
+// Wait for the server to launch the game. The controller (the first
+// player, normally the one hosting) launches as soon as the number of
+// players given with -nodes is reached.
+//
+void NET_WaitForLaunch(void) {
+  int expected_nodes = 0;
+  int nodes;
+  int i;
+
+  i = M_CheckParmWithArgs("-nodes", 1);
+  if (i > 0) {
+    expected_nodes = atoi(myargv[i + 1]);
+  }
+
+  printf("NET_WaitForLaunch: waiting for %i players\n", expected_nodes);
+
+  while (net_waiting_for_launch) {
+    NET_CL_Run();
+    NET_SV_Run();
+
+    if (!net_client_connected) {
+      I_Error("Lost connection to server");
+    }
+
+    if (net_client_received_wait_data && net_client_wait_data.is_controller &&
+        expected_nodes > 0) {
+      nodes = net_client_wait_data.num_players + net_client_wait_data.num_drones;
+      if (nodes >= expected_nodes) {
+        NET_CL_LaunchGame();
+        expected_nodes = 0;
+      }
+    }
+
+    // Block in JS until a packet arrives (Atomics.wait), not a busy loop
+    EM_ASM({ Module.netWait($0); }, WAIT_MS);
+  }
+}
@@ -0,0 +1,76 @@
+/**
+ * Shared WAD file class for doomgeneric
+ *
+ * Reads WAD files that JavaScript holds in memory (one buffer shared by
+ * every instance in the process) instead of a copy in this instance's
+ * virtual filesystem. Lumps are copied into the zone only when the game
+ * caches them, through Module.wadRead.
+ *
+ * JavaScript side (see src/doom-engine.ts):
+ *   Module.wadOpen(path)                -> handle, or -1 if not shared
+ *   Module.wadLength(handle)            -> size in bytes
+ *   Module.wadRead(handle, offset, len) -> Uint8Array view of the bytes
+ */
+
+// Include DOOM headers first to define 'boolean' type before emscripten's
+// macros
+#include "w_file.h"
+#include "z_zone.h"
+
+#include <emscripten.h>
+
+typedef struct {
+  wad_file_t wad;
+  int handle;
+} js_wad_file_t;
+
+extern wad_file_class_t js_wad_file;
+
+static wad_file_t *W_JS_OpenFile(char *path) {
+  js_wad_file_t *result;
+  int handle;
+
+  handle = EM_ASM_INT(
+      {
+        if (typeof Module.wadOpen !== 'function') return -1;
+        return Module.wadOpen(UTF8ToString($0));
+      },
+      path);
+
+  if (handle < 0) {
+    return NULL;
+  }
+
+  result = Z_Malloc(sizeof(js_wad_file_t), PU_STATIC, 0);
+  result->wad.file_class = &js_wad_file;
+  result->wad.mapped = NULL;
+  result->wad.length = EM_ASM_INT({ return Module.wadLength($0); }, handle);
+  result->handle = handle;
+
+  return &result->wad;
+}
+
+static void W_JS_CloseFile(wad_file_t *wad) {
+  Z_Free(wad);
+}
+
+static size_t W_JS_Read(wad_file_t *wad, unsigned int offset, void *buffer,
+                        size_t buffer_len) {
+  js_wad_file_t *js_wad = (js_wad_file_t *)wad;
+
+  // Copy straight from the shared buffer into linear memory
+  return EM_ASM_INT(
+      {
+        var bytes = Module.wadRead($0, $1 >>> 0, $3 >>> 0);
+        if (!bytes) return 0;
+        HEAPU8.set(bytes, $2);
+        return bytes.length;
+      },
+      js_wad->handle, offset, buffer, buffer_len);
+}
+
+wad_file_class_t js_wad_file = {
+    W_JS_OpenFile,
+    W_JS_CloseFile,
+    W_JS_Read,
+};
@@ -6,7 +6,22 @@ set -e
 SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
 PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
 DOOM_DIR="$PROJECT_ROOT/doom"
-BUILD_DIR="$PROJECT_ROOT/doom/build"
+# Variant builds (e.g. to compare with scripts/desync-check.ts) can go elsewhere:
+#   DOOM_BUILD_DIR=doom/build-simd DOOM_CFLAGS="-O3 -msimd128" ./scripts/build-doom.sh
+# A profiling build keeps WASM function names and writes a symbol map for
+# the sampling profiler (bun run dev -- --profile FILE --build-dir doom/build-profile):
+#   DOOM_PROFILE=1 ./scripts/build-doom.sh
+DOOM_LDFLAGS=""
+if [ -n "$DOOM_PROFILE" ]; then
+    DOOM_LDFLAGS="--profiling-funcs --emit-symbol-map"
+    DOOM_BUILD_DIR="${DOOM_BUILD_DIR:-$PROJECT_ROOT/doom/build-profile}"
+fi
+BUILD_DIR="${DOOM_BUILD_DIR:-$PROJECT_ROOT/doom/build}"
+case "$BUILD_DIR" in
+    /*) ;;
+    *) BUILD_DIR="$PWD/$BUILD_DIR" ;;
+esac
+DOOM_CFLAGS="${DOOM_CFLAGS:--O2}"
 
 echo "=== DOOM OpenTUI Build Script ==="
 
@@ -37,19 +52,105 @@ mkdir -p "$BUILD_DIR"
 # Copy our platform file, sound bridge, and custom files
 cp "$DOOM_DIR/doomgeneric_opentui.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
 cp "$DOOM_DIR/doom_js_sound_bridge.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/doom_js_automap.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/doom_js_hud.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/doom_js_hud.h" "$DOOM_DIR/doomgeneric/doomgeneric/"
 cp "$DOOM_DIR/i_sound.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
 cp "$DOOM_DIR/s_sound.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
 cp "$DOOM_DIR/i_system.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/w_file.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/w_file_js.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/net_js.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/doom_js_demo.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/doom_js_demo.h" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/doom_js_step.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/doom_js_hash.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/doom_js_state.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/doom_js_level.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/doom_js_level.h" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/doom_js_view.c" "$DOOM_DIR/doomgeneric/doomgeneric/"
+cp "$DOOM_DIR/doom_js_view.h" "$DOOM_DIR/doomgeneric/doomgeneric/"
 
 echo "Compiling DOOM to WebAssembly..."
 cd "$DOOM_DIR/doomgeneric/doomgeneric"
 
+# Wrap each loading stage of P_SetupLevel in DG_LEVEL_STAGE (doom_js_level.h)
+# so it is timed; patched in place once, the clone keeps the result
+if ! grep -q DG_LEVEL_STAGE p_setup.c; then
+    sed -E -i.orig \
+        '/^(void[[:space:]]+)?P_SetupLevel/,/^}/ s/(P_Load[A-Za-z]+|P_GroupLines|P_SpawnSpecials|R_PrecacheLevel) ?\(([^;]*)\);/DG_LEVEL_STAGE(\1, (\2));/' \
+        p_setup.c
+    { echo '#include "doom_js_level.h"'; cat p_setup.c; } > p_setup.c.new
+    mv p_setup.c.new p_setup.c
+    rm -f p_setup.c.orig
+    if ! grep -q "DG_LEVEL_STAGE(P_LoadBlockMap" p_setup.c; then
+        echo "Error: P_SetupLevel in p_setup.c does not look as expected"
+        exit 1
+    fi
+fi
+
+# Draw the player view through DG_RenderPlayerView (doom_js_view.h), so it
+# can be interpolated between tics
+if ! grep -q DG_RenderPlayerView d_main.c; then
+    sed -E -i.orig 's/R_RenderPlayerView ?\(/DG_RenderPlayerView(/' d_main.c
+    { echo '#include "doom_js_view.h"'; cat d_main.c; } > d_main.c.new
+    mv d_main.c.new d_main.c
+    rm -f d_main.c.orig
+    if ! grep -q "DG_RenderPlayerView(&players" d_main.c; then
+        echo "Error: D_Display in d_main.c does not look as expected"
+        exit 1
+    fi
+fi
+
+# Offer the player's message to the text HUD (doom_js_hud.h) before
+# hu_stuff takes it, leaving the showMessages setting to the player
+if ! grep -q DG_HudTakeMessage hu_stuff.c; then
+    sed -E -i.orig \
+        's/if ?\(showMessages \|\| message_dontfuckwithme\)/if (!DG_HudTakeMessage(plr) \&\& (showMessages || message_dontfuckwithme))/' \
+        hu_stuff.c
+    { echo '#include "doom_js_hud.h"'; cat hu_stuff.c; } > hu_stuff.c.new
+    mv hu_stuff.c.new hu_stuff.c
+    rm -f hu_stuff.c.orig
+    if ! grep -q "if (!DG_HudTakeMessage(plr)" hu_stuff.c; then
+        echo "Error: HU_Ticker in hu_stuff.c does not look as expected"
+        exit 1
+    fi
+fi
+
+# End a timedemo through DG_TimeDemoDone (doom_js_demo.h) rather than the
+# I_Error vanilla reports the result with, so it is not shown as an error
+if ! grep -q DG_TimeDemoDone g_game.c; then
+    sed -E -i.orig \
+        '/I_Error ?\("timed %i gametics/ { N; s/I_Error ?\("timed[^;]*;/DG_TimeDemoDone(gametic, realtics);/ }' \
+        g_game.c
+    { echo '#include "doom_js_demo.h"'; cat g_game.c; } > g_game.c.new
+    mv g_game.c.new g_game.c
+    rm -f g_game.c.orig
+    if ! grep -q "DG_TimeDemoDone(gametic, realtics);" g_game.c; then
+        echo "Error: G_CheckDemoStatus in g_game.c does not look as expected"
+        exit 1
+    fi
+fi
+
+# The vector automap (doom_js_automap.c) follows the automap's own window,
+# zoom and cheat level, so those am_map.c variables lose their static
+if grep -Eq '^static[[:space:]]+(int|fixed_t|boolean)[[:space:]]+(cheating|scale_mtof|followplayer)' am_map.c; then
+    sed -E -i.orig \
+        's/^static([[:space:]]+(int|fixed_t|boolean)[[:space:]]+(cheating|f_w|m_x, m_y|m_w|m_h|scale_mtof|followplayer)[[:space:]]*[=;])/\1/' \
+        am_map.c
+    rm -f am_map.c.orig
+    if [ "$(grep -Ec '^[[:space:]]+(int|fixed_t|boolean)[[:space:]]+(cheating|f_w|m_x, m_y|m_w|m_h|scale_mtof|followplayer)[[:space:]]*[=;]' am_map.c)" != 7 ]; then
+        echo "Error: am_map.c does not look as expected"
+        exit 1
+    fi
+fi
+
 # Compile with Emscripten
-emcc -O2 \
+emcc $DOOM_CFLAGS $DOOM_LDFLAGS \
     -s WASM=1 \
     -s USE_SDL=2 \
-    -s EXPORTED_FUNCTIONS="['_doomgeneric_Create','_doomgeneric_Tick','_DG_GetFrameBuffer','_DG_PushKeyEvent','_malloc','_free']" \
-    -s EXPORTED_RUNTIME_METHODS="['ccall','cwrap','getValue','setValue','FS']" \
+    -s EXPORTED_FUNCTIONS="['_doomgeneric_Create','_doomgeneric_Tick','_DG_GetFrameBuffer','_DG_PushKeyEvent','_DG_IsAutomapActive','_DG_GetAutomapLines','_DG_SetTextHud','_DG_GetHudState','_DG_SetVirtualClock','_DG_GetDemoState','_DG_SetDemoLimit','_DG_GetObservation','_DG_GetStepVars','_DG_GetStateHash','_DG_GetEngineState','_DG_RunTics','_DG_GetLevelTimings','_DG_SetSteadyPalette','_DG_SetUncapped','_DG_RenderView','_malloc','_free']" \
+    -s EXPORTED_RUNTIME_METHODS="['ccall','cwrap','getValue','setValue','FS','HEAPU8','HEAP32','HEAPU32','stackSave','stackRestore']" \
     -s ALLOW_MEMORY_GROWTH=1 \
     -s INITIAL_MEMORY=33554432 \
     -s MODULARIZE=1 \
@@ -62,6 +163,8 @@ emcc -O2 \
     -DDOOMGENERIC_RESX=1280 \
     -DDOOMGENERIC_RESY=800 \
     -DFEATURE_SOUND \
+    -DFEATURE_MULTIPLAYER \
+    -Dnet_sdl_module=net_js_module \
     -I. \
     am_map.c \
     d_event.c \
@@ -102,6 +205,15 @@ emcc -O2 \
     m_misc.c \
     m_random.c \
     memio.c \
+    net_client.c \
+    net_common.c \
+    net_dedicated.c \
+    net_io.c \
+    net_loop.c \
+    net_packet.c \
+    net_query.c \
+    net_server.c \
+    net_structrw.c \
     p_ceilng.c \
     p_doors.c \
     p_enemy.c \
@@ -140,12 +252,22 @@ emcc -O2 \
     w_checksum.c \
     w_file.c \
     w_file_stdc.c \
+    w_file_js.c \
     w_main.c \
     w_wad.c \
     wi_stuff.c \
     z_zone.c \
     dummy.c \
     doom_js_sound_bridge.c \
+    doom_js_automap.c \
+    doom_js_hud.c \
+    net_js.c \
+    doom_js_demo.c \
+    doom_js_step.c \
+    doom_js_hash.c \
+    doom_js_state.c \
+    doom_js_level.c \
+    doom_js_view.c \
     -o "$BUILD_DIR/doom.js"
 
 echo "Build complete!"
@@ -0,0 +1,156 @@
+#!/usr/bin/env bun
+/**
+ * Demo sync check between two builds
+ *
+ * Replays a demo on two builds of doom.wasm in lockstep (e.g. -O2 and a
+ * SIMD variant, see DOOM_BUILD_DIR in build-doom.sh), hashing the playsim
+ * state after every tic, and reports the first tic where they disagree and
+ * which part of the state diverged. Instead of a second build, a trace
+ * written earlier (or by another port, e.g. a native build printing the
+ * same fields) can be compared.
+ *
+ * Usage:
+ *   bun scripts/desync-check.ts --wad doom1.wad --demo demo.lmp --a doom/build --b doom/build-simd
+ *   bun scripts/desync-check.ts --wad doom1.wad --demo demo.lmp --trace-out base.trace
+ *   bun scripts/desync-check.ts --wad doom1.wad --demo demo.lmp --trace-in base.trace
+ *
+ * Trace lines: tic, then total, mobjs, sectors, players hashes (hex), RNG
+ * index and map object count.
+ */
+
+import { parseArgs } from "util";
+import { readFileSync, writeFileSync } from "fs";
+import { DoomEngine, StateHash, STATE_HASH_SIZE } from "../src/doom-engine";
+import { readDemoFile, readSessionRecording } from "../src/doom-record";
+
+const { values } = parseArgs({
+  args: Bun.argv.slice(2),
+  options: {
+    wad: { type: "string", short: "w", default: "doom1.wad" },
+    demo: { type: "string", short: "d" },
+    a: { type: "string", default: "doom/build" },
+    b: { type: "string" },
+    "trace-in": { type: "string" },
+    "trace-out": { type: "string" },
+  },
+});
+
+if (!values.demo || (!values.b && !values["trace-in"] && !values["trace-out"])) {
+  console.error(
+    "Usage: desync-check.ts --demo FILE [--a DIR] (--b DIR | --trace-in F | --trace-out F)"
+  );
+  process.exit(1);
+}
+
+// Plain demo lumps, or the demo inside a session recording
+const demo = values.demo.endsWith(".drec")
+  ? readSessionRecording(values.demo).demo
+  : readDemoFile(values.demo);
+if (!demo) {
+  console.error(`${values.demo} has no demo`);
+  process.exit(1);
+}
+
+const FIELDS = ["total", "mobjs", "sectors", "players", "rng", "mobj count"];
+
+interface Replay {
+  engine: DoomEngine;
+  ended: boolean;
+}
+
+async function startReplay(buildDir: string): Promise<Replay> {
+  const replay: Replay = { engine: null!, ended: false };
+  replay.engine = new DoomEngine({
+    wadPath: values.wad!,
+    buildDir,
+    audio: false,
+    saves: false,
+    playDemo: demo!,
+    virtualClock: true,
+    print: () => {},
+    onQuit: () => (replay.ended = true),
+  });
+  await replay.engine.init();
+  return replay;
+}
+
+function formatTrace(tic: number, hash: ArrayLike<number>): string {
+  const hex = (value: number) => value.toString(16).padStart(8, "0");
+  return [
+    tic,
+    hex(hash[StateHash.TOTAL]!),
+    hex(hash[StateHash.MOBJS]!),
+    hex(hash[StateHash.SECTORS]!),
+    hex(hash[StateHash.PLAYERS]!),
+    hash[StateHash.RNG],
+    hash[StateHash.MOBJ_COUNT],
+  ].join(" ");
+}
+
+function parseTrace(line: string): [number, number[]] {
+  const [tic, ...fields] = line.trim().split(/\s+/);
+  return [
+    parseInt(tic!, 10),
+    fields.map((field, i) => (i < 4 ? parseInt(field, 16) : parseInt(field, 10))),
+  ];
+}
+
+const a = await startReplay(values.a!);
+const b = values.b ? await startReplay(values.b) : null;
+const expected = values["trace-in"]
+  ? readFileSync(values["trace-in"], "utf8")
+      .split("\n")
+      .filter((line) => line.trim())
+  : null;
+const traceOut: string[] = [];
+
+const other = new Uint32Array(STATE_HASH_SIZE);
+let step = 0;
+let result = "in sync";
+for (;;) {
+  // Hashes only: nothing needs to be drawn
+  a.engine.runTics(1);
+  b?.engine.runTics(1);
+  if (a.ended || b?.ended) {
+    if (b && a.ended !== b.ended) {
+      result = `build ${a.ended ? "A" : "B"} ended the demo first, after ${step} tics`;
+    }
+    break;
+  }
+
+  const tic = a.engine.getGameTic();
+  const hash = a.engine.getStateHash()!;
+  if (values["trace-out"]) traceOut.push(formatTrace(tic, hash));
+
+  let label = "B";
+  if (b) {
+    other.set(b.engine.getStateHash()!);
+  } else if (expected) {
+    label = "trace";
+    const line = expected[step];
+    if (line === undefined) {
+      result = `the trace ends after ${step} tics, the demo goes on`;
+      break;
+    }
+    other.set(parseTrace(line)[1]);
+  }
+
+  if ((b || expected) && hash[StateHash.TOTAL] !== other[StateHash.TOTAL]) {
+    const parts = FIELDS.filter((_, i) => i > 0 && hash[i] !== other[i]);
+    const what = parts.join(", ") || "game state";
+    result = [
+      `DESYNC at tic ${tic} (tic ${step + 1} of the demo): ${what} differ`,
+      `  ${"A".padEnd(6)} ${formatTrace(tic, hash)}`,
+      `  ${label.padEnd(6)} ${formatTrace(tic, other)}`,
+    ].join("\n");
+    break;
+  }
+  step++;
+}
+
+if (values["trace-out"]) {
+  writeFileSync(values["trace-out"], traceOut.join("\n") + "\n");
+  console.log(`Wrote ${traceOut.length} tics to ${values["trace-out"]}`);
+}
+if (b || expected) console.log(`${step} tics compared: ${result}`);
+process.exit(result === "in sync" ? 0 : 1);
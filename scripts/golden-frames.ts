@@ -0,0 +1,245 @@
+#!/usr/bin/env bun
+/**
+ * Golden-frame regression harness
+ *
+ * Plays a demo headlessly on the virtual clock, composing the terminal
+ * cell grid every tic exactly as the game loop does, and hashes selected
+ * frames: the raw framebuffer (DG_ScreenBuffer) and the final cell grid.
+ * The hashes are saved as goldens once, then later runs compare against
+ * them, so scaler, sampler and encoder optimizations can be checked for
+ * unchanged output. Every tic is timed along the way.
+ *
+ * Usage:
+ *   bun scripts/golden-frames.ts --wad doom1.wad --demo demo.lmp --goldens demo.json --update
+ *   bun scripts/golden-frames.ts --wad doom1.wad --demo demo.lmp --goldens demo.json
+ *
+ * --every N captures every Nth tic (default 35), --tics 10,200 adds
+ * specific ones. --dump DIR writes each captured frame (on --update) or
+ * each mismatching one as a 320x200 PPM and a cat-able ANSI cell dump.
+ */
+
+import { parseArgs } from "util";
+import { existsSync, mkdirSync, readFileSync, writeFileSync } from "fs";
+import { join } from "path";
+import {
+  DOOM_WIDTH,
+  DoomEngine,
+  NATIVE_HEIGHT,
+  NATIVE_WIDTH,
+} from "../src/doom-engine";
+import { createCellGrid, type CellGrid } from "../src/doom-cells";
+import { createFrameComposer } from "../src/doom-frame";
+import { createAnsiEncoder } from "../src/doom-ansi";
+import { readDemoFile, readSessionRecording } from "../src/doom-record";
+
+const GOLDENS_VERSION = 1;
+
+const { values } = parseArgs({
+  args: Bun.argv.slice(2),
+  options: {
+    wad: { type: "string", short: "w", default: "doom1.wad" },
+    demo: { type: "string", short: "d" },
+    goldens: { type: "string", short: "g" },
+    update: { type: "boolean", short: "u", default: false },
+    every: { type: "string", default: "35" },
+    tics: { type: "string" },
+    cols: { type: "string", default: "160" },
+    rows: { type: "string", default: "50" },
+    hud: { type: "string", default: "text" },
+    automap: { type: "string", default: "vector" },
+    dump: { type: "string" },
+  },
+});
+
+if (!values.demo || !values.goldens) {
+  console.error("Usage: golden-frames.ts --demo FILE --goldens FILE [--update] [--every N]");
+  process.exit(1);
+}
+
+const demo = values.demo.endsWith(".drec")
+  ? readSessionRecording(values.demo).demo
+  : readDemoFile(values.demo);
+if (!demo) {
+  console.error(`${values.demo} has no demo`);
+  process.exit(1);
+}
+
+interface GoldenFrame {
+  screen: string; // Hash of the raw framebuffer
+  cells: string; // Hash of the composed cell grid
+}
+
+interface Goldens {
+  version: number;
+  demo: string;
+  cols: number;
+  rows: number;
+  hud: string;
+  automap: string;
+  frames: Record<string, GoldenFrame>; // By demo tic (1 = first tic played)
+}
+
+const cols = Math.max(1, parseInt(values.cols!, 10) || 160);
+const rows = Math.max(1, parseInt(values.rows!, 10) || 50);
+const every = Math.max(0, parseInt(values.every!, 10) || 0);
+const extraTics = new Set(
+  (values.tics ?? "")
+    .split(",")
+    .map((tic) => parseInt(tic, 10))
+    .filter((tic) => tic > 0)
+);
+
+// The grid depends on these, so goldens only compare under the same settings
+const settings = { cols, rows, hud: values.hud!, automap: values.automap! };
+
+let goldens: Goldens | null = null;
+if (!values.update) {
+  if (!existsSync(values.goldens)) {
+    console.error(`${values.goldens} does not exist (create it with --update)`);
+    process.exit(1);
+  }
+  goldens = JSON.parse(readFileSync(values.goldens, "utf8")) as Goldens;
+  if (goldens.version !== GOLDENS_VERSION) {
+    console.error(`${values.goldens}: unsupported goldens version ${goldens.version}`);
+    process.exit(1);
+  }
+  for (const [key, value] of Object.entries(settings)) {
+    if (goldens[key as keyof typeof settings] !== value) {
+      console.error(`${values.goldens} was made with --${key} ${goldens[key as keyof Goldens]}`);
+      process.exit(1);
+    }
+  }
+}
+
+function isCaptured(tic: number): boolean {
+  if (goldens) return tic in goldens.frames;
+  return (every > 0 && tic % every === 0) || extraTics.has(tic);
+}
+
+function hex(hash: bigint | number): string {
+  return BigInt(hash).toString(16).padStart(16, "0");
+}
+
+function hashGrid(grid: CellGrid): string {
+  let hash = Bun.hash(grid.chars);
+  hash = Bun.hash(grid.fg, hash);
+  hash = Bun.hash(grid.bg, hash);
+  return hex(hash);
+}
+
+// Native-resolution PPM: the centre pixel of each scaled-up block
+function writeScreenImage(path: string, pixels: Uint32Array): void {
+  const scale = DOOM_WIDTH / NATIVE_WIDTH;
+  const header = Buffer.from(`P6\n${NATIVE_WIDTH} ${NATIVE_HEIGHT}\n255\n`);
+  const rgb = Buffer.alloc(NATIVE_WIDTH * NATIVE_HEIGHT * 3);
+  let out = 0;
+  for (let y = 0; y < NATIVE_HEIGHT; y++) {
+    const row = (y * scale + (scale >> 1)) * DOOM_WIDTH + (scale >> 1);
+    for (let x = 0; x < NATIVE_WIDTH; x++) {
+      const pixel = pixels[row + x * scale]!;
+      rgb[out++] = (pixel >> 16) & 0xff;
+      rgb[out++] = (pixel >> 8) & 0xff;
+      rgb[out++] = pixel & 0xff;
+    }
+  }
+  writeFileSync(path, Buffer.concat([header, rgb]));
+}
+
+function writeCellDump(path: string, grid: CellGrid): void {
+  writeFileSync(path, createAnsiEncoder().encode(grid, true) + "\x1b[0m\n");
+}
+
+function dumpFrame(tic: number, pixels: Uint32Array, grid: CellGrid): void {
+  if (!values.dump) return;
+  mkdirSync(values.dump, { recursive: true });
+  const name = join(values.dump, `tic-${String(tic).padStart(6, "0")}`);
+  writeScreenImage(`${name}.screen.ppm`, pixels);
+  writeCellDump(`${name}.cells.ans`, grid);
+}
+
+function percentiles(samples: number[]): string {
+  const sorted = [...samples].sort((a, b) => a - b);
+  const at = (p: number) => sorted[Math.min(sorted.length - 1, Math.floor(p * sorted.length))] ?? 0;
+  const mean = sorted.reduce((sum, value) => sum + value, 0) / Math.max(1, sorted.length);
+  return [
+    `mean ${mean.toFixed(3)}`,
+    `p50 ${at(0.5).toFixed(3)}`,
+    `p95 ${at(0.95).toFixed(3)}`,
+    `max ${(sorted[sorted.length - 1] ?? 0).toFixed(3)} ms`,
+  ].join(", ");
+}
+
+let ended = false;
+const engine = new DoomEngine({
+  wadPath: values.wad!,
+  audio: false,
+  saves: false,
+  playDemo: demo,
+  virtualClock: true,
+  print: () => {},
+  onQuit: () => (ended = true),
+});
+await engine.init();
+
+const textHud = settings.hud === "text";
+if (textHud) engine.setTextHud(true);
+const composer = createFrameComposer({ vectorAutomap: settings.automap === "vector", textHud });
+const grid = createCellGrid(cols, rows);
+
+const frames: Record<string, GoldenFrame> = {};
+const tickMs: number[] = [];
+const composeMs: number[] = [];
+const mismatches: string[] = [];
+let tic = 0;
+
+for (;;) {
+  const tickStart = performance.now();
+  engine.tick();
+  const composeStart = performance.now();
+  if (ended) break;
+  composer.compose(engine, grid);
+  const composeEnd = performance.now();
+  tickMs.push(composeStart - tickStart);
+  composeMs.push(composeEnd - composeStart);
+  tic++;
+
+  if (!isCaptured(tic)) continue;
+  const pixels = engine.getFrameBufferView()!;
+  const frame: GoldenFrame = { screen: hex(Bun.hash(pixels)), cells: hashGrid(grid) };
+  frames[tic] = frame;
+
+  if (!goldens) {
+    dumpFrame(tic, pixels, grid);
+    continue;
+  }
+  const golden = goldens.frames[tic]!;
+  const differ = (["screen", "cells"] as const).filter((part) => golden[part] !== frame[part]);
+  if (differ.length) {
+    mismatches.push(`  tic ${tic}: ${differ.join(" and ")} differ`);
+    dumpFrame(tic, pixels, grid);
+  }
+}
+
+console.log(`${tic} tics played, ${Object.keys(frames).length} frames captured`);
+console.log(`  tick:    ${percentiles(tickMs)}`);
+console.log(`  compose: ${percentiles(composeMs)}`);
+
+if (!goldens) {
+  const output: Goldens = { version: GOLDENS_VERSION, demo: values.demo, ...settings, frames };
+  writeFileSync(values.goldens, JSON.stringify(output, null, 2) + "\n");
+  console.log(`Wrote ${Object.keys(frames).length} goldens to ${values.goldens}`);
+  process.exit(0);
+}
+
+const missing = Object.keys(goldens.frames).filter((key) => !(key in frames));
+if (missing.length) {
+  mismatches.push(`  the demo ended before tic ${missing.join(", ")}`);
+}
+if (mismatches.length) {
+  console.log(`FAIL: ${mismatches.length} of ${Object.keys(goldens.frames).length} frames`);
+  console.log(mismatches.join("\n"));
+  if (values.dump) console.log(`Frames written to ${values.dump}`);
+  process.exit(1);
+}
+console.log(`OK: all ${Object.keys(goldens.frames).length} frames match`);
+process.exit(0);
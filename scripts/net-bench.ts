@@ -0,0 +1,103 @@
+#!/usr/bin/env bun
+/**
+ * Loopback netgame benchmark
+ *
+ * Starts a host and N-1 clients in one process (one worker each) on a
+ * shared board, lets the game run, then reports transport throughput and
+ * delivery latency per client link.
+ *
+ * Usage: bun scripts/net-bench.ts --wad doom1.wad --players 4 --seconds 10
+ */
+
+import { parseArgs } from "util";
+import { compileDoomModule, loadSharedWad } from "../src/doom-engine";
+import {
+  createNetBoard,
+  formatNetStats,
+  getNetStats,
+  netNow,
+  type NetDirectionStats,
+  type NetLinkStats,
+} from "../src/doom-net";
+import type { NetNodeMessage, NetNodeRequest } from "../src/doom-net-node";
+
+const { values } = parseArgs({
+  args: Bun.argv.slice(2),
+  options: {
+    wad: { type: "string", short: "w", default: "doom1.wad" },
+    players: { type: "string", short: "p", default: "2" },
+    seconds: { type: "string", short: "s", default: "10" },
+    deathmatch: { type: "boolean", default: false },
+  },
+});
+
+const players = Math.max(2, parseInt(values.players!, 10) || 2);
+const seconds = Math.max(1, parseFloat(values.seconds!) || 10);
+
+const board = createNetBoard();
+const [sharedWad, wasmModule] = await Promise.all([
+  loadSharedWad(values.wad!),
+  compileDoomModule(),
+]);
+
+// Host first, then the clients; each resolves once the game has launched
+const workers: Worker[] = [];
+const launched: Promise<void>[] = [];
+for (let i = 0; i < players; i++) {
+  const worker = new Worker(new URL("../src/doom-net-node.ts", import.meta.url).href);
+  workers.push(worker);
+  launched.push(
+    new Promise((resolveLaunch, rejectLaunch) => {
+      worker.onmessage = (event: MessageEvent<NetNodeMessage>) => {
+        if (event.data.type === "launched") resolveLaunch();
+        else rejectLaunch(new Error(event.data.message));
+      };
+    })
+  );
+  worker.postMessage({
+    role: i === 0 ? "host" : "client",
+    board,
+    wadPath: values.wad!,
+    sharedWad,
+    wasmModule,
+    players,
+    deathmatch: values.deathmatch,
+  } satisfies NetNodeRequest);
+}
+
+console.log(`Waiting for ${players} players to join...`);
+const joinStart = netNow();
+await Promise.all(launched);
+console.log(`Game launched after ${(netNow() - joinStart).toFixed(0)} ms`);
+
+// Measure steady state only: subtract what the join handshake sent
+const before = getNetStats(board);
+const start = netNow();
+await Bun.sleep(seconds * 1000);
+const after = getNetStats(board);
+const elapsed = netNow() - start;
+
+function minus(a: NetDirectionStats, b: NetDirectionStats | undefined): NetDirectionStats {
+  if (!b) return a;
+  const received = a.received - b.received;
+  return {
+    packets: a.packets - b.packets,
+    bytes: a.bytes - b.bytes,
+    dropped: a.dropped - b.dropped,
+    received,
+    latencyAvgMs:
+      received > 0 ? (a.latencyAvgMs * a.received - b.latencyAvgMs * b.received) / received : 0,
+    latencyMaxMs: a.latencyMaxMs,
+  };
+}
+
+const steady: NetLinkStats[] = after.map((link) => {
+  const old = before.find((b) => b.node === link.node);
+  return { node: link.node, up: minus(link.up, old?.up), down: minus(link.down, old?.down) };
+});
+
+console.log(`\n${players} players, ${(elapsed / 1000).toFixed(1)} s:`);
+console.log(formatNetStats(steady, elapsed));
+
+for (const worker of workers) worker.terminate();
+process.exit(0);
@@ -0,0 +1,73 @@
+#!/usr/bin/env bun
+/**
+ * Programmatic stepping benchmark
+ *
+ * Drives one headless engine through DoomEngine.step() with random packed
+ * actions, as an automated agent would, and reports steps and game tics per
+ * second (including the observation and game variables of every step).
+ *
+ * Usage: bun scripts/step-bench.ts --wad doom1.wad --tics 4 --shrink 2 --seconds 10
+ */
+
+import { parseArgs } from "util";
+import { DoomAction, DoomEngine, StepVar } from "../src/doom-engine";
+
+const { values } = parseArgs({
+  args: Bun.argv.slice(2),
+  options: {
+    wad: { type: "string", short: "w", default: "doom1.wad" },
+    tics: { type: "string", short: "t", default: "4" },
+    shrink: { type: "string", default: "2" },
+    gray: { type: "boolean", default: false },
+    seconds: { type: "string", short: "s", default: "10" },
+  },
+});
+
+const tics = Math.max(1, parseInt(values.tics!, 10) || 4);
+const seconds = Math.max(1, parseFloat(values.seconds!) || 10);
+
+const engine = new DoomEngine({
+  wadPath: values.wad!,
+  audio: false,
+  saves: false,
+  virtualClock: true,
+  observation: { shrink: parseInt(values.shrink!, 10) || 2, gray: values.gray },
+  args: ["-warp", "1", "1", "-skill", "3"],
+  print: () => {},
+});
+await engine.init();
+
+// Movement and fire only: weapon switches would make most steps no-ops
+const MOVES = [
+  DoomAction.FORWARD,
+  DoomAction.FORWARD | DoomAction.TURN_LEFT,
+  DoomAction.FORWARD | DoomAction.TURN_RIGHT,
+  DoomAction.FORWARD | DoomAction.FIRE,
+  DoomAction.BACKWARD,
+  DoomAction.STRAFE_LEFT | DoomAction.FIRE,
+  DoomAction.STRAFE_RIGHT | DoomAction.USE,
+  DoomAction.TURN_LEFT | DoomAction.RUN,
+];
+
+let steps = 0;
+let checksum = 0; // Keeps the observation reads from being optimized away
+let deaths = 0;
+const start = performance.now();
+const end = start + seconds * 1000;
+while (performance.now() < end) {
+  const { frame, gamevars } = engine.step(MOVES[(Math.random() * MOVES.length) | 0]!, tics);
+  checksum = (checksum + frame[(steps * 7919) % frame.length]!) | 0;
+  if (!gamevars[StepVar.ALIVE]) {
+    deaths++;
+    engine.step(DoomAction.USE, 1); // Respawn
+  }
+  steps++;
+}
+const elapsed = (performance.now() - start) / 1000;
+
+const { width, height, channels } = engine.step(0, 1);
+console.log(`${width}x${height}x${channels} observations, ${tics} tics per step:`);
+const ticRate = (steps * tics) / elapsed;
+console.log(`  ${(steps / elapsed).toFixed(0)} steps/s, ${ticRate.toFixed(0)} tics/s`);
+console.log(`  ${steps} steps in ${elapsed.toFixed(1)} s, ${deaths} deaths (checksum ${checksum})`);
+process.exit(0);
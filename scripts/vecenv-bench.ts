@@ -0,0 +1,76 @@
+#!/usr/bin/env bun
+/**
+ * Vectorized environment benchmark
+ *
+ * Steps a batch of environments in lockstep with random actions and
+ * reports environment steps and game tics per second. With --sweep it
+ * repeats the run for 1, 2, 4, ... workers to show how it scales.
+ *
+ * Usage: bun scripts/vecenv-bench.ts --wad doom1.wad --envs 16 --workers 8 --seconds 10
+ */
+
+import { parseArgs } from "util";
+import { availableParallelism } from "os";
+import { DoomAction } from "../src/doom-engine";
+import { createVecEnv } from "../src/doom-vecenv";
+
+const { values } = parseArgs({
+  args: Bun.argv.slice(2),
+  options: {
+    wad: { type: "string", short: "w", default: "doom1.wad" },
+    envs: { type: "string", short: "n", default: "16" },
+    workers: { type: "string" },
+    tics: { type: "string", short: "t", default: "4" },
+    seconds: { type: "string", short: "s", default: "10" },
+    sweep: { type: "boolean", default: false },
+  },
+});
+
+const envs = Math.max(1, parseInt(values.envs!, 10) || 16);
+const tics = Math.max(1, parseInt(values.tics!, 10) || 4);
+const seconds = Math.max(1, parseFloat(values.seconds!) || 10);
+const maxWorkers = Math.min(envs, parseInt(values.workers ?? "", 10) || availableParallelism());
+
+const ACTIONS = [
+  DoomAction.FORWARD,
+  DoomAction.FORWARD | DoomAction.TURN_LEFT,
+  DoomAction.FORWARD | DoomAction.TURN_RIGHT,
+  DoomAction.FORWARD | DoomAction.FIRE,
+  DoomAction.STRAFE_LEFT | DoomAction.FIRE,
+  DoomAction.USE,
+];
+
+async function run(workers: number): Promise<number> {
+  const vec = await createVecEnv({ wadPath: values.wad!, envs, workers });
+  let steps = 0;
+  const start = performance.now();
+  const end = start + seconds * 1000;
+  while (performance.now() < end) {
+    for (let env = 0; env < envs; env++) {
+      vec.actions[env] = ACTIONS[(Math.random() * ACTIONS.length) | 0]!;
+    }
+    vec.step(tics);
+    steps++;
+  }
+  const elapsed = (performance.now() - start) / 1000;
+  vec.close();
+
+  const rate = (steps * envs) / elapsed;
+  console.log(
+    `${String(workers).padStart(3)} workers: ${rate.toFixed(0).padStart(7)} env steps/s, ` +
+      `${(rate * tics).toFixed(0).padStart(8)} tics/s (${steps} batches)`
+  );
+  return rate;
+}
+
+console.log(`${envs} environments, ${tics} tics per step, ${seconds} s per run`);
+if (values.sweep) {
+  const base = await run(1);
+  for (let workers = 2; workers <= maxWorkers; workers *= 2) {
+    const rate = await run(workers);
+    console.log(`     speedup ${(rate / base).toFixed(2)}x`);
+  }
+} else {
+  await run(maxWorkers);
+}
+process.exit(0);
@@ -0,0 +1,98 @@
+/**
+ * DOOM ANSI Encoder
+ *
+ * Turns a cell grid into a truecolor escape stream for terminals that are
+ * not driven by OpenTUI (remote sessions). Only cells that changed since
+ * the previous frame are emitted, and colours are only re-sent when they
+ * differ from the current pen.
+ */
+
+import { createCellGrid, resizeCellGrid, type CellGrid } from "./doom-cells";
+import { glyph, sgrColor } from "./doom-glyphs";
+
+// Enter the alternate screen, hide the cursor and clear
+export const ANSI_SESSION_START = "\x1b[?1049h\x1b[?25l\x1b[0m\x1b[2J";
+// Reset attributes, show the cursor and leave the alternate screen
+export const ANSI_SESSION_END = "\x1b[0m\x1b[?25h\x1b[?1049l";
+
+export interface AnsiEncoder {
+  /** Encode the cells that changed since the last call (or every cell if full) */
+  encode: (grid: CellGrid, full?: boolean) => string;
+  /** Forget what the terminal shows, so the next encode is a full frame */
+  reset: () => void;
+  /** Cells written by the last encode */
+  readonly changedCells: number;
+}
+
+/**
+ * Create an encoder that remembers what the remote terminal shows
+ */
+export function createAnsiEncoder(): AnsiEncoder {
+  const shown = createCellGrid(0, 0);
+  let valid = false;
+  let changedCells = 0;
+
+  return {
+    get changedCells(): number {
+      return changedCells;
+    },
+
+    encode(grid: CellGrid, full: boolean = false): string {
+      if (shown.width !== grid.width || shown.height !== grid.height) {
+        resizeCellGrid(shown, grid.width, grid.height);
+        valid = false;
+      }
+      const diff = valid && !full;
+
+      const out: string[] = [];
+      let penFg = -1;
+      let penBg = -1;
+      let cursor = -1; // Cell index the terminal cursor is at, -1 if unknown
+
+      if (!diff) {
+        out.push("\x1b[0m\x1b[H");
+        cursor = 0;
+      }
+
+      const cells = grid.width * grid.height;
+      changedCells = 0;
+      for (let cell = 0; cell < cells; cell++) {
+        const ch = grid.chars[cell] ?? 0x20;
+        const fg = grid.fg[cell] ?? 0;
+        const bg = grid.bg[cell] ?? 0;
+        if (diff && shown.chars[cell] === ch && shown.fg[cell] === fg && shown.bg[cell] === bg) {
+          continue;
+        }
+        shown.chars[cell] = ch;
+        shown.fg[cell] = fg;
+        shown.bg[cell] = bg;
+        changedCells++;
+
+        if (cursor !== cell) {
+          const y = Math.floor(cell / grid.width);
+          const x = cell - y * grid.width;
+          out.push(`\x1b[${y + 1};${x + 1}H`);
+        }
+        if (fg !== penFg) {
+          out.push(sgrColor(38, fg));
+          penFg = fg;
+        }
+        if (bg !== penBg) {
+          out.push(sgrColor(48, bg));
+          penBg = bg;
+        }
+        out.push(glyph(ch));
+
+        // Writing the last column leaves the cursor in a pending-wrap state; re-position
+        cursor = (cell + 1) % grid.width === 0 ? -1 : cell + 1;
+      }
+
+      valid = true;
+      return out.join("");
+    },
+
+    reset(): void {
+      valid = false;
+    },
+  };
+}
@@ -3,13 +3,25 @@
  *
  * Handles audio playback using mpv with proper process management.
  * All spawned processes are tracked and terminated on shutdown.
+ *
+ * With the "pcm" output (setAudioOutput), effects and music are mixed
+ * in-process instead and streamed to one raw PCM player (see doom-pcm.ts),
+ * with music decoded in-process a window ahead rather than played by its
+ * own mpv.
  */
 
 import { spawn, ChildProcess } from "child_process";
 import { join } from "path";
-import { existsSync, unlinkSync } from "fs";
+import { existsSync, readFileSync, unlinkSync } from "fs";
 import { createConnection } from "net";
 import { debugLog } from "./debug";
+import {
+  createPcmSink,
+  decodeWav,
+  type MusicDecoding,
+  type PcmSink,
+  type PcmSound,
+} from "./doom-pcm";
 
 // Local helper to log with Audio category
 function log(message: string): void {
@@ -34,16 +46,49 @@ const musicSocketPath = "/tmp/doom-music-mpv.sock";
 // Whether audio is initialized
 let initialized = false;
 
+// Output chosen before initAudio, and the PCM sink if it is "pcm"
+export type AudioOutput = "mpv" | "pcm";
+let output: AudioOutput = "mpv";
+let musicDecoding: MusicDecoding = "builtin";
+let sink: PcmSink | null = null;
+
+// Sound effects decoded for the sink, by name (null if unreadable)
+const decodedSounds = new Map<string, PcmSound | null>();
+
 // Current music state for volume changes
 let currentMusicName: string | null = null;
 let _currentMusicLooping: boolean = false;
 
+/**
+ * Sound effect and music processes currently playing
+ */
+export function getActiveVoices(): number {
+  return activeProcesses.size + (sink?.voices() ?? 0);
+}
+
+/**
+ * Choose the output before initAudio: an mpv process per sound ("mpv",
+ * the default) or the in-process mix ("pcm"), and how "pcm" decodes music
+ */
+export function setAudioOutput(mode: AudioOutput, decoding: MusicDecoding = "builtin"): void {
+  output = mode;
+  musicDecoding = decoding;
+}
+
 /**
  * Initialize the audio system
  */
 export function initAudio(): void {
   if (initialized) return;
   initialized = true;
+  if (output === "pcm") {
+    sink = createPcmSink({ musicDecoding, log });
+    if (sink) {
+      sink.setMusicVolume(currentVolume);
+    } else {
+      log("No raw PCM player found (pacat or aplay), using mpv per sound");
+    }
+  }
   log(`Initialized, sound dir: ${soundDir}`);
 }
 
@@ -53,6 +98,9 @@ export function initAudio(): void {
 export function shutdownAudio(): void {
   if (!initialized) return;
 
+  sink?.close();
+  sink = null;
+
   // Kill music process
   if (musicProcess) {
     try {
@@ -123,9 +171,12 @@ function spawnMpv(filePath: string, options: string[] = []): ChildProcess | null
 /**
  * Play a sound effect
  * Sound files should be in sound/ds{name}.wav
- * Volume is 0-127 (DOOM standard)
+ * Volume is 0-127 (DOOM standard). Separation is DOOM's stereo position
+ * (0 = left, 128 = centre, 254 = right); the engine sends each effect once
+ * per tic, merged over every place it started from. mpv plays it centred;
+ * the PCM sink pans it.
  */
-export function playSound(name: string, volume: number = 127): void {
+export function playSound(name: string, volume: number = 127, separation: number = 128): void {
   if (!initialized) {
     log("playSound called but not initialized");
     return;
@@ -133,9 +184,20 @@ export function playSound(name: string, volume: number = 127): void {
 
   const soundPath = join(soundDir, `ds${name.toLowerCase()}.wav`);
 
+  if (sink) {
+    let sound = decodedSounds.get(soundPath);
+    if (sound === undefined) {
+      sound = existsSync(soundPath) ? decodeWav(readFileSync(soundPath)) : null;
+      if (!sound) log(`Cannot decode sound: ${soundPath}`);
+      decodedSounds.set(soundPath, sound);
+    }
+    if (sound) sink.playSound(sound, volume, separation);
+    return;
+  }
+
   // Convert DOOM volume (0-127) to mpv volume (0-100)
   const mpvVolume = Math.round((volume / 127) * 100);
-  log(`Playing sound: ${soundPath} at volume ${mpvVolume}`);
+  log(`Playing sound: ${soundPath} at volume ${mpvVolume}, separation ${separation}`);
 
   // Fire and forget - process will auto-cleanup when done
   const proc = spawnMpv(soundPath, [`--volume=${mpvVolume}`]);
@@ -170,6 +232,16 @@ export function playMusic(name: string, looping: boolean): void {
 
   const musicPath = join(soundDir, `${name.toLowerCase()}.mp3`);
   log(`Playing music: ${musicPath}, looping: ${looping}`);
+
+  if (sink) {
+    if (existsSync(musicPath)) {
+      sink.playMusic(musicPath, looping);
+    } else {
+      log(`File not found: ${musicPath}`);
+    }
+    return;
+  }
+
   const options: string[] = [
     `--input-ipc-server=${musicSocketPath}`, // Enable IPC for volume control
   ];
@@ -188,6 +260,7 @@ export function playMusic(name: string, looping: boolean): void {
  * Stop the currently playing music
  */
 export function stopMusic(): void {
+  sink?.stopMusic();
   if (musicProcess) {
     try {
       musicProcess.kill("SIGTERM");
@@ -207,6 +280,7 @@ export function stopMusic(): void {
 export function setMusicVolume(volume: number): void {
   const newVolume = Math.max(0, Math.min(127, volume));
   currentVolume = newVolume;
+  sink?.setMusicVolume(newVolume);
 
   // If no music is playing, just save the volume for next play
   if (!musicProcess || !currentMusicName) {
@@ -0,0 +1,242 @@
+/**
+ * DOOM Vector Automap
+ *
+ * Draws the automap line list exported by the engine straight into
+ * braille cells (2x4 dots per terminal cell), instead of sampling the
+ * rasterized automap back down from the framebuffer. The view (centre,
+ * zoom, follow mode) and what the iddt cheat reveals come from the engine's
+ * automap, so its own keys pan and zoom this one.
+ */
+
+import type { CellGrid } from "./doom-cells";
+import {
+  AUTOMAP_HEADER_SIZE,
+  AUTOMAP_LINE_STRIDE,
+  AUTOMAP_THING_COUNT,
+  AUTOMAP_THING_STRIDE,
+} from "./doom-engine";
+
+// Line kinds 0-5 come from doom_js_automap.c; the player arrow is drawn as
+// kind 6 and things (iddt twice) as kind 7
+const LINE_WALL = 0;
+const PLAYER = 6;
+const THING = 7;
+
+// Header fields (must match doom_js_automap.c)
+const CENTER_X = 4;
+const CENTER_Y = 5;
+const SCALE_MTOF = 6;
+const WINDOW_WIDTH = 7;
+
+// Thing triangles are this many map units across, as in AM_drawThings
+const THING_RADIUS = 16;
+
+// Colours per kind, close to the automap's own palette entries
+const KIND_COLORS = [
+  0xfc0000, // wall
+  0xa00000, // teleporter
+  0xbf7b4b, // floor change
+  0xfcfc00, // ceiling change
+  0x6f6f6f, // unseen (computer map)
+  0x8f8f8f, // no height change (iddt)
+  0xffffff, // player arrow
+  0x77ff6f, // thing (iddt twice)
+];
+
+// When two kinds share a cell, the higher priority one picks the colour
+const KIND_PRIORITY = [6, 3, 4, 5, 2, 1, 8, 7];
+
+// Braille dot bits indexed by [row * 2 + col] within a 2x4 cell
+const DOT_BITS = [0x01, 0x08, 0x02, 0x10, 0x04, 0x20, 0x40, 0x80];
+
+// First braille pattern code point (no dots)
+const BRAILLE_BASE = 0x2800;
+
+// Scratch space for line clipping
+const clipP = new Float64Array(4);
+const clipQ = new Float64Array(4);
+
+export interface AutomapRenderer {
+  /** Draw the line buffer (from DoomEngine.getAutomapLines) into rows [0, rows) */
+  draw: (grid: CellGrid, data: Int32Array, rows: number) => void;
+}
+
+/**
+ * Create a renderer that draws the automap as braille glyphs
+ */
+export function createAutomapRenderer(): AutomapRenderer {
+  // Per-cell dot bits and winning kind, reused between frames
+  let cellWidth = 0;
+  let cellHeight = 0;
+  let cellBits = new Uint8Array(0);
+  let cellKind = new Uint8Array(0);
+
+  function ensureCells(width: number, height: number): void {
+    if (width === cellWidth && height === cellHeight) return;
+    cellWidth = width;
+    cellHeight = height;
+    cellBits = new Uint8Array(width * height);
+    cellKind = new Uint8Array(width * height);
+  }
+
+  function plot(x: number, y: number, kind: number): void {
+    const cx = x >> 1;
+    const cy = y >> 2;
+    const cell = cy * cellWidth + cx;
+    const bits = cellBits[cell] ?? 0;
+    if (bits === 0 || (KIND_PRIORITY[kind] ?? 0) > (KIND_PRIORITY[cellKind[cell] ?? 0] ?? 0)) {
+      cellKind[cell] = kind;
+    }
+    cellBits[cell] = bits | (DOT_BITS[((y & 3) << 1) | (x & 1)] ?? 0);
+  }
+
+  /**
+   * Draw a line in dot space, clipped to the dot canvas (Liang-Barsky)
+   */
+  function drawLine(
+    x0: number,
+    y0: number,
+    x1: number,
+    y1: number,
+    kind: number,
+    dotsW: number,
+    dotsH: number
+  ): void {
+    const dx = x1 - x0;
+    const dy = y1 - y0;
+    let t0 = 0;
+    let t1 = 1;
+    clipP[0] = -dx;
+    clipP[1] = dx;
+    clipP[2] = -dy;
+    clipP[3] = dy;
+    clipQ[0] = x0;
+    clipQ[1] = dotsW - 1 - x0;
+    clipQ[2] = y0;
+    clipQ[3] = dotsH - 1 - y0;
+    for (let i = 0; i < 4; i++) {
+      const pi = clipP[i] ?? 0;
+      const qi = clipQ[i] ?? 0;
+      if (pi === 0) {
+        if (qi < 0) return;
+      } else {
+        const t = qi / pi;
+        if (pi < 0) {
+          if (t > t1) return;
+          if (t > t0) t0 = t;
+        } else {
+          if (t < t0) return;
+          if (t < t1) t1 = t;
+        }
+      }
+    }
+
+    let ax = Math.round(x0 + t0 * dx);
+    let ay = Math.round(y0 + t0 * dy);
+    const bx = Math.round(x0 + t1 * dx);
+    const by = Math.round(y0 + t1 * dy);
+
+    // Bresenham
+    const sx = ax < bx ? 1 : -1;
+    const sy = ay < by ? 1 : -1;
+    const adx = Math.abs(bx - ax);
+    const ady = -Math.abs(by - ay);
+    let err = adx + ady;
+    for (;;) {
+      plot(ax, ay, kind);
+      if (ax === bx && ay === by) break;
+      const e2 = 2 * err;
+      if (e2 >= ady) {
+        err += ady;
+        ax += sx;
+      }
+      if (e2 <= adx) {
+        err += adx;
+        ay += sy;
+      }
+    }
+  }
+
+  return {
+    draw(grid: CellGrid, data: Int32Array, rows: number): void {
+      ensureCells(grid.width, rows);
+      cellBits.fill(0);
+      cellKind.fill(0);
+
+      const dotsW = grid.width * 2;
+      const dotsH = rows * 4;
+      const count = data[0] ?? 0;
+      const px = data[1] ?? 0;
+      const py = data[2] ?? 0;
+      const angle = (((data[3] ?? 0) >>> 0) / 0x100000000) * Math.PI * 2;
+
+      // The automap window's scale, stretched from its width to the grid's,
+      // keeping dots square (map y grows upwards)
+      const windowWidth = data[WINDOW_WIDTH] || 1;
+      const dotsPerUnit = ((data[SCALE_MTOF] ?? 0) / 0x10000) * (dotsW / windowWidth);
+      const originX = dotsW / 2 - (data[CENTER_X] ?? 0) * dotsPerUnit;
+      const originY = dotsH / 2 + (data[CENTER_Y] ?? 0) * dotsPerUnit;
+
+      for (let i = 0; i < count; i++) {
+        const base = AUTOMAP_HEADER_SIZE + i * AUTOMAP_LINE_STRIDE;
+        drawLine(
+          originX + (data[base] ?? 0) * dotsPerUnit,
+          originY - (data[base + 1] ?? 0) * dotsPerUnit,
+          originX + (data[base + 2] ?? 0) * dotsPerUnit,
+          originY - (data[base + 3] ?? 0) * dotsPerUnit,
+          data[base + 4] ?? LINE_WALL,
+          dotsW,
+          dotsH
+        );
+      }
+
+      // Things: a triangle pointing where each one faces
+      const things = data[AUTOMAP_THING_COUNT] ?? 0;
+      const thingSize = Math.max(1.5, THING_RADIUS * dotsPerUnit);
+      for (let i = 0; i < things; i++) {
+        const base =
+          AUTOMAP_HEADER_SIZE + count * AUTOMAP_LINE_STRIDE + i * AUTOMAP_THING_STRIDE;
+        const tx = originX + (data[base] ?? 0) * dotsPerUnit;
+        const ty = originY - (data[base + 1] ?? 0) * dotsPerUnit;
+        const facing = (((data[base + 2] ?? 0) >>> 0) / 0x100000000) * Math.PI * 2;
+        const noseX = tx + Math.cos(facing) * thingSize;
+        const noseY = ty - Math.sin(facing) * thingSize;
+        const leftX = tx + Math.cos(facing + Math.PI * 0.75) * thingSize;
+        const leftY = ty - Math.sin(facing + Math.PI * 0.75) * thingSize;
+        const rightX = tx + Math.cos(facing - Math.PI * 0.75) * thingSize;
+        const rightY = ty - Math.sin(facing - Math.PI * 0.75) * thingSize;
+        drawLine(noseX, noseY, leftX, leftY, THING, dotsW, dotsH);
+        drawLine(leftX, leftY, rightX, rightY, THING, dotsW, dotsH);
+        drawLine(rightX, rightY, noseX, noseY, THING, dotsW, dotsH);
+      }
+
+      // Player arrow: a shaft with two barbs, sized in dots so it stays visible
+      const cx = originX + px * dotsPerUnit;
+      const cy = originY - py * dotsPerUnit;
+      const len = Math.max(4, Math.min(dotsW, dotsH) / 24);
+      const tipX = cx + Math.cos(angle) * len;
+      const tipY = cy - Math.sin(angle) * len;
+      const tailX = cx - Math.cos(angle) * len;
+      const tailY = cy + Math.sin(angle) * len;
+      drawLine(tailX, tailY, tipX, tipY, PLAYER, dotsW, dotsH);
+      for (const barb of [Math.PI * 0.8, -Math.PI * 0.8]) {
+        drawLine(
+          tipX,
+          tipY,
+          tipX + Math.cos(angle + barb) * len * 0.6,
+          tipY - Math.sin(angle + barb) * len * 0.6,
+          PLAYER,
+          dotsW,
+          dotsH
+        );
+      }
+
+      const cells = cellWidth * cellHeight;
+      for (let cell = 0; cell < cells; cell++) {
+        grid.chars[cell] = BRAILLE_BASE + (cellBits[cell] ?? 0);
+        grid.fg[cell] = KIND_COLORS[cellKind[cell] ?? LINE_WALL] ?? 0;
+        grid.bg[cell] = 0;
+      }
+    },
+  };
+}
@@ -0,0 +1,206 @@
+/**
+ * Key Bindings
+ *
+ * Which DOOM keys each terminal key sends, read once from a binding file
+ * and compiled into lookup tables, so mapping a key event is one Map lookup.
+ * The same bindings give the engine its default.cfg: a binding to an action
+ * ("+forward") sends the terminal key's own DOOM code and binds the action
+ * to that code, so the two can never disagree.
+ *
+ * Binding file (~/.opentui-doom/bindings.cfg, or --bindings FILE), one
+ * terminal key per line, replacing its default binding:
+ *
+ *   # terminal key   DOOM keys it sends, in order
+ *   w                uparrow +forward
+ *   x                +use
+ *   q                         # nothing: q types 'q' again
+ *
+ * Terminal keys are key names (w, up, f1, space, return...). ctrl, meta and
+ * shift bind chords of any key not bound itself. DOOM keys are DoomKeys
+ * names without KEY_ (uparrow, fire, f1...), single characters, or codes.
+ */
+
+import { existsSync, readFileSync } from "fs";
+import { join } from "path";
+import { homedir } from "os";
+import { DoomKeys, ESCAPE_SEQUENCES } from "./doom-input";
+
+// Looked for when no binding file is given
+export const BINDINGS_PATH = join(homedir(), ".opentui-doom", "bindings.cfg");
+
+// Actions a binding can name, and the DOOM config variable each one sets
+const ACTIONS: Record<string, string> = {
+  forward: "key_up",
+  backward: "key_down",
+  turnleft: "key_left",
+  turnright: "key_right",
+  strafeleft: "key_strafeleft",
+  straferight: "key_straferight",
+  fire: "key_fire",
+  use: "key_use",
+  strafe: "key_strafe",
+  run: "key_speed",
+};
+
+// Chord modifiers: bound like keys, used for chords of unbound keys
+const MODIFIERS = ["ctrl", "meta", "shift"] as const;
+
+// Defaults: arrows and WASD move (WASD also type, for save names), ctrl
+// fires, alt strafes, shift runs. Letters, digits and F-keys not bound here
+// send themselves.
+const DEFAULT_BINDINGS = `
+up         uparrow
+down       downarrow
+left       leftarrow
+right      rightarrow
+w          uparrow +forward
+s          downarrow +backward
+a          strafe_l +strafeleft
+d          strafe_r +straferight
+space      space
+return     enter
+enter      enter
+escape     escape
+tab        tab
+backspace  backspace
+alt        lalt
+ctrl       fire
+meta       lalt
+shift      rshift
+`;
+
+export interface KeyBindings {
+  /** DOOM keys sent, by key name and by escape sequence */
+  keys: Map<string, readonly number[]>;
+  /** DOOM keys sent by a chord of an unbound key */
+  ctrl: readonly number[];
+  meta: readonly number[];
+  shift: readonly number[];
+  /** DOOM keys sent by keys that type themselves (letters, digits, F-keys) */
+  typed: Map<string, readonly number[]>;
+  /** DOOM key each bound action (forward, fire...) is set to in default.cfg */
+  actions: Map<string, number>;
+  /** default.cfg for the engine */
+  config: string;
+}
+
+const NO_KEYS: readonly number[] = [];
+
+// DoomKeys by lower case name without KEY_ (uparrow, strafe_l, f1...)
+let doomKeyNames: Map<string, number> | null = null;
+
+function doomKeyCode(name: string): number | undefined {
+  if (!doomKeyNames) {
+    doomKeyNames = new Map(
+      Object.entries(DoomKeys).map(([key, code]) => [key.slice(4).toLowerCase(), code])
+    );
+    doomKeyNames.set("space", 0x20);
+  }
+  if (name.length === 1) return name.charCodeAt(0);
+  if (/^[0-9]+$/.test(name)) {
+    const code = parseInt(name, 10);
+    return code < 256 ? code : undefined;
+  }
+  return doomKeyNames.get(name);
+}
+
+// The DOOM code a terminal key sends of its own accord
+function ownCode(key: string): number | undefined {
+  if (key === "=" || key === "+") return DoomKeys.KEY_EQUALS;
+  if (key === "return" || key === "enter") return DoomKeys.KEY_ENTER;
+  if (key === "up" || key === "down" || key === "left" || key === "right") {
+    return doomKeyCode(`${key}arrow`);
+  }
+  return doomKeyCode(key);
+}
+
+/**
+ * Compile binding file text over the defaults (each key it names replaces
+ * that key's default). Throws on a line it cannot use, naming `source`.
+ */
+export function compileKeyBindings(text: string, source: string = "bindings"): KeyBindings {
+  const lines = new Map<string, { targets: string[]; where: string }>();
+  const read = (body: string, where: string): void => {
+    body.split("\n").forEach((line, i) => {
+      const words = line.replace(/#.*/, "").trim().split(/\s+/).filter(Boolean);
+      if (words.length === 0) return;
+      const [key, ...targets] = words;
+      // Moved to the end, so actions bound here win over the defaults
+      lines.delete(key!.toLowerCase());
+      lines.set(key!.toLowerCase(), { targets, where: `${where}:${i + 1}` });
+    });
+  };
+  read(DEFAULT_BINDINGS, "defaults");
+  read(text, source);
+
+  const bindings: KeyBindings = {
+    keys: new Map(),
+    ctrl: NO_KEYS,
+    meta: NO_KEYS,
+    shift: NO_KEYS,
+    typed: new Map(),
+    actions: new Map(),
+    config: "",
+  };
+  const actions = bindings.actions;
+
+  for (const [key, { targets, where }] of lines) {
+    const codes: number[] = [];
+    for (const target of targets) {
+      const name = target.toLowerCase();
+      if (name.startsWith("+")) {
+        const action = name.slice(1);
+        const code = ownCode(key);
+        if (!Object.hasOwn(ACTIONS, action)) {
+          throw new Error(`${where}: unknown action '${target}'`);
+        }
+        if (code === undefined) {
+          throw new Error(`${where}: '${key}' cannot be bound to an action`);
+        }
+        actions.set(action, code);
+        codes.push(code);
+        continue;
+      }
+      const code = doomKeyCode(name);
+      if (code === undefined) throw new Error(`${where}: unknown DOOM key '${target}'`);
+      codes.push(code);
+    }
+
+    if ((MODIFIERS as readonly string[]).includes(key)) {
+      bindings[key as (typeof MODIFIERS)[number]] = codes;
+    } else if (codes.length > 0) {
+      bindings.keys.set(key, codes);
+      for (const [sequence, name] of Object.entries(ESCAPE_SEQUENCES)) {
+        if (name === key) bindings.keys.set(sequence, codes);
+      }
+    }
+  }
+
+  const typed = "abcdefghijklmnopqrstuvwxyz0123456789=+-".split("");
+  for (let i = 1; i <= 12; i++) typed.push(`f${i}`);
+  for (const key of typed) bindings.typed.set(key, [ownCode(key)!]);
+
+  bindings.config = [...actions]
+    .map(([action, code]) => `${ACTIONS[action]} ${code}\n`)
+    .join("");
+  return bindings;
+}
+
+let defaultBindings: KeyBindings | null = null;
+
+/**
+ * The default bindings (compiled once)
+ */
+export function defaultKeyBindings(): KeyBindings {
+  return (defaultBindings ??= compileKeyBindings(""));
+}
+
+/**
+ * Load a binding file; without a path, ~/.opentui-doom/bindings.cfg if it
+ * exists, or else the defaults. Throws if the file has a bad line.
+ */
+export function loadKeyBindings(path?: string): KeyBindings {
+  const file = path ?? BINDINGS_PATH;
+  if (!path && !existsSync(file)) return defaultKeyBindings();
+  return compileKeyBindings(readFileSync(file, "utf8"), file);
+}
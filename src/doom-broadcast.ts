@@ -0,0 +1,118 @@
+/**
+ * DOOM Spectator Broadcast
+ *
+ * Fans one game's terminal output out to any number of read-only viewers
+ * on a Unix socket. Each frame is encoded once (a cell diff against the
+ * previous frame) and the same bytes are written to every viewer.
+ *
+ * A viewer whose socket backs up is not buffered for: it stops receiving
+ * diffs and is sent a keyframe (the whole screen) once it has drained, so
+ * slow viewers cost nothing while they lag.
+ *
+ * Watch with e.g.: socat -,raw,echo=0 UNIX-CONNECT:/tmp/doom-watch.sock
+ */
+
+import { createServer, type Server, type Socket } from "net";
+import { existsSync, unlinkSync } from "fs";
+import type { CellGrid } from "./doom-cells";
+import { ANSI_SESSION_END, ANSI_SESSION_START, createAnsiEncoder } from "./doom-ansi";
+import { removeStaleSocket } from "./doom-wire";
+import { debugLog } from "./debug";
+
+// Bytes queued on a viewer socket before it counts as lagging
+const VIEWER_HIGH_WATER = 256 * 1024;
+
+export interface Broadcaster {
+  /** Send the frame in the grid to every viewer */
+  publish: (grid: CellGrid) => void;
+  /** Number of connected viewers */
+  viewerCount: () => number;
+  /** Disconnect all viewers and stop listening */
+  close: () => void;
+}
+
+interface Viewer {
+  socket: Socket;
+  synced: boolean; // Has every frame since its last keyframe
+}
+
+/**
+ * Start a spectator socket for one game
+ */
+export function createBroadcaster(listen: string): Broadcaster {
+  const viewers = new Set<Viewer>();
+  const diffEncoder = createAnsiEncoder();
+  const keyEncoder = createAnsiEncoder();
+
+  removeStaleSocket(listen);
+
+  const server: Server = createServer((socket) => {
+    const viewer: Viewer = { socket, synced: false };
+    viewers.add(viewer);
+    debugLog("Broadcast", `viewer connected to ${listen} (${viewers.size} watching)`);
+
+    socket.write(ANSI_SESSION_START);
+    socket.on("data", (data: Buffer) => {
+      // Read-only: Ctrl+C or q leaves, everything else is ignored
+      if (data.includes(0x03) || data.includes(0x71)) {
+        socket.end(ANSI_SESSION_END);
+      }
+    });
+    socket.on("close", () => {
+      viewers.delete(viewer);
+      debugLog("Broadcast", `viewer left ${listen} (${viewers.size} watching)`);
+    });
+    socket.on("error", (e) => debugLog("Broadcast", `viewer error: ${e}`));
+  });
+  server.on("error", (e) => debugLog("Broadcast", `server error: ${e}`));
+  server.listen(listen);
+
+  return {
+    publish(grid: CellGrid): void {
+      // Keep the diff stream current even with no one watching, so the first
+      // diff after a keyframe is relative to the right frame
+      const diff = diffEncoder.encode(grid);
+      if (viewers.size === 0) return;
+
+      let diffBytes: Buffer | null = null;
+      let keyframe: Buffer | null = null;
+
+      for (const viewer of viewers) {
+        const { socket } = viewer;
+        if (socket.destroyed || !socket.writable) continue;
+
+        // Lagging: drop frames rather than queue them
+        if (socket.writableLength > VIEWER_HIGH_WATER) {
+          viewer.synced = false;
+          continue;
+        }
+
+        if (viewer.synced) {
+          if (diff.length === 0) continue;
+          diffBytes ??= Buffer.from(diff);
+          socket.write(diffBytes);
+        } else {
+          // (Re)join at a keyframe, encoded at most once per frame
+          keyframe ??= Buffer.from(keyEncoder.encode(grid, true));
+          socket.write(keyframe);
+          viewer.synced = true;
+        }
+      }
+    },
+
+    viewerCount(): number {
+      return viewers.size;
+    },
+
+    close(): void {
+      for (const viewer of viewers) {
+        if (!viewer.socket.destroyed) viewer.socket.end(ANSI_SESSION_END);
+      }
+      viewers.clear();
+      server.close();
+      if (existsSync(listen)) {
+        unlinkSync(listen);
+      }
+    },
+  };
+}
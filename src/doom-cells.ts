@@ -0,0 +1,122 @@
+/**
+ * DOOM Cell Grid
+ *
+ * A terminal-independent grid of cells (glyph + 24-bit foreground and
+ * background) that every drawing path writes into: the half-block frame
+ * sampler, the vector automap and the text HUD. Presenters then turn the
+ * grid into OpenTUI cells or an escape stream for remote sessions.
+ */
+
+import { DOOM_HEIGHT, DOOM_WIDTH } from "./doom-engine";
+
+// Upper half block: foreground is the top pixel, background the bottom one
+export const HALF_BLOCK = 0x2580;
+
+export interface CellGrid {
+  width: number;
+  height: number;
+  chars: Uint32Array; // Unicode code point per cell
+  fg: Uint32Array; // 0xRRGGBB
+  bg: Uint32Array; // 0xRRGGBB
+}
+
+/**
+ * Create an empty (blank, black) grid
+ */
+export function createCellGrid(width: number, height: number): CellGrid {
+  const size = Math.max(0, width * height);
+  const grid: CellGrid = {
+    width,
+    height,
+    chars: new Uint32Array(size),
+    fg: new Uint32Array(size),
+    bg: new Uint32Array(size),
+  };
+  grid.chars.fill(0x20);
+  return grid;
+}
+
+/**
+ * Resize a grid in place, clearing it if the size changed
+ */
+export function resizeCellGrid(grid: CellGrid, width: number, height: number): void {
+  if (grid.width === width && grid.height === height) return;
+  const fresh = createCellGrid(width, height);
+  grid.width = width;
+  grid.height = height;
+  grid.chars = fresh.chars;
+  grid.fg = fresh.fg;
+  grid.bg = fresh.bg;
+}
+
+/**
+ * Write text into a row one cell per character, returning the next column
+ */
+export function drawCellText(
+  grid: CellGrid,
+  x: number,
+  y: number,
+  text: string,
+  fg: number,
+  bg: number = 0
+): number {
+  if (y < 0 || y >= grid.height) return x;
+  for (let i = 0; i < text.length && x < grid.width; i++, x++) {
+    const cell = y * grid.width + x;
+    grid.chars[cell] = text.codePointAt(i) ?? 0x20;
+    grid.fg[cell] = fg;
+    grid.bg[cell] = bg;
+  }
+  return x;
+}
+
+/**
+ * Fill rows [top, top + rows) with blank cells
+ */
+export function clearCellRows(grid: CellGrid, top: number, rows: number, bg: number = 0): void {
+  const start = Math.max(0, top) * grid.width;
+  const end = Math.min(grid.height, top + rows) * grid.width;
+  if (end <= start) return;
+  grid.chars.fill(0x20, start, end);
+  grid.fg.fill(0, start, end);
+  grid.bg.fill(bg, start, end);
+}
+
+/**
+ * Sample DOOM's framebuffer into rows [0, rows) of the grid as half blocks
+ * Each cell covers two vertical source pixels (nearest neighbour).
+ */
+export function sampleHalfBlocks(grid: CellGrid, pixels: Uint32Array, rows: number): void {
+  sampleHalfBlockRows(grid, pixels, 0, rows, 0, DOOM_HEIGHT);
+}
+
+/**
+ * Sample framebuffer rows [srcTop, srcTop + srcRows) into grid rows
+ * [top, top + rows), e.g. the status bar below a vector automap
+ */
+export function sampleHalfBlockRows(
+  grid: CellGrid,
+  pixels: Uint32Array,
+  top: number,
+  rows: number,
+  srcTop: number,
+  srcRows: number
+): void {
+  const width = grid.width;
+  const scaleX = DOOM_WIDTH / width;
+  const scaleY = srcRows / (rows * 2); // *2 because each cell = 2 vertical pixels
+  const { chars, fg, bg } = grid;
+
+  for (let y = 0; y < rows; y++) {
+    const upper = (srcTop + Math.floor(y * 2 * scaleY)) * DOOM_WIDTH; // Top pixel row
+    const bottom = (srcTop + Math.floor((y * 2 + 1) * scaleY)) * DOOM_WIDTH; // Bottom pixel row
+    let cell = (top + y) * width;
+
+    for (let x = 0; x < width; x++, cell++) {
+      const srcX = Math.floor(x * scaleX);
+      chars[cell] = HALF_BLOCK;
+      fg[cell] = (pixels[upper + srcX] ?? 0) & 0xffffff;
+      bg[cell] = (pixels[bottom + srcX] ?? 0) & 0xffffff;
+    }
+  }
+}
@@ -0,0 +1,90 @@
+/**
+ * DOOM Thin Client
+ *
+ * Plays on a session server (--serve ... --protocol thin) without running
+ * DOOM locally: no WASM, no OpenTUI. It applies the server's binary cell
+ * diffs (doom-wire.ts) to a local grid, writes the changes to the terminal
+ * as escape sequences and forwards keystrokes and terminal size.
+ */
+
+import { connect } from "net";
+import { createCellGrid } from "./doom-cells";
+import { ANSI_SESSION_END, ANSI_SESSION_START, createAnsiEncoder } from "./doom-ansi";
+import {
+  createWireDecoder,
+  createWireReader,
+  parseSocketAddress,
+  wireMessage,
+  wireResize,
+  WIRE_INPUT,
+} from "./doom-wire";
+
+/**
+ * Connect to a thin-protocol server and play until the session ends
+ */
+export function runThinClient(address: string): Promise<void> {
+  const { stdin, stdout } = process;
+  const target = parseSocketAddress(address);
+  const socket = "path" in target ? connect(target.path) : connect(target.port, target.host);
+
+  const grid = createCellGrid(0, 0);
+  const decoder = createWireDecoder();
+  const encoder = createAnsiEncoder();
+  let changed = false;
+
+  const read = createWireReader((type, payload) => {
+    decoder.apply(type, payload, grid);
+    changed = true;
+  });
+
+  const sendSize = () => {
+    socket.write(wireResize(stdout.columns || 120, stdout.rows || 40));
+  };
+
+  return new Promise((resolveClient, rejectClient) => {
+    let started = false;
+
+    const restore = () => {
+      if (!started) return;
+      started = false;
+      stdout.off("resize", sendSize);
+      stdout.write(ANSI_SESSION_END);
+      if (stdin.isTTY) stdin.setRawMode(false);
+      stdin.pause();
+    };
+
+    socket.once("connect", () => {
+      started = true;
+      socket.setNoDelay(true);
+      stdout.write(ANSI_SESSION_START);
+      if (stdin.isTTY) stdin.setRawMode(true);
+      stdin.resume();
+      stdin.on("data", (data: Buffer) => socket.write(wireMessage(WIRE_INPUT, data)));
+      stdout.on("resize", sendSize);
+      sendSize();
+    });
+
+    socket.on("data", (data: Buffer) => {
+      try {
+        read(data);
+      } catch (e) {
+        socket.destroy(e instanceof Error ? e : new Error(`${e}`));
+        return;
+      }
+      // Several frames in one read are drawn once
+      if (changed) {
+        changed = false;
+        stdout.write(encoder.encode(grid));
+      }
+    });
+
+    socket.once("close", () => {
+      restore();
+      resolveClient();
+    });
+    socket.once("error", (e) => {
+      restore();
+      rejectClient(e);
+    });
+  });
+}
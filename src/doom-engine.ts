@@ -9,24 +9,254 @@ import { readFile } from "fs/promises";
 import { join, resolve } from "path";
 import { debugLog } from "./debug";
 import { loadExistingSaves, writeSave } from "./doom-saves";
+import type { NetEndpoint } from "./doom-net";
+import type { EngineMetrics } from "./doom-metrics";
+import { LEVEL_CACHE_DIR, readLevelCache, writeLevelCache } from "./doom-level-cache";
+import { DoomKeys } from "./doom-input";
+import { defaultKeyBindings, type KeyBindings } from "./doom-bindings";
 
 // DOOM screen dimensions
 export const DOOM_WIDTH = 1280;
 export const DOOM_HEIGHT = 800;
 
+// Size of dg_hud_state_t in int32 fields (see doom_js_hud.c)
+export const HUD_STATE_SIZE = 37;
+
+// Automap buffer layout in int32 fields (see doom_js_automap.c): a header,
+// then the lines, then the things (iddt) counted in its last field
+export const AUTOMAP_HEADER_SIZE = 10;
+export const AUTOMAP_LINE_STRIDE = 5;
+export const AUTOMAP_THING_STRIDE = 3;
+export const AUTOMAP_THING_COUNT = 9;
+
+// Byte that ends a demo lump
+export const DEMO_MARKER = 0x80;
+
+// Native render size; step() observations are this divided by a shrink factor
+export const NATIVE_WIDTH = 320;
+export const NATIVE_HEIGHT = 200;
+
+/**
+ * Packed input for step(): OR together the actions held during the step
+ */
+export const DoomAction = {
+  FORWARD: 1 << 0,
+  BACKWARD: 1 << 1,
+  TURN_LEFT: 1 << 2,
+  TURN_RIGHT: 1 << 3,
+  STRAFE_LEFT: 1 << 4,
+  STRAFE_RIGHT: 1 << 5,
+  FIRE: 1 << 6,
+  USE: 1 << 7,
+  RUN: 1 << 8,
+  WEAPON_1: 1 << 9,
+  WEAPON_2: 1 << 10,
+  WEAPON_3: 1 << 11,
+  WEAPON_4: 1 << 12,
+  WEAPON_5: 1 << 13,
+  WEAPON_6: 1 << 14,
+  WEAPON_7: 1 << 15,
+} as const;
+
+// The binding action each DoomAction bit holds, and the key DOOM acts on for
+// it when the bindings leave it at DOOM's own default (m_controls.c)
+const ACTION_BINDINGS: [string, number][] = [
+  ["forward", DoomKeys.KEY_UPARROW],
+  ["backward", DoomKeys.KEY_DOWNARROW],
+  ["turnleft", DoomKeys.KEY_LEFTARROW],
+  ["turnright", DoomKeys.KEY_RIGHTARROW],
+  ["strafeleft", DoomKeys.KEY_STRAFE_L],
+  ["straferight", DoomKeys.KEY_STRAFE_R],
+  ["fire", DoomKeys.KEY_FIRE],
+  ["use", 0x20], // space
+  ["run", DoomKeys.KEY_RSHIFT],
+];
+
+/**
+ * DOOM key step() presses for each DoomAction bit under these bindings:
+ * the key default.cfg gives the action, then the weapon digits
+ */
+function actionKeys(bindings: KeyBindings): number[] {
+  const keys = ACTION_BINDINGS.map(([action, key]) => bindings.actions.get(action) ?? key);
+  for (let weapon = 1; weapon <= 7; weapon++) keys.push(0x30 + weapon);
+  return keys;
+}
+
+/**
+ * Fields of the step() game variables (dg_step_vars_t in doom_js_step.c)
+ */
+export const StepVar = {
+  GAMETIC: 0,
+  GAMESTATE: 1, // 0 level, 1 intermission, 2 finale, 3 title/demos
+  EPISODE: 2,
+  MAP: 3,
+  ALIVE: 4,
+  HEALTH: 5,
+  ARMOR: 6,
+  READY_WEAPON: 7,
+  READY_AMMO: 8, // -1 if the weapon uses no ammo
+  AMMO: 9, // 4 entries: bullets, shells, cells, rockets
+  KILLS: 13,
+  ITEMS: 14,
+  SECRETS: 15,
+  X: 16, // Map units
+  Y: 17,
+  Z: 18,
+  ANGLE: 19, // Degrees, 0 = east, counterclockwise
+  DAMAGE: 20, // Red flash strength: damage taken recently
+  ATTACK_DOWN: 21,
+} as const;
+export const STEP_VARS_SIZE = 22;
+
+/**
+ * Fields of getStateHash() (dg_state_hash_t in doom_js_hash.c)
+ */
+export const StateHash = {
+  TOTAL: 0,
+  MOBJS: 1,
+  SECTORS: 2,
+  PLAYERS: 3,
+  RNG: 4, // The playsim RNG index itself
+  MOBJ_COUNT: 5,
+} as const;
+export const STATE_HASH_SIZE = 6;
+
+/**
+ * Fields of getEngineState() (dg_engine_state_t in doom_js_state.c)
+ */
+export const EngineState = {
+  VERSION: 0,
+  SIZE: 1, // Bytes
+  GAMETIC: 2,
+  LEVELTIME: 3, // Tics since the level started
+  GAMESTATE: 4, // GameState
+  MENU_ACTIVE: 5,
+  PAUSED: 6,
+  AUTOMAP_ACTIVE: 7,
+  HELP_SCREEN: 8,
+  DEMO_PLAYBACK: 9,
+  DEMO_RECORDING: 10,
+  NETGAME: 11,
+  PALETTE: 12, // PLAYPAL index: 0 normal, 1-8 pain, 9-12 pickup, 13 radiation suit
+  EPISODE: 13,
+  MAP: 14,
+  SKILL: 15,
+  PLAYER_STATE: 16, // 0 alive, 1 dead, 2 respawning
+  HEALTH: 17,
+  ARMOR: 18,
+  ARMOR_TYPE: 19,
+  READY_WEAPON: 20,
+  READY_AMMO: 21, // -1 if the weapon uses no ammo
+  AMMO: 22, // 4 entries: bullets, shells, cells, rockets
+  KILLS: 26,
+  TOTAL_KILLS: 27,
+  ITEMS: 28,
+  TOTAL_ITEMS: 29,
+  SECRETS: 30,
+  TOTAL_SECRETS: 31,
+  DAMAGE: 32, // Red flash strength
+  BONUS: 33, // Pickup flash strength
+} as const;
+export const ENGINE_STATE_VERSION = 1;
+export const ENGINE_STATE_SIZE = 34;
+
+/**
+ * Fields of getLevelTimings() (dg_level_timings_t in doom_js_level.c)
+ */
+export const LevelTiming = {
+  LOADS: 0, // Levels loaded since startup
+  EPISODE: 1,
+  MAP: 2,
+  BLOCKMAP: 3, // Where the blockmap came from: 0 the map's lump, 1 built, 2 the level cache
+  TOTAL_US: 4, // Microseconds for the whole load
+  STAGE_US: 5, // LEVEL_STAGES.length entries: microseconds per stage
+} as const;
+
+// Loading stages, in the order P_SetupLevel runs them ("blockmap build" is ours)
+export const LEVEL_STAGES = [
+  "blockmap",
+  "vertexes",
+  "sectors",
+  "sidedefs",
+  "linedefs",
+  "subsectors",
+  "nodes",
+  "segs",
+  "group lines",
+  "reject",
+  "things",
+  "specials",
+  "precache",
+  "blockmap build",
+];
+export const LEVEL_TIMINGS_SIZE = LevelTiming.STAGE_US + LEVEL_STAGES.length;
+
+const BLOCKMAP_SOURCES = ["lump", "built", "cached"];
+
+/**
+ * One line on the last level load: total and the stages that took time
+ */
+export function formatLevelTimings(timings: Int32Array): string {
+  const ms = (us: number) => (us / 1000).toFixed(1);
+  const stages: string[] = [];
+  for (let i = 0; i < LEVEL_STAGES.length; i++) {
+    const us = timings[LevelTiming.STAGE_US + i]!;
+    if (us >= 100) stages.push(`${LEVEL_STAGES[i]} ${ms(us)}`);
+  }
+  const blockmap = BLOCKMAP_SOURCES[timings[LevelTiming.BLOCKMAP]!] ?? "?";
+  return (
+    `episode ${timings[LevelTiming.EPISODE]} map ${timings[LevelTiming.MAP]} loaded in ` +
+    `${ms(timings[LevelTiming.TOTAL_US]!)} ms (${stages.join(", ")}; blockmap ${blockmap})`
+  );
+}
+
+export const GameState = {
+  LEVEL: 0,
+  INTERMISSION: 1,
+  FINALE: 2,
+  DEMOSCREEN: 3, // Title screen and attract demos
+} as const;
+
+export interface StepResult {
+  frame: Uint8Array; // View into WASM memory: width * height * channels bytes
+  width: number;
+  height: number;
+  channels: number; // 3 (RGB) or 1 (grayscale)
+  gamevars: Int32Array; // View into WASM memory, indexed by StepVar
+}
+
 export interface DoomModule {
   _doomgeneric_Create: (argc: number, argv: number) => void;
   _doomgeneric_Tick: () => void;
   _DG_GetFrameBuffer: () => number;
-  _DG_PushKeyEvent: (pressed: number, key: number) => void;
+  _DG_PushKeyEvent: (pressed: number, key: number) => number; // 0 if the queue was full
+  _DG_IsAutomapActive: () => number;
+  _DG_GetAutomapLines: () => number;
+  _DG_SetTextHud: (enabled: number) => void;
+  _DG_GetHudState: () => number;
+  _DG_SetVirtualClock: (enabled: number) => void;
+  _DG_GetDemoState: () => number;
+  _DG_SetDemoLimit: (enabled: number) => void;
+  _DG_GetObservation: (shrink: number, gray: number) => number;
+  _DG_GetStepVars: () => number;
+  _DG_GetStateHash: () => number;
+  _DG_GetEngineState: () => number;
+  _DG_RunTics: (tics: number, renderLast: number) => number;
+  _DG_GetLevelTimings: () => number;
+  _DG_SetSteadyPalette: (enabled: number) => void;
+  _DG_SetUncapped: (enabled: number) => void;
+  _DG_RenderView: (frac: number) => number;
   _malloc: (size: number) => number;
   _free: (ptr: number) => void;
+  stackSave: () => number;
+  stackRestore: (pointer: number) => void;
   HEAPU8: Uint8Array;
+  HEAP32: Int32Array;
   HEAPU32: Uint32Array;
   FS_createDataFile: (
     parent: string,
     name: string,
-    data: number[],
+    data: number[] | Uint8Array,
     canRead: boolean,
     canWrite: boolean,
     canOwn?: boolean
@@ -46,11 +276,118 @@ export interface DoomModule {
 
 export interface DoomEngineOptions {
   wadPath: string;
+  wadData?: Uint8Array; // WAD contents already in memory (skips reading wadPath)
+  sharedWad?: Uint8Array; // WAD shared with other engines, read lump by lump (see loadSharedWad)
+  wasmModule?: WebAssembly.Module; // Precompiled module to instantiate (see compileDoomModule)
+  buildDir?: string; // Directory with doom.js / doom.wasm (default: doom/build)
+  audio?: boolean; // Play sound and music through doom-audio (default: true)
+  saves?: boolean; // Persist save games to ~/.opentui-doom/ (default: true)
+  net?: NetEndpoint; // Join a netgame (see doom-net.ts); init blocks until it launches
+  recordDemo?: boolean; // Record the inputs as a demo from a new game (see getDemo)
+  playDemo?: Uint8Array; // Play back this demo lump; onQuit is called when it ends
+  timeDemo?: boolean; // Play it as a timedemo: one tic per tick(), see getTimeDemoResult
+  virtualClock?: boolean; // Run exactly one game tic per tick(), however often it is called
+  observation?: { shrink?: number; gray?: boolean }; // step() frames: 320x200 / shrink (default 2)
+  args?: string[]; // Extra DOOM command line arguments, e.g. ["-warp", "1", "1"]
+  metrics?: EngineMetrics; // Record tick latency, tics and key events (see doom-metrics.ts)
+  levelCache?: string | false; // Where built level data is kept (default: ~/.opentui-doom/levels)
+  bindings?: KeyBindings; // Key bindings default.cfg is written from (default: built-in ones)
   print?: (text: string) => void;
   printErr?: (text: string) => void;
   onQuit?: () => void;
 }
 
+/**
+ * What reset() changes; anything left out stays as the engine had it
+ */
+export interface EngineResetOptions {
+  wadPath?: string;
+  wadData?: Uint8Array;
+  sharedWad?: Uint8Array;
+  recordDemo?: boolean;
+  playDemo?: Uint8Array | null; // null stops playing the current one
+  timeDemo?: boolean;
+  virtualClock?: boolean;
+  args?: string[];
+  metrics?: EngineMetrics | null;
+  print?: (text: string) => void;
+  printErr?: (text: string) => void;
+  onQuit?: (() => void) | null;
+}
+
+// Directory holding the compiled doom.js / doom.wasm
+export const BUILD_DIR = join(import.meta.dir, "..", "doom", "build");
+
+// Where the IWAD appears inside the virtual filesystem
+const IWAD_DIR = "/doom";
+const IWAD_NAME = "doom1.wad";
+const IWAD_PATH = `${IWAD_DIR}/${IWAD_NAME}`;
+
+// Where demos are recorded to and played from inside the virtual filesystem
+// (-record appends ".lmp" to the name it is given)
+const DEMO_DIR = "/demo";
+const DEMO_RECORD_NAME = `${DEMO_DIR}/session`;
+const DEMO_PLAY_PATH = `${DEMO_DIR}/replay.lmp`;
+
+// Compiled WebAssembly modules, shared by every engine in the process
+const compiledModules = new Map<string, Promise<WebAssembly.Module>>();
+
+/**
+ * Compile doom.wasm once per process
+ * Engines created with the result only instantiate it, sharing the compiled code.
+ */
+export function compileDoomModule(buildDir: string = BUILD_DIR): Promise<WebAssembly.Module> {
+  let compiled = compiledModules.get(buildDir);
+  if (!compiled) {
+    compiled = readFile(join(buildDir, "doom.wasm")).then((bytes) => WebAssembly.compile(bytes));
+    compiledModules.set(buildDir, compiled);
+  }
+  return compiled;
+}
+
+// WAD files loaded into shared memory, by absolute path
+const sharedWads = new Map<string, Promise<Uint8Array>>();
+
+/**
+ * Load a WAD once per process into a SharedArrayBuffer
+ * Engines given the result as sharedWad read lumps from it on demand (w_file_js.c)
+ * instead of each keeping a copy in its virtual filesystem; workers can share it too.
+ */
+export function loadSharedWad(wadPath: string): Promise<Uint8Array> {
+  const path = resolve(wadPath);
+  let shared = sharedWads.get(path);
+  if (!shared) {
+    shared = readFile(path).then((bytes) => {
+      const wad = new Uint8Array(new SharedArrayBuffer(bytes.byteLength));
+      wad.set(bytes);
+      return wad;
+    });
+    sharedWads.set(path, shared);
+  }
+  return shared;
+}
+
+// Copy of linear memory up to its last non-zero word; the rest is zeros
+function snapshotMemory(heap: Uint8Array): Uint8Array {
+  const words = new Uint32Array(heap.buffer, heap.byteOffset, heap.byteLength >> 2);
+  let end = words.length;
+  while (end > 0 && words[end - 1] === 0) end--;
+  return heap.slice(0, end * 4);
+}
+
+// Regular files in the virtual filesystem under dir (/dev and /proc skipped)
+function listFiles(FS: any, dir: string, files: Set<string> = new Set()): Set<string> {
+  for (const name of FS.readdir(dir)) {
+    if (name === "." || name === "..") continue;
+    const path = dir === "/" ? `/${name}` : `${dir}/${name}`;
+    if (path === "/dev" || path === "/proc") continue;
+    const { mode } = FS.stat(path);
+    if (FS.isDir(mode)) listFiles(FS, path, files);
+    else if (FS.isFile(mode)) files.add(path);
+  }
+  return files;
+}
+
 export class DoomEngine {
   private module: DoomModule | null = null;
   private frameBufferPtr: number = 0;
@@ -60,6 +397,33 @@ export class DoomEngine {
   private printErr: (text: string) => void;
   private onQuit: (() => void) | null = null;
   private emscriptenFS: any = null; // FS reference captured from Emscripten
+  private wadData: Uint8Array | null = null;
+  private sharedWad: Uint8Array | null = null;
+  private wasmModule: WebAssembly.Module | null = null;
+  private buildDir: string = BUILD_DIR;
+  private audioEnabled: boolean = true;
+  private savesEnabled: boolean = true;
+  private net: NetEndpoint | null = null;
+  private recordDemo: boolean = false;
+  private playDemo: Uint8Array | null = null;
+  private timeDemo: boolean = false;
+  private virtualClock: boolean = false;
+  private observationShrink: number = 2;
+  private observationGray: boolean = false;
+  private extraArgs: string[] = [];
+  private metrics: EngineMetrics | null = null;
+  private engineState: Int32Array | null = null;
+  private engineStatePtr: number = 0;
+  private levelTimings: Int32Array | null = null;
+  private levelCacheDir: string | null = LEVEL_CACHE_DIR;
+  private bindings: KeyBindings | null = null;
+  private stepKeys: number[] = actionKeys(defaultKeyBindings());
+  private heldActions: number = 0;
+  private stepResult: StepResult | null = null;
+  private audio: typeof import("./doom-audio") | null = null;
+  private bootImage: Uint8Array | null = null; // Linear memory before DOOM first started
+  private bootFiles: Set<string> = new Set(); // Virtual filesystem files at that point
+  private bootStack: number = 0; // Stack pointer at that point (a global, not in memory)
 
   constructor(optionsOrPath: string | DoomEngineOptions) {
     if (typeof optionsOrPath === "string") {
@@ -71,23 +435,51 @@ export class DoomEngine {
       this.print = optionsOrPath.print || ((text: string) => console.log("[DOOM]", text));
       this.printErr = optionsOrPath.printErr || ((text: string) => console.error("[DOOM]", text));
       this.onQuit = optionsOrPath.onQuit || null;
+      this.wadData = optionsOrPath.wadData ?? null;
+      this.sharedWad = optionsOrPath.sharedWad ?? null;
+      this.wasmModule = optionsOrPath.wasmModule ?? null;
+      this.buildDir = resolve(optionsOrPath.buildDir ?? BUILD_DIR);
+      this.audioEnabled = optionsOrPath.audio ?? true;
+      this.savesEnabled = optionsOrPath.saves ?? true;
+      this.net = optionsOrPath.net ?? null;
+      this.recordDemo = optionsOrPath.recordDemo ?? false;
+      this.playDemo = optionsOrPath.playDemo ?? null;
+      this.timeDemo = optionsOrPath.timeDemo ?? false;
+      this.virtualClock = optionsOrPath.virtualClock ?? false;
+      this.observationShrink = Math.max(1, optionsOrPath.observation?.shrink ?? 2);
+      this.observationGray = optionsOrPath.observation?.gray ?? false;
+      this.extraArgs = optionsOrPath.args ?? [];
+      this.metrics = optionsOrPath.metrics ?? null;
+      if (optionsOrPath.levelCache !== undefined) {
+        this.levelCacheDir = optionsOrPath.levelCache || null;
+      }
+      this.bindings = optionsOrPath.bindings ?? null;
+      if (this.bindings) this.stepKeys = actionKeys(this.bindings);
     }
   }
 
   async init(): Promise<void> {
     // Load the WASM module
-    const buildDir = join(import.meta.dir, "..", "doom", "build");
+    const buildDir = this.buildDir;
     const doomJsPath = join(buildDir, "doom.js");
 
-    // Read WAD file first
-    const wadData = await readFile(this.wadPath);
-    const wadArray = Array.from(new Uint8Array(wadData));
+    // Read WAD file first (FS_createDataFile takes the bytes as-is, no JS array copy)
+    // A shared WAD is not copied at all: the FS only gets an empty placeholder
+    const sharedWad = this.sharedWad;
+    const wadData = sharedWad
+      ? new Uint8Array(0)
+      : (this.wadData ?? new Uint8Array(await readFile(this.wadPath)));
 
     // Dynamic import of the compiled DOOM module
     const createDoomModule = require(doomJsPath);
 
     // Import audio system
-    const audio = await import("./doom-audio");
+    const audio = this.audioEnabled ? await import("./doom-audio") : null;
+    this.audio = audio;
+    const savesEnabled = this.savesEnabled;
+    const wasmModule = this.wasmModule;
+    const playDemo = this.playDemo;
+    const bindings = this.bindings;
 
     // Create module with proper callbacks
     const moduleConfig: any = {
@@ -100,14 +492,6 @@ export class DoomEngine {
       print: (text: string) => this.print(text),
       printErr: (text: string) => this.printErr(text),
 
-      // Audio callbacks - called from C via EM_ASM
-      initAudio: () => audio.initAudio(),
-      shutdownAudio: () => audio.shutdownAudio(),
-      playSound: (name: string, volume: number) => audio.playSound(name, volume),
-      playMusic: (name: string, looping: boolean) => audio.playMusic(name, looping),
-      stopMusic: () => audio.stopMusic(),
-      setMusicVolume: (volume: number) => audio.setMusicVolume(volume),
-
       // Game lifecycle callbacks - called from C via EM_ASM
       quitGame: () => {
         debugLog("Engine", "quitGame callback called from WASM");
@@ -123,33 +507,36 @@ export class DoomEngine {
       preRun: [
         (module: any) => {
           // Create /doom directory for WAD
-          module.FS_createPath("/", "doom", true, true);
+          module.FS_createPath("/", IWAD_DIR.slice(1), true, true);
           // Write WAD file to virtual filesystem
-          module.FS_createDataFile("/doom", "doom1.wad", wadArray, true, false);
+          module.FS_createDataFile(IWAD_DIR, IWAD_NAME, wadData, true, false);
+
+          // Demos recorded with -record, or the one to play back
+          module.FS_createPath("/", DEMO_DIR.slice(1), true, true);
+          if (playDemo) {
+            const name = DEMO_PLAY_PATH.slice(DEMO_DIR.length + 1);
+            module.FS_createDataFile(DEMO_DIR, name, playDemo, true, false);
+          }
 
           // Create .savegame directory for saves (DOOM looks here by default)
           module.FS_createPath("/", ".savegame", true, true);
 
-          // Create default.cfg with WASD key bindings
-          // This is needed because we send character codes for WASD (to allow typing in save dialogs)
-          // Key codes: w=119, a=97, s=115, d=100
-          const defaultConfig =
-            [
-              "key_up 119", // 'w' for forward
-              "key_down 115", // 's' for backward
-              "key_strafeleft 97", // 'a' for strafe left
-              "key_straferight 100", // 'd' for strafe right
-            ].join("\n") + "\n";
+          // Create default.cfg from the key bindings (doom-bindings.ts): by
+          // default WASD move, bound to their characters, since those are
+          // sent too (to allow typing in save dialogs)
+          const defaultConfig = (bindings ?? defaultKeyBindings()).config;
           const configArray = Array.from(new TextEncoder().encode(defaultConfig));
           try {
             module.FS_createDataFile("/", "default.cfg", configArray, true, false);
-            debugLog("Engine", "Created default.cfg with WASD key bindings");
+            debugLog("Engine", "Created default.cfg from the key bindings");
           } catch (e) {
             debugLog("Engine", `Failed to create default.cfg: ${e}`);
           }
 
           // Load existing saves from ~/.opentui-doom/ into virtual filesystem
-          const existingSaves = loadExistingSaves();
+          const existingSaves = savesEnabled
+            ? loadExistingSaves()
+            : new Map<number, Uint8Array>();
           for (const [slot, data] of existingSaves) {
             const filename = `doomsav${slot}.dsg`;
             try {
@@ -163,6 +550,52 @@ export class DoomEngine {
       ],
     };
 
+    // Audio callbacks - called from C via EM_ASM
+    if (audio) {
+      moduleConfig.initAudio = () => audio.initAudio();
+      moduleConfig.shutdownAudio = () => audio.shutdownAudio();
+      moduleConfig.playSound = (name: string, volume: number, separation: number) =>
+        audio.playSound(name, volume, separation);
+      moduleConfig.playMusic = (name: string, looping: boolean) => audio.playMusic(name, looping);
+      moduleConfig.stopMusic = () => audio.stopMusic();
+      moduleConfig.setMusicVolume = (volume: number) => audio.setMusicVolume(volume);
+    }
+
+    // Shared WAD reads - called from C via EM_ASM (w_file_js.c)
+    // Installed even without one: reset() can switch to a shared WAD
+    moduleConfig.wadOpen = (path: string) => (this.sharedWad && path === IWAD_PATH ? 0 : -1);
+    moduleConfig.wadLength = (_handle: number) => this.sharedWad?.byteLength ?? 0;
+    moduleConfig.wadRead = (_handle: number, offset: number, length: number) => {
+      const wad = this.sharedWad ?? new Uint8Array(0);
+      return wad.subarray(offset, Math.min(offset + length, wad.byteLength));
+    };
+
+    // Level data cache - called from C via EM_ASM (doom_js_level.c)
+    const levelCacheDir = this.levelCacheDir;
+    if (levelCacheDir) {
+      moduleConfig.levelCacheRead = (key: string) => readLevelCache(levelCacheDir, key);
+      moduleConfig.levelCacheWrite = (key: string, data: Uint8Array) =>
+        writeLevelCache(levelCacheDir, key, data);
+    }
+
+    // Network callbacks - called from C via EM_ASM (net_js.c)
+    if (this.net) {
+      Object.assign(moduleConfig, this.net.callbacks);
+    }
+
+    // Instantiate a precompiled module instead of compiling doom.wasm again
+    if (wasmModule) {
+      moduleConfig.instantiateWasm = (
+        imports: WebAssembly.Imports,
+        receiveInstance: (instance: WebAssembly.Instance, module: WebAssembly.Module) => void
+      ) => {
+        WebAssembly.instantiate(wasmModule, imports)
+          .then((instance) => receiveInstance(instance, wasmModule))
+          .catch((e) => this.printErr(`Failed to instantiate WASM module: ${e}`));
+        return {};
+      };
+    }
+
     this.module = await createDoomModule(moduleConfig);
 
     if (!this.module) {
@@ -181,11 +614,26 @@ export class DoomEngine {
       debugLog("Engine", "Warning: Could not find Emscripten FS object");
     }
 
+    // Kept for reset(): the instance as it is before DOOM starts
+    this.bootImage = snapshotMemory(this.module.HEAPU8);
+    this.bootStack = this.module.stackSave();
+    if (this.emscriptenFS) this.bootFiles = listFiles(this.emscriptenFS, "/");
+
     // Initialize DOOM
     this.initDoom();
 
     // Get framebuffer pointer
     this.frameBufferPtr = this.module._DG_GetFrameBuffer();
+
+    // The state block never moves; refuse a layout this code does not know
+    const statePtr = this.module._DG_GetEngineState();
+    const version = this.module.HEAP32[statePtr >> 2];
+    const size = this.module.HEAP32[(statePtr >> 2) + EngineState.SIZE];
+    if (version === ENGINE_STATE_VERSION && size === ENGINE_STATE_SIZE * 4) {
+      this.engineStatePtr = statePtr;
+    } else {
+      this.printErr(`Engine state layout v${version} (${size} bytes) not supported, rebuild`);
+    }
     this.initialized = true;
   }
 
@@ -194,7 +642,22 @@ export class DoomEngine {
 
     const module = this.module;
 
-    const args = ["doom", "-iwad", "/doom/doom1.wad"];
+    const args = ["doom", "-iwad", IWAD_PATH];
+    if (!this.audioEnabled) {
+      args.push("-nosound");
+    }
+    if (this.net) {
+      args.push(...this.net.args);
+    }
+    if (this.recordDemo) {
+      args.push("-record", DEMO_RECORD_NAME);
+    } else if (this.playDemo) {
+      args.push(this.timeDemo ? "-timedemo" : "-playdemo", DEMO_PLAY_PATH);
+    }
+    if (this.virtualClock) {
+      module._DG_SetVirtualClock(1);
+    }
+    args.push(...this.extraArgs);
 
     // Allocate memory for argv using ccall for strings
     const argPtrs: number[] = [];
@@ -222,6 +685,10 @@ export class DoomEngine {
     // Call doomgeneric_Create
     module._doomgeneric_Create(args.length, argvPtr);
 
+    // Long sessions grow the buffer instead of ending it; set after startup,
+    // which loads vanilla_demo_limit from default.cfg
+    if (this.recordDemo) module._DG_SetDemoLimit(0);
+
     // Free argv (DOOM copies the strings)
     for (const ptr of argPtrs) {
       module._free(ptr);
@@ -229,12 +696,184 @@ export class DoomEngine {
     module._free(argvPtr);
   }
 
+  /**
+   * Warm reset: start DOOM over in this instance instead of creating another
+   * Linear memory and the stack pointer go back to where they were before
+   * DOOM first started, files DOOM wrote since are removed (save games stay
+   * when saves are on) and doomgeneric_Create runs again, so a new session
+   * only pays for the WAD-dependent startup, not for loading and
+   * instantiating the module.
+   * Options given replace the engine's. Settings made through methods
+   * (setTextHud) start over. Netgames cannot be reset: the endpoint is spent.
+   * Must not be called from inside the module (e.g. from onQuit).
+   */
+  async reset(options: EngineResetOptions = {}): Promise<void> {
+    const module = this.module;
+    const FS = this.emscriptenFS;
+    if (!module || !this.bootImage || !FS) {
+      throw new Error("DoomEngine.reset() called before init()");
+    }
+    if (this.net) {
+      throw new Error("DoomEngine.reset() cannot restart a netgame");
+    }
+    this.initialized = false;
+
+    // A new WAD: shared, or written over the IWAD file
+    if (options.sharedWad) {
+      this.sharedWad = options.sharedWad;
+      this.wadData = null;
+      this.replaceFile(IWAD_PATH, new Uint8Array(0));
+    } else if (options.wadData || options.wadPath) {
+      const wadData = options.wadData ?? new Uint8Array(await readFile(resolve(options.wadPath!)));
+      this.sharedWad = null;
+      this.wadData = options.wadData ?? null;
+      this.replaceFile(IWAD_PATH, wadData);
+    }
+    if (options.wadPath) this.wadPath = resolve(options.wadPath);
+
+    if (options.recordDemo !== undefined) this.recordDemo = options.recordDemo;
+    if (options.playDemo !== undefined) this.playDemo = options.playDemo;
+    if (options.timeDemo !== undefined) this.timeDemo = options.timeDemo;
+    if (options.virtualClock !== undefined) this.virtualClock = options.virtualClock;
+    if (options.args) this.extraArgs = options.args;
+    if (options.metrics !== undefined) this.metrics = options.metrics;
+    if (options.print) this.print = options.print;
+    if (options.printErr) this.printErr = options.printErr;
+    if (options.onQuit !== undefined) this.onQuit = options.onQuit;
+
+    // Close what DOOM left open (stdin/stdout/stderr stay) and drop what it wrote
+    for (const stream of FS.streams) {
+      if (stream && stream.fd > 2) FS.close(stream);
+    }
+    for (const path of listFiles(FS, "/")) {
+      if (this.bootFiles.has(path)) continue;
+      if (this.savesEnabled && path.startsWith("/.savegame/")) continue;
+      FS.unlink(path);
+    }
+    if (this.playDemo) this.replaceFile(DEMO_PLAY_PATH, this.playDemo);
+
+    // Music the last run started plays in a child process, outside the module
+    this.audio?.stopMusic();
+
+    const heap = module.HEAPU8;
+    heap.set(this.bootImage);
+    heap.fill(0, this.bootImage.length);
+    // A quit unwinds out of the module without popping its frames
+    module.stackRestore(this.bootStack);
+    this.heldActions = 0;
+    this.stepResult = null;
+    this.engineState = null;
+    this.levelTimings = null;
+
+    this.initDoom();
+    this.frameBufferPtr = module._DG_GetFrameBuffer();
+    this.initialized = true;
+  }
+
+  // Replace a file DOOM reads (created read-only, so unlinked, not written over)
+  private replaceFile(path: string, data: Uint8Array): void {
+    const FS = this.emscriptenFS;
+    try {
+      FS.unlink(path);
+    } catch (_e) {
+      // Not there yet
+    }
+    FS.writeFile(path, data);
+  }
+
   /**
    * Run one game tick - called each frame
    */
   tick(): void {
     if (!this.module || !this.initialized) return;
+    const metrics = this.metrics;
+    if (!metrics) {
+      this.module._doomgeneric_Tick();
+      return;
+    }
+    const start = performance.now();
     this.module._doomgeneric_Tick();
+    const end = performance.now();
+    metrics.tick(end - start, end, this.getGameTic());
+  }
+
+  /**
+   * Run `tics` game tics in one call without rendering them, e.g. to
+   * fast-forward a demo or catch up after a stall; with renderLast the last
+   * tic is drawn, so the framebuffer shows where the game ended up.
+   * On the real clock, game time stays ahead by what was skipped.
+   * Returns the tics run (fewer if the game quit on the way).
+   */
+  runTics(tics: number, renderLast: boolean = false): number {
+    if (!this.module || !this.initialized || tics <= 0) return 0;
+    const metrics = this.metrics;
+    const start = metrics ? performance.now() : 0;
+    const ran = this.module._DG_RunTics(tics, renderLast ? 1 : 0);
+    if (metrics) {
+      const end = performance.now();
+      metrics.tick(end - start, end, this.getGameTic());
+    }
+    return ran;
+  }
+
+  /**
+   * Draw the view again between two tics (needs setUncapped), `fraction`
+   * (0..1) of the way from the previous tic to the latest one: mobjs are
+   * interpolated and the view turned by the turn keys held now.
+   * Returns false if there is nothing to draw between tics (a menu, the
+   * automap, a wipe, no level); the last frame stands until the next tic.
+   */
+  renderBetweenTics(fraction: number): boolean {
+    if (!this.module || !this.initialized) return false;
+    return this.module._DG_RenderView(Math.round(fraction * 0x10000)) !== 0;
+  }
+
+  /**
+   * Run game tics at full speed for automation
+   * Holds the packed DoomAction bits for the whole step (keys change only
+   * where they differ from the previous step), runs `tics` game tics and
+   * returns the downscaled frame and the game variables. The result and its
+   * views are reused by the next step; copy what you keep.
+   * Needs virtualClock, so that every tick is exactly one tic.
+   */
+  step(actions: number, tics: number = 1): StepResult {
+    if (!this.module || !this.initialized) {
+      throw new Error("DoomEngine.step() called before init()");
+    }
+    if (!this.virtualClock) {
+      throw new Error("DoomEngine.step() needs the virtualClock option");
+    }
+    const module = this.module;
+
+    const changed = actions ^ this.heldActions;
+    for (let bit = 0; changed >> bit; bit++) {
+      if (!((changed >> bit) & 1)) continue;
+      const key = this.stepKeys[bit];
+      if (key !== undefined) module._DG_PushKeyEvent((actions >> bit) & 1, key);
+    }
+    this.heldActions = actions;
+
+    // Only the last tic is drawn: it is the one the observation samples
+    module._DG_RunTics(tics, 1);
+
+    // Views are rebuilt only when memory growth replaced the heap
+    const gray = this.observationGray ? 1 : 0;
+    const framePtr = module._DG_GetObservation(this.observationShrink, gray);
+    const varsPtr = module._DG_GetStepVars();
+    let result = this.stepResult;
+    if (!result || result.frame.buffer !== module.HEAPU8.buffer) {
+      const width = Math.floor(NATIVE_WIDTH / this.observationShrink);
+      const height = Math.floor(NATIVE_HEIGHT / this.observationShrink);
+      const channels = this.observationGray ? 1 : 3;
+      result = this.stepResult = {
+        frame: module.HEAPU8.subarray(framePtr, framePtr + width * height * channels),
+        width,
+        height,
+        channels,
+        gamevars: module.HEAP32.subarray(varsPtr >> 2, (varsPtr >> 2) + STEP_VARS_SIZE),
+      };
+    }
+    return result;
   }
 
   /**
@@ -263,12 +902,194 @@ export class DoomEngine {
     return buffer;
   }
 
+  /**
+   * Get the current frame as a view into WASM memory (no copy)
+   * One 0xAARRGGBB value per pixel, DOOM_WIDTH x DOOM_HEIGHT, valid until the next tick.
+   */
+  getFrameBufferView(): Uint32Array | null {
+    if (!this.module || !this.initialized) return null;
+    const start = this.frameBufferPtr >> 2;
+    return this.module.HEAPU32.subarray(start, start + DOOM_WIDTH * DOOM_HEIGHT);
+  }
+
+  /**
+   * Size of this instance's WASM linear memory in bytes
+   */
+  getWasmMemoryBytes(): number {
+    return this.module ? this.module.HEAPU8.byteLength : 0;
+  }
+
   /**
    * Push a key event to DOOM
    */
   pushKey(pressed: boolean, key: number): void {
     if (!this.module || !this.initialized) return;
-    this.module._DG_PushKeyEvent(pressed ? 1 : 0, key);
+    const queued = this.module._DG_PushKeyEvent(pressed ? 1 : 0, key);
+    this.metrics?.key(queued !== 0, performance.now());
+  }
+
+  /**
+   * Whether the automap is currently displayed
+   */
+  isAutomapActive(): boolean {
+    if (!this.module || !this.initialized) return false;
+    return this.module._DG_IsAutomapActive() !== 0;
+  }
+
+  /**
+   * Get the automap line list for the current frame
+   * Returns a view into WASM memory (no copy), valid until the next tick:
+   * a header of AUTOMAP_HEADER_SIZE ints ([0] line count, [1..3] player x, y,
+   * angle, [4..5] view centre, [6] scale, [7] window width, [8] cheat level,
+   * [9] thing count), then x1, y1, x2, y2, kind per line, then x, y, angle
+   * per thing
+   */
+  getAutomapLines(): Int32Array | null {
+    if (!this.module || !this.initialized) return null;
+    const ptr = this.module._DG_GetAutomapLines();
+    if (!ptr) return null;
+    const heap = this.module.HEAP32;
+    const start = ptr >> 2;
+    const count = heap[start] ?? 0;
+    const things = heap[start + AUTOMAP_THING_COUNT] ?? 0;
+    return heap.subarray(
+      start,
+      start + AUTOMAP_HEADER_SIZE + count * AUTOMAP_LINE_STRIDE + things * AUTOMAP_THING_STRIDE
+    );
+  }
+
+  /**
+   * Switch text HUD mode: full screen view, with status bar and messages
+   * exported through getHudState() instead of drawn into the framebuffer
+   */
+  setTextHud(enabled: boolean): void {
+    if (!this.module || !this.initialized) return;
+    this.module._DG_SetTextHud(enabled ? 1 : 0);
+  }
+
+  /**
+   * Steady palette: frames drawn during a pain, pickup or radiation suit
+   * flash keep the normal colours, so a flash does not change every cell;
+   * show it from getEngineState()[EngineState.PALETTE] instead
+   */
+  setSteadyPalette(enabled: boolean): void {
+    if (!this.module || !this.initialized) return;
+    this.module._DG_SetSteadyPalette(enabled ? 1 : 0);
+  }
+
+  /**
+   * Uncapped rendering: lets renderBetweenTics() draw frames between game
+   * tics; the game itself still runs at 35 tics a second
+   */
+  setUncapped(enabled: boolean): void {
+    if (!this.module || !this.initialized) return;
+    this.module._DG_SetUncapped(enabled ? 1 : 0);
+  }
+
+  /**
+   * Get the HUD state for the current frame
+   * Returns a view into WASM memory (no copy), laid out as dg_hud_state_t
+   */
+  getHudState(): Int32Array | null {
+    if (!this.module || !this.initialized) return null;
+    const ptr = this.module._DG_GetHudState();
+    if (!ptr) return null;
+    return this.module.HEAP32.subarray(ptr >> 2, (ptr >> 2) + HUD_STATE_SIZE);
+  }
+
+  /**
+   * Current game tic (advances at 35 Hz during play)
+   */
+  getGameTic(): number {
+    if (!this.module || !this.initialized) return 0;
+    return this.module.HEAP32[this.module._DG_GetDemoState() >> 2] ?? 0;
+  }
+
+  /**
+   * Engine state block: game state, menu/pause/automap flags, palette and
+   * player stats, refreshed by the engine every tick
+   * A view into WASM memory indexed by EngineState, kept across calls (it
+   * is only rebuilt when memory grows), so reading it every frame is free.
+   */
+  getEngineState(): Int32Array | null {
+    if (!this.module || !this.initialized || !this.engineStatePtr) return null;
+    const heap = this.module.HEAP32;
+    if (!this.engineState || this.engineState.buffer !== heap.buffer) {
+      const start = this.engineStatePtr >> 2;
+      this.engineState = heap.subarray(start, start + ENGINE_STATE_SIZE);
+    }
+    return this.engineState;
+  }
+
+  /**
+   * Timings of the last level load, stage by stage, indexed by LevelTiming
+   * (see formatLevelTimings); LOADS goes up by one for every level loaded.
+   * A view into WASM memory, kept across calls like getEngineState().
+   */
+  getLevelTimings(): Int32Array | null {
+    if (!this.module || !this.initialized) return null;
+    const heap = this.module.HEAP32;
+    if (!this.levelTimings || this.levelTimings.buffer !== heap.buffer) {
+      const start = this.module._DG_GetLevelTimings() >> 2;
+      this.levelTimings = heap.subarray(start, start + LEVEL_TIMINGS_SIZE);
+    }
+    return this.levelTimings;
+  }
+
+  /**
+   * Hash the playsim state (map objects, sectors, players, RNG index)
+   * Returns a view into WASM memory indexed by StateHash, valid until the
+   * next call. Equal hashes tic by tic mean a demo stays in sync.
+   */
+  getStateHash(): Uint32Array | null {
+    if (!this.module || !this.initialized) return null;
+    const start = this.module._DG_GetStateHash() >> 2;
+    return this.module.HEAPU32.subarray(start, start + STATE_HASH_SIZE);
+  }
+
+  /**
+   * Get the demo recorded so far (recordDemo) as a complete lump
+   * Copies the buffer and appends the end marker, so it can be taken at any
+   * time; once DOOM has ended the recording itself, its written file is read.
+   */
+  getDemo(): Uint8Array | null {
+    if (!this.module || !this.initialized || !this.recordDemo) return null;
+    const module = this.module;
+    const state = module.HEAP32.subarray(module._DG_GetDemoState() >> 2);
+    const [, recording = 0, , buffer = 0, length = 0] = state;
+
+    if (recording && buffer) {
+      const demo = new Uint8Array(length + 1);
+      demo.set(module.HEAPU8.subarray(buffer, buffer + length));
+      demo[length] = DEMO_MARKER;
+      return demo;
+    }
+    try {
+      return this.emscriptenFS?.readFile(`${DEMO_RECORD_NAME}.lmp`) ?? null;
+    } catch (_e) {
+      return null; // Not recording and nothing written
+    }
+  }
+
+  /**
+   * Result of a timedemo run (timeDemo), null until DOOM has ended it
+   * realtics are DOOM's 35 Hz clock ticks, gametics the tics played.
+   */
+  getTimeDemoResult(): { gametics: number; realtics: number } | null {
+    if (!this.module || !this.initialized) return null;
+    const state = this.module.HEAP32.subarray(this.module._DG_GetDemoState() >> 2);
+    const [, , , , , timed = 0, gametics = 0, realtics = 0] = state;
+    return timed ? { gametics, realtics } : null;
+  }
+
+  /**
+   * Read a NUL-terminated string from WASM memory
+   */
+  readCString(ptr: number): string {
+    if (!this.module || !ptr) return "";
+    const heap = this.module.HEAPU8;
+    const end = heap.indexOf(0, ptr);
+    return new TextDecoder().decode(heap.subarray(ptr, end < 0 ? heap.length : end));
   }
 
   isInitialized(): boolean {
@@ -280,6 +1101,7 @@ export class DoomEngine {
    * Call this periodically or after save operations to persist saves
    */
   syncSaves(): void {
+    if (!this.savesEnabled) return;
     if (!this.module || !this.emscriptenFS) {
       debugLog("Engine", "syncSaves: module or FS not available");
       return;
@@ -0,0 +1,162 @@
+/**
+ * DOOM Frame Composer
+ *
+ * Builds one frame of terminal cells from the engine: the vector automap
+ * when it is up, otherwise the half-block 3D view, either with the text HUD
+ * strip or the status bar below. Shared by the local terminal and remote
+ * sessions.
+ */
+
+import { DOOM_HEIGHT, EngineState, type DoomEngine } from "./doom-engine";
+import {
+  clearCellRows,
+  sampleHalfBlockRows,
+  sampleHalfBlocks,
+  type CellGrid,
+} from "./doom-cells";
+import { createAutomapRenderer, type AutomapRenderer } from "./doom-automap";
+import {
+  createTextHud,
+  HUD_ACTIVE,
+  HUD_MESSAGE,
+  HUD_MESSAGE_SEQ,
+  HUD_ROWS,
+  type TextHud,
+} from "./doom-hud";
+
+export interface FrameComposerOptions {
+  vectorAutomap?: boolean; // Draw the automap as braille lines (default: true)
+  textHud?: boolean; // Draw the status bar as a text strip (default: true)
+  flashStrip?: boolean; // Show palette flashes as one tinted row (default: false)
+}
+
+export interface FrameComposer {
+  /** Draw the current frame into the grid */
+  compose: (engine: DoomEngine, grid: CellGrid) => void;
+  /** Redraw everything next frame (the grid was cleared or resized) */
+  invalidate: () => void;
+  automap: AutomapRenderer | null;
+}
+
+// Status bar (ST_HEIGHT) and message line at 320x200, in framebuffer rows
+const STATUS_BAR_HEIGHT = (DOOM_HEIGHT * 32) / 200;
+const MESSAGE_HEIGHT = (DOOM_HEIGHT * 8) / 200;
+
+// Pain (PLAYPAL 1-8), pickup (9-12) and radiation suit (13) flash colours
+const PAIN_RGB = 0xff0000;
+const PICKUP_RGB = 0xd7ba45;
+const SUIT_RGB = 0x00c000;
+
+function scaleRgb(color: number, amount: number): number {
+  const r = Math.round(((color >> 16) & 0xff) * amount);
+  const g = Math.round(((color >> 8) & 0xff) * amount);
+  const b = Math.round((color & 0xff) * amount);
+  return (r << 16) | (g << 8) | b;
+}
+
+// Colour of the flash strip for a palette index, brighter as the flash is stronger
+function flashColor(palette: number): number {
+  if (palette >= 13) return SUIT_RGB;
+  if (palette >= 9) return scaleRgb(PICKUP_RGB, 0.4 + (0.6 * (palette - 8)) / 4);
+  return scaleRgb(PAIN_RGB, 0.4 + (0.6 * palette) / 8);
+}
+
+/**
+ * Create a composer; remember to call engine.setTextHud(true) when textHud is
+ * on, and engine.setSteadyPalette(true) when flashStrip is
+ */
+export function createFrameComposer(options: FrameComposerOptions = {}): FrameComposer {
+  const { vectorAutomap = true, textHud = true, flashStrip = false } = options;
+  const automap = vectorAutomap ? createAutomapRenderer() : null;
+  const hud: TextHud | null = textHud ? createTextHud() : null;
+  let messageSeq = 0;
+
+  // Draw the text HUD strip at the bottom, if it is up; returns the rows above it
+  function drawHud(engine: DoomEngine, grid: CellGrid): number {
+    const state = hud ? engine.getHudState() : null;
+    if (!hud || !state || !state[HUD_ACTIVE] || grid.height <= HUD_ROWS) {
+      hud?.invalidate();
+      return grid.height;
+    }
+    const top = grid.height - HUD_ROWS;
+    // The latest message stays in the state; read it when a new one is taken
+    const messagePtr = state[HUD_MESSAGE] ?? 0;
+    let message: string | null = null;
+    if (messagePtr && state[HUD_MESSAGE_SEQ] !== messageSeq) {
+      messageSeq = state[HUD_MESSAGE_SEQ] ?? 0;
+      message = engine.readCString(messagePtr);
+    }
+    hud.draw(grid, top, state, message);
+    return top;
+  }
+
+  return {
+    automap,
+
+    compose(engine: DoomEngine, grid: CellGrid): void {
+      // The menu and pause graphic draw over the automap; show it sampled then
+      const state = engine.getEngineState();
+      const covered = !!state && (state[EngineState.MENU_ACTIVE] || state[EngineState.PAUSED]);
+
+      // Draw the automap straight from its line list, skipping the pixel
+      // sampler, in the rows its window has; the status bar and messages
+      // keep theirs
+      if (automap && !covered && engine.isAutomapActive()) {
+        const lines = engine.getAutomapLines();
+        if (lines) {
+          const hudTop = drawHud(engine, grid);
+          if (hudTop < grid.height) {
+            automap.draw(grid, lines, hudTop);
+            return;
+          }
+          const barRows = Math.round((grid.height * STATUS_BAR_HEIGHT) / DOOM_HEIGHT);
+          const mapRows = grid.height - barRows;
+          automap.draw(grid, lines, mapRows);
+          const pixels = engine.getFrameBufferView();
+          if (pixels) {
+            const messageRows = Math.min(
+              mapRows,
+              Math.ceil((grid.height * MESSAGE_HEIGHT) / DOOM_HEIGHT)
+            );
+            const messageHeight = (messageRows * DOOM_HEIGHT) / grid.height;
+            sampleHalfBlockRows(grid, pixels, 0, messageRows, 0, messageHeight);
+            sampleHalfBlockRows(
+              grid,
+              pixels,
+              mapRows,
+              barRows,
+              DOOM_HEIGHT - STATUS_BAR_HEIGHT,
+              STATUS_BAR_HEIGHT
+            );
+          }
+          return;
+        }
+      }
+
+      // Status bar and messages go to a text strip; the 3D view gets the rows
+      // above it. The rasterized automap draws its own status bar instead.
+      let viewHeight = grid.height;
+      if (engine.isAutomapActive()) {
+        hud?.invalidate();
+      } else {
+        viewHeight = drawHud(engine, grid);
+      }
+
+      const pixels = engine.getFrameBufferView();
+      if (pixels) {
+        sampleHalfBlocks(grid, pixels, viewHeight);
+      }
+
+      // The view keeps its colours through a flash (steady palette); one
+      // row carries the flash instead of every cell changing colour
+      if (flashStrip) {
+        const palette = engine.getEngineState()?.[EngineState.PALETTE] ?? 0;
+        if (palette) clearCellRows(grid, 0, 1, flashColor(palette));
+      }
+    },
+
+    invalidate(): void {
+      hud?.invalidate();
+    },
+  };
+}
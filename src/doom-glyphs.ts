@@ -0,0 +1,41 @@
+/**
+ * DOOM Glyph and Colour Strings
+ *
+ * Strings shared by the frame outputs (doom-screen.ts for OpenTUI,
+ * doom-ansi.ts for remote terminals), cached so that a frame of repeated
+ * glyphs and colours does not allocate.
+ */
+
+// Glyph strings by code point
+const glyphCache = new Map<number, string>();
+
+/**
+ * The string for a code point
+ */
+export function glyph(codePoint: number): string {
+  let text = glyphCache.get(codePoint);
+  if (text === undefined) {
+    text = String.fromCodePoint(codePoint);
+    glyphCache.set(codePoint, text);
+  }
+  return text;
+}
+
+// SGR sequences by layer and colour; DOOM's palettes keep the set small,
+// the limit only guards against unbounded growth
+const sgrCache = new Map<number, string>();
+const SGR_CACHE_LIMIT = 16384;
+
+/**
+ * Truecolor SGR sequence setting the foreground (38) or background (48)
+ */
+export function sgrColor(layer: 38 | 48, color: number): string {
+  const key = (layer === 48 ? 0x1000000 : 0) + (color & 0xffffff);
+  let text = sgrCache.get(key);
+  if (text === undefined) {
+    text = `\x1b[${layer};2;${(color >> 16) & 0xff};${(color >> 8) & 0xff};${color & 0xff}m`;
+    if (sgrCache.size >= SGR_CACHE_LIMIT) sgrCache.clear();
+    sgrCache.set(key, text);
+  }
+  return text;
+}
@@ -0,0 +1,156 @@
+/**
+ * DOOM Text HUD
+ *
+ * Shows the status bar (health, armor, ammo, keys) and hu_stuff messages
+ * as real terminal text in a strip below the 3D view, instead of sampling
+ * the rasterized status bar down into half-block cells.
+ */
+
+import { HUD_STATE_SIZE } from "./doom-engine";
+import { clearCellRows, drawCellText, type CellGrid } from "./doom-cells";
+
+// Rows reserved for the HUD strip at the bottom of the screen
+export const HUD_ROWS = 2;
+
+// HUD state layout (must match dg_hud_state_t in doom_js_hud.c)
+export const HUD_ACTIVE = 0;
+const HUD_HEALTH = 1;
+const HUD_ARMOR = 2;
+const HUD_ARMORTYPE = 3;
+const HUD_WEAPON = 4;
+const HUD_READYAMMO = 5;
+const HUD_AMMO = 6;
+const HUD_MAXAMMO = 10;
+const HUD_CARDS = 14;
+const HUD_KILLS = 29;
+const HUD_TOTALKILLS = 30;
+const HUD_ITEMS = 31;
+const HUD_TOTALITEMS = 32;
+const HUD_SECRETS = 33;
+const HUD_TOTALSECRETS = 34;
+export const HUD_MESSAGE = 35;
+export const HUD_MESSAGE_SEQ = 36; // Goes up by one for every message taken
+
+// Messages stay up as long as hu_stuff shows them (HU_MSGTIMEOUT)
+const MESSAGE_TIMEOUT_MS = 4000;
+
+const WEAPON_NAMES = [
+  "FIST",
+  "PISTOL",
+  "SHOTGUN",
+  "CHAINGUN",
+  "ROCKET L.",
+  "PLASMA",
+  "BFG9000",
+  "CHAINSAW",
+  "SUPER SG",
+];
+
+// Ammo in status bar order: bullets, shells, rockets, cells (am_clip, am_shell, am_misl, am_cell)
+const AMMO_ORDER = [0, 1, 3, 2];
+const AMMO_NAMES = ["BULL", "SHEL", "CELL", "RCKT"];
+
+// Key cards and skulls (it_bluecard .. it_redskull)
+const KEY_COLORS = [0x5050ff, 0xffff00, 0xff2828];
+
+const LABEL = 0x969696;
+const VALUE = 0xff3c3c;
+const LOW_VALUE = 0xffff00;
+const MESSAGE = 0xffc850;
+
+export interface TextHud {
+  /**
+   * Draw the HUD strip into rows [top, top + HUD_ROWS) of the grid; `message`
+   * is a newly taken message to show, null if there is none
+   */
+  draw: (grid: CellGrid, top: number, state: Int32Array, message: string | null) => void;
+  /** Force a full redraw next time (the strip rows were drawn over) */
+  invalidate: () => void;
+}
+
+/**
+ * Create a HUD that redraws only when the player's state or message changes
+ */
+export function createTextHud(): TextHud {
+  const lastState = new Int32Array(HUD_STATE_SIZE);
+  let lastWidth = -1;
+  let lastTop = -1;
+  let currentMessage: string | null = null;
+  let messageExpires = 0;
+
+  function changed(state: Int32Array): boolean {
+    for (let i = 0; i < HUD_MESSAGE; i++) {
+      if (lastState[i] !== state[i]) return true;
+    }
+    return false;
+  }
+
+  return {
+    draw(grid: CellGrid, top: number, state: Int32Array, message: string | null): void {
+      const now = Date.now();
+      let dirty = grid.width !== lastWidth || top !== lastTop || changed(state);
+
+      if (message) {
+        currentMessage = message;
+        messageExpires = now + MESSAGE_TIMEOUT_MS;
+        dirty = true;
+      } else if (currentMessage && now > messageExpires) {
+        currentMessage = null;
+        dirty = true;
+      }
+
+      if (!dirty) return;
+      lastState.set(state.subarray(0, HUD_STATE_SIZE));
+      lastWidth = grid.width;
+      lastTop = top;
+
+      clearCellRows(grid, top, HUD_ROWS);
+
+      // Message line
+      if (currentMessage) {
+        drawCellText(grid, 1, top, currentMessage, MESSAGE);
+      }
+
+      // Status line
+      const y = top + 1;
+      const health = state[HUD_HEALTH] ?? 0;
+      const armor = state[HUD_ARMOR] ?? 0;
+      const armorColor = (state[HUD_ARMORTYPE] ?? 0) > 1 ? LOW_VALUE : VALUE;
+      const readyAmmo = state[HUD_READYAMMO] ?? -1;
+      let x = 1;
+
+      x = drawCellText(grid, x, y, "HEALTH ", LABEL);
+      x = drawCellText(grid, x, y, `${health}%`, health <= 25 ? LOW_VALUE : VALUE);
+      x = drawCellText(grid, x, y, "  ARMOR ", LABEL);
+      x = drawCellText(grid, x, y, `${armor}%`, armorColor);
+      x = drawCellText(grid, x, y, `  ${WEAPON_NAMES[state[HUD_WEAPON] ?? 0] ?? "?"} `, LABEL);
+      x = drawCellText(grid, x, y, readyAmmo < 0 ? "--" : `${readyAmmo}`, VALUE);
+
+      x = drawCellText(grid, x, y, "  KEYS ", LABEL);
+      for (let key = 0; key < 3; key++) {
+        const card = state[HUD_CARDS + key] ?? 0;
+        const skull = state[HUD_CARDS + 3 + key] ?? 0;
+        const color = KEY_COLORS[key] ?? LABEL;
+        x = drawCellText(grid, x, y, skull ? "◆" : card ? "■" : "·", color);
+      }
+
+      for (const ammo of AMMO_ORDER) {
+        const count = state[HUD_AMMO + ammo] ?? 0;
+        const max = state[HUD_MAXAMMO + ammo] ?? 0;
+        x = drawCellText(grid, x, y, `  ${AMMO_NAMES[ammo]} `, LABEL);
+        x = drawCellText(grid, x, y, `${count}/${max}`, VALUE);
+      }
+
+      x = drawCellText(grid, x, y, "  K ", LABEL);
+      x = drawCellText(grid, x, y, `${state[HUD_KILLS]}/${state[HUD_TOTALKILLS]}`, VALUE);
+      x = drawCellText(grid, x, y, " I ", LABEL);
+      x = drawCellText(grid, x, y, `${state[HUD_ITEMS]}/${state[HUD_TOTALITEMS]}`, VALUE);
+      x = drawCellText(grid, x, y, " S ", LABEL);
+      drawCellText(grid, x, y, `${state[HUD_SECRETS]}/${state[HUD_TOTALSECRETS]}`, VALUE);
+    },
+
+    invalidate(): void {
+      lastWidth = -1;
+    },
+  };
+}
@@ -1,11 +1,13 @@
 /**
  * DOOM Input Handler
  *
- * Maps OpenTUI keyboard events to DOOM key codes
+ * Maps OpenTUI keyboard events (or raw terminal input from remote
+ * sessions) to DOOM key codes
  */
 
 import type { KeyEvent } from "@opentui/core";
 import type { DoomEngine } from "./doom-engine";
+import type { KeyBindings } from "./doom-bindings";
 
 // DOOM key codes (from doomkeys.h)
 export const DoomKeys = {
@@ -52,95 +54,235 @@ export const DoomKeys = {
   KEY_DEL: 0x80 + 0x53,
 } as const;
 
-// Key state tracking for press/release
-const keyStates = new Map<string, boolean>();
+// The parts of a key event the mapping looks at
+export type DoomKeyInput = Pick<KeyEvent, "name" | "sequence" | "ctrl" | "meta" | "shift">;
 
 /**
- * Map an OpenTUI key event to DOOM key code(s)
+ * Map an OpenTUI key event to DOOM key code(s), from the compiled bindings
  * Returns an array of key codes - for most keys this is a single code,
- * but for WASD we return both the movement key AND the character
+ * but WASD send both the movement key AND the character by default,
  * so both gameplay movement and text input work.
  */
-function mapKeyToDoom(key: KeyEvent): number[] {
+function mapKeyToDoom(key: DoomKeyInput, bindings: KeyBindings): readonly number[] {
   const name = key.name?.toLowerCase() ?? "";
+  const bound = bindings.keys.get(name) ?? bindings.keys.get(key.sequence ?? "");
+  if (bound) return bound;
 
-  // Arrow keys
-  if (name === "up" || key.sequence === "\x1b[A") return [DoomKeys.KEY_UPARROW];
-  if (name === "down" || key.sequence === "\x1b[B") return [DoomKeys.KEY_DOWNARROW];
-  if (name === "left" || key.sequence === "\x1b[D") return [DoomKeys.KEY_LEFTARROW];
-  if (name === "right" || key.sequence === "\x1b[C") return [DoomKeys.KEY_RIGHTARROW];
-
-  // WASD movement - send BOTH movement key AND character
-  // Movement key ensures gameplay works, character ensures text input works
-  if (name === "w") return [DoomKeys.KEY_UPARROW, "w".charCodeAt(0)];
-  if (name === "s") return [DoomKeys.KEY_DOWNARROW, "s".charCodeAt(0)];
-  if (name === "a") return [DoomKeys.KEY_STRAFE_L, "a".charCodeAt(0)];
-  if (name === "d") return [DoomKeys.KEY_STRAFE_R, "d".charCodeAt(0)];
-
-  // Action keys
-  if (name === "space") return [" ".charCodeAt(0)]; // Use
-  if (name === "return" || name === "enter") return [DoomKeys.KEY_ENTER];
-  if (name === "escape") return [DoomKeys.KEY_ESCAPE];
-  if (name === "tab") return [DoomKeys.KEY_TAB];
-  if (name === "backspace") return [DoomKeys.KEY_BACKSPACE];
-
-  // Fire (Ctrl) - but not Ctrl+C which should exit
-  if (key.ctrl && key.name !== "c") return [DoomKeys.KEY_FIRE];
-
-  // Alt for strafe
-  if (key.meta || key.name === "alt") return [DoomKeys.KEY_LALT];
-
-  // Shift for run
-  if (key.shift) return [DoomKeys.KEY_RSHIFT];
-
-  // Function keys
-  if (name === "f1") return [DoomKeys.KEY_F1];
-  if (name === "f2") return [DoomKeys.KEY_F2];
-  if (name === "f3") return [DoomKeys.KEY_F3];
-  if (name === "f4") return [DoomKeys.KEY_F4];
-  if (name === "f5") return [DoomKeys.KEY_F5];
-  if (name === "f6") return [DoomKeys.KEY_F6];
-  if (name === "f7") return [DoomKeys.KEY_F7];
-  if (name === "f8") return [DoomKeys.KEY_F8];
-  if (name === "f9") return [DoomKeys.KEY_F9];
-  if (name === "f10") return [DoomKeys.KEY_F10];
-  if (name === "f11") return [DoomKeys.KEY_F11];
-  if (name === "f12") return [DoomKeys.KEY_F12];
-
-  // Weapon selection (1-9, 0)
-  if (name >= "0" && name <= "9") return [name.charCodeAt(0)];
-
-  // Plus/minus for gamma/zoom
-  if (name === "+" || name === "=") return [DoomKeys.KEY_EQUALS];
-  if (name === "-") return [DoomKeys.KEY_MINUS];
-
-  // Y/N for prompts
-  if (name === "y") return ["y".charCodeAt(0)];
-  if (name === "n") return ["n".charCodeAt(0)];
-
-  // Other letter keys (for cheats, etc)
-  if (name.length === 1 && name >= "a" && name <= "z") {
-    return [name.charCodeAt(0)];
+  // Chords of unbound keys: Ctrl fires (but not Ctrl+C, which exits), Alt
+  // strafes, Shift runs
+  if (key.ctrl && key.name !== "c" && bindings.ctrl.length > 0) return bindings.ctrl;
+  if (key.meta && bindings.meta.length > 0) return bindings.meta;
+  if (key.shift && bindings.shift.length > 0) return bindings.shift;
+
+  // Letters (cheats, save names), digits (weapons), F-keys, +/-
+  return bindings.typed.get(name) ?? [];
+}
+
+// Escape sequences sent by terminals for special keys
+export const ESCAPE_SEQUENCES: Record<string, string> = {
+  "\x1b[A": "up",
+  "\x1b[B": "down",
+  "\x1b[C": "right",
+  "\x1b[D": "left",
+  "\x1bOA": "up",
+  "\x1bOB": "down",
+  "\x1bOC": "right",
+  "\x1bOD": "left",
+  "\x1bOP": "f1",
+  "\x1bOQ": "f2",
+  "\x1bOR": "f3",
+  "\x1bOS": "f4",
+  "\x1b[15~": "f5",
+  "\x1b[17~": "f6",
+  "\x1b[18~": "f7",
+  "\x1b[19~": "f8",
+  "\x1b[20~": "f9",
+  "\x1b[21~": "f10",
+  "\x1b[23~": "f11",
+  "\x1b[24~": "f12",
+};
+
+/**
+ * Split raw terminal input (as read from a socket) into key events
+ * Covers what the game needs: arrows, F-keys, control and meta chords, letters.
+ */
+export function parseTerminalInput(data: string): DoomKeyInput[] {
+  const keys: DoomKeyInput[] = [];
+  let i = 0;
+
+  while (i < data.length) {
+    const ch = data[i]!;
+
+    if (ch === "\x1b") {
+      // CSI / SS3 sequence: ESC [ params final, or ESC O letter
+      const next = data[i + 1];
+      if (next === "[" || next === "O") {
+        let end = i + 2;
+        while (end < data.length && /[0-9;]/.test(data[end]!)) end++;
+        const sequence = data.slice(i, end + 1);
+        const name = ESCAPE_SEQUENCES[sequence];
+        if (name) {
+          keys.push({ name, sequence, ctrl: false, meta: false, shift: false });
+        }
+        i = end + 1;
+        continue;
+      }
+      // ESC followed by a printable character is Alt/Meta+char
+      if (next !== undefined && next !== "\x1b" && next >= " ") {
+        keys.push({
+          name: next.toLowerCase(),
+          sequence: ch + next,
+          ctrl: false,
+          meta: true,
+          shift: false,
+        });
+        i += 2;
+        continue;
+      }
+      keys.push({ name: "escape", sequence: ch, ctrl: false, meta: false, shift: false });
+      i++;
+      continue;
+    }
+
+    const code = ch.charCodeAt(0);
+    const key: DoomKeyInput = { name: ch, sequence: ch, ctrl: false, meta: false, shift: false };
+    if (ch === "\r" || ch === "\n") key.name = "return";
+    else if (ch === "\t") key.name = "tab";
+    else if (code === 0x7f || code === 0x08) key.name = "backspace";
+    else if (ch === " ") key.name = "space";
+    else if (code >= 1 && code <= 26) {
+      key.name = String.fromCharCode(code + 96);
+      key.ctrl = true;
+    } else if (ch >= "A" && ch <= "Z") {
+      key.name = ch.toLowerCase();
+      key.shift = true;
+    }
+    keys.push(key);
+    i++;
   }
 
-  return [];
+  return keys;
 }
 
+// Terminals send no key-up events, so a key counts as held while it keeps
+// repeating and is released this many tics (about 300 ms) after the last repeat
+const KEY_HOLD_TICS = 11;
+// DOOM only looks at the keydown of prompt answers; release them right away
+const CONFIRM_HOLD_TICS = 2;
+
+// Tics a release can be scheduled ahead (a power of two)
+const WHEEL_SLOTS = 32;
+// DOOM key codes fit in a byte
+const KEY_CODES = 256;
+
 /**
- * Create an input handler that forwards OpenTUI key events to DOOM
+ * Releases held DOOM keys once their deadline passes, counted in game
+ * tics: the loop that ticks the engine calls advance() after each tick, so
+ * releases line up with tics and no timers are armed per key.
+ * One scheduler per engine, shared by the keyboard and mouse handlers.
  */
-// Track release timers for each key
-const keyTimers = new Map<string, ReturnType<typeof setTimeout>>();
+export interface KeyReleaseScheduler {
+  /** Hold `key` for at least `tics` more tics (a held key is pressed again by its caller) */
+  hold: (key: number, tics: number) => void;
+  /** Whether `key` is held, i.e. has a release pending */
+  isHeld: (key: number) => boolean;
+  /** Release `key` now if it is held */
+  release: (key: number) => void;
+  /** Move on by the game tics run since the last call, releasing the keys due */
+  advance: () => void;
+  /** Release every held key */
+  releaseAll: () => void;
+}
+
+/**
+ * Create a release scheduler: a timer wheel of WHEEL_SLOTS slots, one per
+ * tic, holding key codes in one flat array. A key re-held before its
+ * deadline is not taken out of its old slot; that entry is skipped when
+ * its slot comes round, since the key's deadline no longer matches.
+ */
+export function createKeyReleaseScheduler(engine: DoomEngine): KeyReleaseScheduler {
+  const deadlines = new Int32Array(KEY_CODES).fill(-1);
+  const slotKeys = new Uint8Array(WHEEL_SLOTS * KEY_CODES);
+  const slotCounts = new Uint16Array(WHEEL_SLOTS);
+  let tic = 0;
+  let lastGameTic = engine.getGameTic();
+
+  const release = (key: number): void => {
+    if (deadlines[key] === -1) return;
+    deadlines[key] = -1;
+    engine.pushKey(false, key);
+  };
+
+  const releaseAll = (): void => {
+    for (let key = 0; key < KEY_CODES; key++) release(key);
+    slotCounts.fill(0);
+  };
+
+  return {
+    hold(key: number, tics: number): void {
+      const deadline = tic + Math.min(Math.max(1, tics), WHEEL_SLOTS - 1);
+      if (deadlines[key]! >= deadline) return;
+      deadlines[key] = deadline;
+      const slot = deadline & (WHEEL_SLOTS - 1);
+      const count = slotCounts[slot]!;
+      if (count < KEY_CODES) {
+        slotKeys[slot * KEY_CODES + count] = key;
+        slotCounts[slot] = count + 1;
+      }
+    },
+
+    isHeld(key: number): boolean {
+      return deadlines[key] !== -1;
+    },
+
+    release,
+
+    advance(): void {
+      // A tick runs as many tics as are due (none, or several after a
+      // stall); a game that started over (gametic went back) runs none
+      const gameTic = engine.getGameTic();
+      const tics = gameTic - lastGameTic;
+      lastGameTic = gameTic;
+      if (tics <= 0) return;
+      if (tics >= WHEEL_SLOTS) {
+        // Past every deadline there can be
+        tic += tics;
+        releaseAll();
+        return;
+      }
+      for (let step = 0; step < tics; step++) {
+        tic++;
+        const slot = tic & (WHEEL_SLOTS - 1);
+        const start = slot * KEY_CODES;
+        const end = start + slotCounts[slot]!;
+        slotCounts[slot] = 0;
+        for (let i = start; i < end; i++) {
+          const key = slotKeys[i]!;
+          if (deadlines[key] === tic) release(key);
+        }
+      }
+    },
+
+    releaseAll,
+  };
+}
 
 export interface DoomInputOptions {
   engine: DoomEngine;
+  releases: KeyReleaseScheduler; // Releases keys once they stop repeating
+  bindings: KeyBindings; // Which DOOM keys each terminal key sends
   onExit?: () => void;
 }
 
+/**
+ * Create an input handler that forwards key events to DOOM
+ * Held keys live in the engine's release scheduler, so several engines can
+ * run side by side.
+ */
 export function createDoomInputHandler(options: DoomInputOptions) {
-  const { engine, onExit } = options;
+  const { engine, releases, bindings, onExit } = options;
 
-  return (key: KeyEvent) => {
+  return (key: DoomKeyInput) => {
     // Handle Ctrl+C for exit
     if (key.ctrl && (key.name === "c" || key.sequence === "\x03")) {
       if (onExit) {
@@ -149,57 +291,25 @@ export function createDoomInputHandler(options: DoomInputOptions) {
       return;
     }
 
-    const doomKeys = mapKeyToDoom(key);
+    const doomKeys = mapKeyToDoom(key, bindings);
 
     if (doomKeys.length === 0) return;
 
-    const keyId = key.name || key.sequence || "";
-    const wasPressed = keyStates.get(keyId) ?? false;
     const keyName = key.name?.toLowerCase() ?? "";
 
     // Menu confirmation keys (y/n) should always send keydown on every press
     // These are used for quit dialogs and other prompts
     const isMenuConfirmKey = keyName === "y" || keyName === "n";
+    const holdTics = isMenuConfirmKey ? CONFIRM_HOLD_TICS : KEY_HOLD_TICS;
 
-    // Clear any existing release timer for this key
-    const existingTimer = keyTimers.get(keyId);
-    if (existingTimer) {
-      clearTimeout(existingTimer);
-      keyTimers.delete(keyId);
-    }
-
-    // Key press - send if not already pressed, OR if it's a menu confirmation key
-    if (!wasPressed || isMenuConfirmKey) {
-      keyStates.set(keyId, true);
-      // Send all mapped keys (for WASD this includes both movement and character)
-      for (const doomKey of doomKeys) {
+    // Send all mapped keys (for WASD this includes both movement and
+    // character) if not already held, and push their release back
+    for (const doomKey of doomKeys) {
+      if (!releases.isHeld(doomKey) || isMenuConfirmKey) {
         engine.pushKey(true, doomKey);
       }
-
-      // For menu confirmation keys, immediately send release too
-      // since DOOM only cares about the keydown event
-      if (isMenuConfirmKey) {
-        setTimeout(() => {
-          for (const doomKey of doomKeys) {
-            engine.pushKey(false, doomKey);
-          }
-          keyStates.set(keyId, false);
-        }, 50);
-        return;
-      }
+      releases.hold(doomKey, holdTics);
     }
-
-    // Schedule key release after 300ms of no input (for non-menu keys)
-    const timer = setTimeout(() => {
-      if (keyStates.get(keyId)) {
-        keyStates.set(keyId, false);
-        for (const doomKey of doomKeys) {
-          engine.pushKey(false, doomKey);
-        }
-        keyTimers.delete(keyId);
-      }
-    }, 300);
-    keyTimers.set(keyId, timer);
   };
 }
 
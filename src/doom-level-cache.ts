@@ -0,0 +1,48 @@
+/**
+ * Level Data Cache
+ *
+ * Data the engine derives from a map while loading it and would rather not
+ * derive again (a built blockmap, see doom_js_level.c), kept on disk under
+ * ~/.opentui-doom/levels/. Entries are keyed by a hash of the map's lumps,
+ * so an edited map gets a new entry and never reads a stale one.
+ */
+
+import { existsSync, mkdirSync, readFileSync, writeFileSync } from "fs";
+import { join } from "path";
+import { homedir } from "os";
+import { debugLog } from "./debug";
+
+// Default cache directory, next to the save games
+export const LEVEL_CACHE_DIR = join(homedir(), ".opentui-doom", "levels");
+
+// Keys come from the engine; anything else is refused rather than used as a path
+const KEY_PATTERN = /^[A-Za-z0-9-]+$/;
+
+/**
+ * Read a cache entry; null if there is none
+ */
+export function readLevelCache(dir: string, key: string): Uint8Array | null {
+  if (!KEY_PATTERN.test(key)) return null;
+  const path = join(dir, `${key}.bin`);
+  if (!existsSync(path)) return null;
+  try {
+    return new Uint8Array(readFileSync(path));
+  } catch (e) {
+    debugLog("LevelCache", `Failed to read ${path}: ${e}`);
+    return null;
+  }
+}
+
+/**
+ * Write a cache entry (best effort: a failed write only costs the next load)
+ */
+export function writeLevelCache(dir: string, key: string, data: Uint8Array): void {
+  if (!KEY_PATTERN.test(key)) return;
+  try {
+    if (!existsSync(dir)) mkdirSync(dir, { recursive: true });
+    writeFileSync(join(dir, `${key}.bin`), data);
+    debugLog("LevelCache", `Stored ${key} (${data.length} bytes)`);
+  } catch (e) {
+    debugLog("LevelCache", `Failed to write ${key}: ${e}`);
+  }
+}
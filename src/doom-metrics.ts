@@ -0,0 +1,351 @@
+/**
+ * DOOM Metrics
+ *
+ * Per-engine counters, gauges and latency histograms, scraped in the
+ * Prometheus text format from a Unix socket. Recording only bumps numbers
+ * in typed arrays allocated up front, so the tick and frame paths never
+ * allocate; all formatting happens when a scrape comes in. Gauges that are
+ * cheap to read on demand (WASM heap, sound voices, JS heap) are read then.
+ *
+ *   curl --unix-socket /tmp/doom-metrics.sock http://localhost/metrics
+ */
+
+import { createServer } from "net";
+import { existsSync, unlinkSync } from "fs";
+import { removeStaleSocket } from "./doom-wire";
+import { debugLog } from "./debug";
+
+// Latency histograms
+export const PHASE_TICK = 0; // doomgeneric_Tick
+export const PHASE_COMPOSE = 1; // Frame to cells
+export const PHASE_ENCODE = 2; // Cells to the wire (sessions)
+export const PHASE_PRESENT = 3; // Cells to the terminal (local)
+export const PHASE_INPUT = 4; // Key received to the end of the tick that read it
+const PHASE_NAMES = ["tick", "compose", "encode", "present"];
+const HISTOGRAMS = 5;
+
+// Bucket upper bounds in seconds; one tic is 28.6 ms
+const BUCKETS = [0.0005, 0.001, 0.002, 0.004, 0.008, 0.016, 0.032, 0.064, 0.128, 0.256];
+const BUCKETS_MS = BUCKETS.map((bound) => bound * 1000);
+// Per histogram: cumulative-free bucket counts, the +Inf bucket, sum (ms), count
+const HIST_STRIDE = BUCKETS.length + 3;
+const HIST_SUM = BUCKETS.length + 1;
+const HIST_COUNT = BUCKETS.length + 2;
+
+// Counters
+const C_FRAMES = 0;
+const C_TICS = 1;
+const C_BYTES_OUT = 2;
+const C_CHANGED_CELLS = 3;
+const C_KEYS = 4;
+const C_KEYS_DROPPED = 5;
+// Gauges and window state
+const S_FPS = 6;
+const S_TIC_RATE = 7;
+const S_WINDOW_START = 8;
+const S_WINDOW_FRAMES = 9;
+const S_WINDOW_TICS = 10;
+const S_LAST_GAMETIC = 11;
+const S_KEY_PENDING = 12; // Arrival time of the oldest key not yet ticked, 0 if none
+const STATE_SIZE = 13;
+
+// fps and tic rate are averaged over this window
+const RATE_WINDOW_MS = 1000;
+
+export interface EngineMetricsSources {
+  wasmBytes?: () => number; // WASM linear memory of the engine
+  voices?: () => number; // Sound voices playing
+}
+
+export interface EngineMetrics {
+  labels: string; // Prometheus labels without braces, e.g. session="3"
+  state: Float64Array;
+  histograms: Float64Array;
+  sources: EngineMetricsSources;
+  /** A tick took `ms` and ended at `now`; gametic is the game tic after it */
+  tick: (ms: number, now: number, gametic: number) => void;
+  /** Time spent in one frame phase (PHASE_*) */
+  phase: (phase: number, ms: number) => void;
+  /** A frame went out: bytes sent (0 if none) and cells that changed */
+  frame: (now: number, bytes: number, changedCells: number) => void;
+  /** A key event reached the engine (queued) or the key queue was full */
+  key: (queued: boolean, now: number) => void;
+}
+
+function escapeLabel(value: string): string {
+  return value.replace(/\\/g, "\\\\").replace(/"/g, '\\"').replace(/\n/g, "\\n");
+}
+
+/**
+ * Create the metrics of one engine, e.g. createEngineMetrics({ session: "3" })
+ */
+export function createEngineMetrics(
+  labels: Record<string, string>,
+  sources: EngineMetricsSources = {}
+): EngineMetrics {
+  const state = new Float64Array(STATE_SIZE);
+  const histograms = new Float64Array(HISTOGRAMS * HIST_STRIDE);
+  state[S_LAST_GAMETIC] = -1;
+
+  function observe(histogram: number, ms: number): void {
+    const base = histogram * HIST_STRIDE;
+    let bucket = 0;
+    while (bucket < BUCKETS_MS.length && ms > BUCKETS_MS[bucket]!) bucket++;
+    histograms[base + bucket]! += 1;
+    histograms[base + HIST_SUM]! += ms;
+    histograms[base + HIST_COUNT]! += 1;
+  }
+
+  function roll(now: number): void {
+    const elapsed = now - state[S_WINDOW_START]!;
+    if (elapsed < RATE_WINDOW_MS) return;
+    if (state[S_WINDOW_START]! > 0) {
+      state[S_FPS] = (state[S_WINDOW_FRAMES]! * 1000) / elapsed;
+      state[S_TIC_RATE] = (state[S_WINDOW_TICS]! * 1000) / elapsed;
+    }
+    state[S_WINDOW_START] = now;
+    state[S_WINDOW_FRAMES] = 0;
+    state[S_WINDOW_TICS] = 0;
+  }
+
+  return {
+    labels: Object.entries(labels)
+      .map(([name, value]) => `${name}="${escapeLabel(value)}"`)
+      .join(","),
+    state,
+    histograms,
+    sources,
+
+    tick(ms: number, now: number, gametic: number): void {
+      observe(PHASE_TICK, ms);
+      const last = state[S_LAST_GAMETIC]!;
+      if (last >= 0 && gametic > last) {
+        state[C_TICS]! += gametic - last;
+        state[S_WINDOW_TICS]! += gametic - last;
+      }
+      state[S_LAST_GAMETIC] = gametic;
+      if (state[S_KEY_PENDING]! > 0) {
+        observe(PHASE_INPUT, now - state[S_KEY_PENDING]!);
+        state[S_KEY_PENDING] = 0;
+      }
+      roll(now);
+    },
+
+    phase(phase: number, ms: number): void {
+      observe(phase, ms);
+    },
+
+    frame(now: number, bytes: number, changedCells: number): void {
+      state[C_FRAMES]! += 1;
+      state[S_WINDOW_FRAMES]! += 1;
+      state[C_BYTES_OUT]! += bytes;
+      state[C_CHANGED_CELLS]! += changedCells;
+      roll(now);
+    },
+
+    key(queued: boolean, now: number): void {
+      if (!queued) {
+        state[C_KEYS_DROPPED]! += 1;
+        return;
+      }
+      state[C_KEYS]! += 1;
+      if (state[S_KEY_PENDING] === 0) state[S_KEY_PENDING] = now;
+    },
+  };
+}
+
+export interface MetricsRegistry {
+  add: (metrics: EngineMetrics) => void;
+  remove: (metrics: EngineMetrics) => void;
+  /** All metrics in the Prometheus text exposition format */
+  render: () => string;
+}
+
+interface MetricDef {
+  name: string;
+  help: string;
+  type: "counter" | "gauge";
+  value: (metrics: EngineMetrics) => number;
+}
+
+const ENGINE_METRICS: MetricDef[] = [
+  { name: "doom_fps", help: "Frames per second", type: "gauge", value: (m) => m.state[S_FPS]! },
+  {
+    name: "doom_tic_rate",
+    help: "Game tics per second",
+    type: "gauge",
+    value: (m) => m.state[S_TIC_RATE]!,
+  },
+  {
+    name: "doom_frames_total",
+    help: "Frames composed",
+    type: "counter",
+    value: (m) => m.state[C_FRAMES]!,
+  },
+  {
+    name: "doom_tics_total",
+    help: "Game tics run",
+    type: "counter",
+    value: (m) => m.state[C_TICS]!,
+  },
+  {
+    name: "doom_bytes_out_total",
+    help: "Frame bytes sent to the client",
+    type: "counter",
+    value: (m) => m.state[C_BYTES_OUT]!,
+  },
+  {
+    name: "doom_changed_cells_total",
+    help: "Terminal cells that changed between frames",
+    type: "counter",
+    value: (m) => m.state[C_CHANGED_CELLS]!,
+  },
+  {
+    name: "doom_key_events_total",
+    help: "Key events queued for the engine",
+    type: "counter",
+    value: (m) => m.state[C_KEYS]!,
+  },
+  {
+    name: "doom_key_events_dropped_total",
+    help: "Key events dropped because the engine's key queue was full",
+    type: "counter",
+    value: (m) => m.state[C_KEYS_DROPPED]!,
+  },
+  {
+    name: "doom_sound_voices",
+    help: "Sound voices playing",
+    type: "gauge",
+    value: (m) => m.sources.voices?.() ?? 0,
+  },
+  {
+    name: "doom_wasm_heap_bytes",
+    help: "WASM linear memory of the engine",
+    type: "gauge",
+    value: (m) => m.sources.wasmBytes?.() ?? 0,
+  },
+];
+
+function renderHistogram(
+  out: string[],
+  name: string,
+  help: string,
+  engines: Iterable<EngineMetrics>,
+  histogram: (phase: number) => boolean,
+  phaseLabel: boolean
+): void {
+  out.push(`# HELP ${name} ${help}`, `# TYPE ${name} histogram`);
+  for (const metrics of engines) {
+    for (let phase = 0; phase < HISTOGRAMS; phase++) {
+      if (!histogram(phase)) continue;
+      const base = phase * HIST_STRIDE;
+      const labels = phaseLabel
+        ? `${metrics.labels}${metrics.labels ? "," : ""}phase="${PHASE_NAMES[phase]}"`
+        : metrics.labels;
+      const sep = labels ? "," : "";
+      let cumulative = 0;
+      for (let bucket = 0; bucket <= BUCKETS.length; bucket++) {
+        cumulative += metrics.histograms[base + bucket]!;
+        const le = bucket < BUCKETS.length ? `${BUCKETS[bucket]}` : "+Inf";
+        out.push(`${name}_bucket{${labels}${sep}le="${le}"} ${cumulative}`);
+      }
+      out.push(`${name}_sum{${labels}} ${metrics.histograms[base + HIST_SUM]! / 1000}`);
+      out.push(`${name}_count{${labels}} ${metrics.histograms[base + HIST_COUNT]!}`);
+    }
+  }
+}
+
+/**
+ * Create the set of engines a metrics endpoint reports on
+ */
+export function createMetricsRegistry(): MetricsRegistry {
+  const engines = new Set<EngineMetrics>();
+
+  return {
+    add: (metrics: EngineMetrics) => void engines.add(metrics),
+    remove: (metrics: EngineMetrics) => void engines.delete(metrics),
+
+    render(): string {
+      const out: string[] = [];
+      out.push("# HELP doom_engines Running engines", "# TYPE doom_engines gauge");
+      out.push(`doom_engines ${engines.size}`);
+      // One JS heap for every engine in the process
+      out.push("# HELP doom_js_heap_bytes JS heap in use", "# TYPE doom_js_heap_bytes gauge");
+      out.push(`doom_js_heap_bytes ${process.memoryUsage().heapUsed}`);
+
+      for (const def of ENGINE_METRICS) {
+        out.push(`# HELP ${def.name} ${def.help}`, `# TYPE ${def.name} ${def.type}`);
+        for (const metrics of engines) {
+          out.push(`${def.name}{${metrics.labels}} ${def.value(metrics)}`);
+        }
+      }
+      renderHistogram(
+        out,
+        "doom_phase_seconds",
+        "Time per frame phase",
+        engines,
+        (phase) => phase !== PHASE_INPUT,
+        true
+      );
+      renderHistogram(
+        out,
+        "doom_input_latency_seconds",
+        "Key received to the end of the tick that read it",
+        engines,
+        (phase) => phase === PHASE_INPUT,
+        false
+      );
+      return out.join("\n") + "\n";
+    },
+  };
+}
+
+export interface MetricsServer {
+  /** Stop listening and remove the socket file */
+  close(): void;
+}
+
+/**
+ * Serve the registry on a Unix socket
+ * HTTP requests (Prometheus, curl --unix-socket) get an HTTP response; a
+ * client that sends nothing (socat, nc -U) gets the bare text.
+ */
+export function serveMetrics(path: string, registry: MetricsRegistry): MetricsServer {
+  removeStaleSocket(path);
+
+  const server = createServer((socket) => {
+    let answered = false;
+    const answer = (http: boolean) => {
+      if (answered) return;
+      answered = true;
+      clearTimeout(timer);
+      const body = registry.render();
+      if (http) {
+        socket.end(
+          "HTTP/1.1 200 OK\r\n" +
+            "Content-Type: text/plain; version=0.0.4\r\n" +
+            `Content-Length: ${Buffer.byteLength(body)}\r\n` +
+            "Connection: close\r\n\r\n" +
+            body
+        );
+      } else {
+        socket.end(body);
+      }
+    };
+    const timer = setTimeout(() => answer(false), 200);
+    socket.on("data", (data: Buffer) => answer(data.subarray(0, 4).toString() === "GET "));
+    socket.on("error", (e) => debugLog("Metrics", `socket error: ${e}`));
+    socket.on("close", () => clearTimeout(timer));
+  });
+  server.on("error", (e) => console.error(`[metrics] ${e}`));
+  server.listen(path);
+
+  return {
+    close(): void {
+      server.close();
+      // Unlinked now, not on "close": that waits for open connections, and
+      // the process may exit first
+      if (existsSync(path)) unlinkSync(path);
+    },
+  };
+}
@@ -7,11 +7,12 @@
  */
 
 import type { DoomEngine } from "./doom-engine";
-import { DoomKeys } from "./doom-input";
+import { DoomKeys, type KeyReleaseScheduler } from "./doom-input";
 import { debugLog } from "./debug";
 
 export interface DoomMouseOptions {
   engine: DoomEngine;
+  releases: KeyReleaseScheduler; // Releases the turn key once the mouse stops
   sensitivity?: number; // Cells of movement before triggering turn (default: 2)
 }
 
@@ -26,14 +27,13 @@ export interface DoomMouseHandler {
  * Create a mouse handler that forwards mouse events to DOOM
  */
 export function createDoomMouseHandler(options: DoomMouseOptions): DoomMouseHandler {
-  const { engine } = options;
+  const { engine, releases } = options;
 
   let lastMouseX: number | null = null;
   let isLeftMouseDown = false;
   let currentTurnKey: number | null = null;
-  let releaseTimer: ReturnType<typeof setTimeout> | null = null;
 
-  const RELEASE_DELAY = 100; // Release key 100ms after last movement
+  const RELEASE_TICS = 4; // Release key ~100ms after last movement
 
   return {
     /**
@@ -52,29 +52,19 @@ export function createDoomMouseHandler(options: DoomMouseOptions): DoomMouseHand
 
       const newTurnKey = delta > 0 ? DoomKeys.KEY_RIGHTARROW : DoomKeys.KEY_LEFTARROW;
 
-      // Clear any pending release
-      if (releaseTimer) {
-        clearTimeout(releaseTimer);
-        releaseTimer = null;
-      }
-
       // If direction changed, release old and press new
       if (currentTurnKey !== newTurnKey) {
         if (currentTurnKey !== null) {
-          engine.pushKey(false, currentTurnKey);
+          releases.release(currentTurnKey);
         }
-        engine.pushKey(true, newTurnKey);
         currentTurnKey = newTurnKey;
       }
+      if (!releases.isHeld(newTurnKey)) {
+        engine.pushKey(true, newTurnKey);
+      }
 
-      // Schedule release after delay (will be cancelled if more movement comes)
-      releaseTimer = setTimeout(() => {
-        if (currentTurnKey !== null) {
-          engine.pushKey(false, currentTurnKey);
-          currentTurnKey = null;
-        }
-        releaseTimer = null;
-      }, RELEASE_DELAY);
+      // Push the release back (more movement pushes it back again)
+      releases.hold(newTurnKey, RELEASE_TICS);
     },
 
     /**
@@ -107,15 +97,9 @@ export function createDoomMouseHandler(options: DoomMouseOptions): DoomMouseHand
     reset(): void {
       lastMouseX = null;
 
-      // Clear pending release timer
-      if (releaseTimer) {
-        clearTimeout(releaseTimer);
-        releaseTimer = null;
-      }
-
       // Release any held turn key
       if (currentTurnKey !== null) {
-        engine.pushKey(false, currentTurnKey);
+        releases.release(currentTurnKey);
         currentTurnKey = null;
       }
 
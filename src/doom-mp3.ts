@@ -0,0 +1,1048 @@
+/**
+ * MP3 Decoder
+ *
+ * Decodes the MPEG-1 Layer III music under sound/ in-process, one frame
+ * (1152 samples) at a time, for the PCM sink (doom-pcm.ts). The encoder
+ * delay and padding that LAME records in its "Info" frame are trimmed, so a
+ * track started again from the top (rewind) loops without a gap or a click.
+ *
+ * Follows ISO/IEC 11172-3: Huffman decoding with the Annex B tables,
+ * requantization, joint stereo, alias reduction, the IMDCT and the
+ * polyphase synthesis filterbank, written out plainly rather than with fast
+ * transforms: it still decodes about 25 times faster than real time. The half sample rate
+ * extensions (MPEG-2 and 2.5) are not supported.
+ */
+
+export interface Mp3Decoder {
+  sampleRate: number;
+  /**
+   * Decode up to `frames` stereo frames into `out` (interleaved left/right,
+   * -1..1), returning how many were written; 0 once the track is over
+   */
+  read: (out: Float32Array, frames: number) => number;
+  /** Start again from the first sample */
+  rewind: () => void;
+}
+
+// Samples per channel in a frame, and in each of its two granules
+const FRAME_SAMPLES = 1152;
+const GRANULE_SAMPLES = 576;
+
+// Delay of the decoder's filterbank, trimmed along with LAME's encoder delay
+const DECODER_DELAY = 529;
+
+// Enough for main_data_begin (at most 511 bytes back) and one frame
+const RESERVOIR_SIZE = 4096;
+
+// Layer III bitrates (kbit/s) and sample rates of MPEG-1
+const BITRATES = [0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320];
+const SAMPLE_RATES = [44100, 48000, 32000];
+
+// Scalefactor band boundaries by sample rate: over the 576 lines of a long
+// block, and over the 192 lines of each window of a short block
+const LONG_BANDS = [
+  [
+    0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 52, 62, 74, 90, 110, 134, 162, 196, 238, 288, 342, 418,
+    576,
+  ],
+  [
+    0, 4, 8, 12, 16, 20, 24, 30, 36, 42, 50, 60, 72, 88, 106, 128, 156, 190, 230, 276, 330, 384,
+    576,
+  ],
+  [
+    0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 54, 66, 82, 102, 126, 156, 194, 240, 296, 364, 448, 550,
+    576,
+  ],
+];
+const SHORT_BANDS = [
+  [0, 4, 8, 12, 16, 22, 30, 40, 52, 66, 84, 106, 136, 192],
+  [0, 4, 8, 12, 16, 22, 28, 38, 50, 64, 80, 100, 126, 192],
+  [0, 4, 8, 12, 16, 22, 30, 42, 58, 78, 104, 138, 180, 192],
+];
+
+// Added to long block scalefactors when preflag is set
+const PRETAB = [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 3, 2, 0];
+
+// Scalefactor bit lengths (bands 0-10, bands 11-20) by scalefac_compress
+const SLEN1 = [0, 0, 0, 0, 3, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4];
+const SLEN2 = [0, 1, 2, 3, 0, 1, 2, 3, 1, 2, 3, 1, 2, 3, 2, 3];
+
+// Huffman code tables of Annex B: code and length in bits (sign bits not
+// included) of each (x, y) pair, by x * size + y
+const PAIR_CODES: Record<number, { codes: number[]; lengths: number[] }> = {
+  1: {
+    codes: [1, 1, 1, 0],
+    lengths: [1, 3, 2, 3],
+  },
+  2: {
+    codes: [1, 2, 1, 3, 1, 1, 3, 2, 0],
+    lengths: [1, 3, 6, 3, 3, 5, 5, 5, 6],
+  },
+  3: {
+    codes: [3, 2, 1, 1, 1, 1, 3, 2, 0],
+    lengths: [2, 2, 6, 3, 2, 5, 5, 5, 6],
+  },
+  5: {
+    codes: [1, 2, 6, 5, 3, 1, 4, 4, 7, 5, 7, 1, 6, 1, 1, 0],
+    lengths: [1, 3, 6, 7, 3, 3, 6, 7, 6, 6, 7, 8, 7, 6, 7, 8],
+  },
+  6: {
+    codes: [7, 3, 5, 1, 6, 2, 3, 2, 5, 4, 4, 1, 3, 3, 2, 0],
+    lengths: [3, 3, 5, 7, 3, 2, 4, 5, 4, 4, 5, 6, 6, 5, 6, 7],
+  },
+  7: {
+    codes: [
+      1, 2, 10, 19, 16, 10, 3, 3, 7, 10, 5, 3, 11, 4, 13, 17, 8, 4, 12, 11, 18, 15, 11, 2, 7, 6, 9,
+      14, 3, 1, 6, 4, 5, 3, 2, 0,
+    ],
+    lengths: [
+      1, 3, 6, 8, 8, 9, 3, 4, 6, 7, 7, 8, 6, 5, 7, 8, 8, 9, 7, 7, 8, 9, 9, 9, 7, 7, 8, 9, 9, 10, 8,
+      8, 9, 10, 10, 10,
+    ],
+  },
+  8: {
+    codes: [
+      3, 4, 6, 18, 12, 5, 5, 1, 2, 16, 9, 3, 7, 3, 5, 14, 7, 3, 19, 17, 15, 13, 10, 4, 13, 5, 8, 11,
+      5, 1, 12, 4, 4, 1, 1, 0,
+    ],
+    lengths: [
+      2, 3, 6, 8, 8, 9, 3, 2, 4, 8, 8, 8, 6, 4, 6, 8, 8, 9, 8, 8, 8, 9, 9, 10, 8, 7, 8, 9, 10, 10,
+      9, 8, 9, 9, 11, 11,
+    ],
+  },
+  9: {
+    codes: [
+      7, 5, 9, 14, 15, 7, 6, 4, 5, 5, 6, 7, 7, 6, 8, 8, 8, 5, 15, 6, 9, 10, 5, 1, 11, 7, 9, 6, 4, 1,
+      14, 4, 6, 2, 6, 0,
+    ],
+    lengths: [
+      3, 3, 5, 6, 8, 9, 3, 3, 4, 5, 6, 8, 4, 4, 5, 6, 7, 8, 6, 5, 6, 7, 7, 8, 7, 6, 7, 7, 8, 9, 8,
+      7, 8, 8, 9, 9,
+    ],
+  },
+  10: {
+    codes: [
+      1, 2, 10, 23, 35, 30, 12, 17, 3, 3, 8, 12, 18, 21, 12, 7, 11, 9, 15, 21, 32, 40, 19, 6, 14,
+      13, 22, 34, 46, 23, 18, 7, 20, 19, 33, 47, 27, 22, 9, 3, 31, 22, 41, 26, 21, 20, 5, 3, 14, 13,
+      10, 11, 16, 6, 5, 1, 9, 8, 7, 8, 4, 4, 2, 0,
+    ],
+    lengths: [
+      1, 3, 6, 8, 9, 9, 9, 10, 3, 4, 6, 7, 8, 9, 8, 8, 6, 6, 7, 8, 9, 10, 9, 9, 7, 7, 8, 9, 10, 10,
+      9, 10, 8, 8, 9, 10, 10, 10, 10, 10, 9, 9, 10, 10, 11, 11, 10, 11, 8, 8, 9, 10, 10, 10, 11, 11,
+      9, 8, 9, 10, 10, 11, 11, 11,
+    ],
+  },
+  11: {
+    codes: [
+      3, 4, 10, 24, 34, 33, 21, 15, 5, 3, 4, 10, 32, 17, 11, 10, 11, 7, 13, 18, 30, 31, 20, 5, 25,
+      11, 19, 59, 27, 18, 12, 5, 35, 33, 31, 58, 30, 16, 7, 5, 28, 26, 32, 19, 17, 15, 8, 14, 14,
+      12, 9, 13, 14, 9, 4, 1, 11, 4, 6, 6, 6, 3, 2, 0,
+    ],
+    lengths: [
+      2, 3, 5, 7, 8, 9, 8, 9, 3, 3, 4, 6, 8, 8, 7, 8, 5, 5, 6, 7, 8, 9, 8, 8, 7, 6, 7, 9, 8, 10, 8,
+      9, 8, 8, 8, 9, 9, 10, 9, 10, 8, 8, 9, 10, 10, 11, 10, 11, 8, 7, 7, 8, 9, 10, 10, 10, 8, 7, 8,
+      9, 10, 10, 10, 10,
+    ],
+  },
+  12: {
+    codes: [
+      9, 6, 16, 33, 41, 39, 38, 26, 7, 5, 6, 9, 23, 16, 26, 11, 17, 7, 11, 14, 21, 30, 10, 7, 17,
+      10, 15, 12, 18, 28, 14, 5, 32, 13, 22, 19, 18, 16, 9, 5, 40, 17, 31, 29, 17, 13, 4, 2, 27, 12,
+      11, 15, 10, 7, 4, 1, 27, 12, 8, 12, 6, 3, 1, 0,
+    ],
+    lengths: [
+      4, 3, 5, 7, 8, 9, 9, 9, 3, 3, 4, 5, 7, 7, 8, 8, 5, 4, 5, 6, 7, 8, 7, 8, 6, 5, 6, 6, 7, 8, 8,
+      8, 7, 6, 7, 7, 8, 8, 8, 9, 8, 7, 8, 8, 8, 9, 9, 9, 8, 7, 7, 8, 8, 9, 8, 10, 9, 8, 8, 9, 9, 9,
+      9, 10,
+    ],
+  },
+  13: {
+    codes: [
+      1, 5, 14, 21, 34, 51, 46, 71, 42, 52, 68, 52, 67, 44, 43, 19, 3, 4, 12, 19, 31, 26, 44, 33,
+      31, 24, 32, 24, 31, 35, 22, 14, 15, 13, 23, 36, 59, 49, 77, 65, 29, 40, 30, 40, 27, 33, 42,
+      16, 22, 20, 37, 61, 56, 79, 73, 64, 43, 76, 56, 37, 26, 31, 25, 14, 35, 16, 60, 57, 97, 75,
+      114, 91, 54, 73, 55, 41, 48, 53, 23, 24, 58, 27, 50, 96, 76, 70, 93, 84, 77, 58, 79, 29, 74,
+      49, 41, 17, 47, 45, 78, 74, 115, 94, 90, 79, 69, 83, 71, 50, 59, 38, 36, 15, 72, 34, 56, 95,
+      92, 85, 91, 90, 86, 73, 77, 65, 51, 44, 43, 42, 43, 20, 30, 44, 55, 78, 72, 87, 78, 61, 46,
+      54, 37, 30, 20, 16, 53, 25, 41, 37, 44, 59, 54, 81, 66, 76, 57, 54, 37, 18, 39, 11, 35, 33,
+      31, 57, 42, 82, 72, 80, 47, 58, 55, 21, 22, 26, 38, 22, 53, 25, 23, 38, 70, 60, 51, 36, 55,
+      26, 34, 23, 27, 14, 9, 7, 34, 32, 28, 39, 49, 75, 30, 52, 48, 40, 52, 28, 18, 17, 9, 5, 45,
+      21, 34, 64, 56, 50, 49, 45, 31, 19, 12, 15, 10, 7, 6, 3, 48, 23, 20, 39, 36, 35, 53, 21, 16,
+      23, 13, 10, 6, 1, 4, 2, 16, 15, 17, 27, 25, 20, 29, 11, 17, 12, 16, 8, 1, 1, 0, 1,
+    ],
+    lengths: [
+      1, 4, 6, 7, 8, 9, 9, 10, 9, 10, 11, 11, 12, 12, 13, 13, 3, 4, 6, 7, 8, 8, 9, 9, 9, 9, 10, 10,
+      11, 12, 12, 12, 6, 6, 7, 8, 9, 9, 10, 10, 9, 10, 10, 11, 11, 12, 13, 13, 7, 7, 8, 9, 9, 10,
+      10, 10, 10, 11, 11, 11, 11, 12, 13, 13, 8, 7, 9, 9, 10, 10, 11, 11, 10, 11, 11, 12, 12, 13,
+      13, 14, 9, 8, 9, 10, 10, 10, 11, 11, 11, 11, 12, 11, 13, 13, 14, 14, 9, 9, 10, 10, 11, 11, 11,
+      11, 11, 12, 12, 12, 13, 13, 14, 14, 10, 9, 10, 11, 11, 11, 12, 12, 12, 12, 13, 13, 13, 14, 16,
+      16, 9, 8, 9, 10, 10, 11, 11, 12, 12, 12, 12, 13, 13, 14, 15, 15, 10, 9, 10, 10, 11, 11, 11,
+      13, 12, 13, 13, 14, 14, 14, 16, 15, 10, 10, 10, 11, 11, 12, 12, 13, 12, 13, 14, 13, 14, 15,
+      16, 17, 11, 10, 10, 11, 12, 12, 12, 12, 13, 13, 13, 14, 15, 15, 15, 16, 11, 11, 11, 12, 12,
+      13, 12, 13, 14, 14, 15, 15, 15, 16, 16, 16, 12, 11, 12, 13, 13, 13, 14, 14, 14, 14, 14, 15,
+      16, 15, 16, 16, 13, 12, 12, 13, 13, 13, 15, 14, 14, 17, 15, 15, 15, 17, 16, 16, 12, 12, 13,
+      14, 14, 14, 15, 14, 15, 15, 16, 16, 19, 18, 19, 16,
+    ],
+  },
+  15: {
+    codes: [
+      7, 12, 18, 53, 47, 76, 124, 108, 89, 123, 108, 119, 107, 81, 122, 63, 13, 5, 16, 27, 46, 36,
+      61, 51, 42, 70, 52, 83, 65, 41, 59, 36, 19, 17, 15, 24, 41, 34, 59, 48, 40, 64, 50, 78, 62,
+      80, 56, 33, 29, 28, 25, 43, 39, 63, 55, 93, 76, 59, 93, 72, 54, 75, 50, 29, 52, 22, 42, 40,
+      67, 57, 95, 79, 72, 57, 89, 69, 49, 66, 46, 27, 77, 37, 35, 66, 58, 52, 91, 74, 62, 48, 79,
+      63, 90, 62, 40, 38, 125, 32, 60, 56, 50, 92, 78, 65, 55, 87, 71, 51, 73, 51, 70, 30, 109, 53,
+      49, 94, 88, 75, 66, 122, 91, 73, 56, 42, 64, 44, 21, 25, 90, 43, 41, 77, 73, 63, 56, 92, 77,
+      66, 47, 67, 48, 53, 36, 20, 71, 34, 67, 60, 58, 49, 88, 76, 67, 106, 71, 54, 38, 39, 23, 15,
+      109, 53, 51, 47, 90, 82, 58, 57, 48, 72, 57, 41, 23, 27, 62, 9, 86, 42, 40, 37, 70, 64, 52,
+      43, 70, 55, 42, 25, 29, 18, 11, 11, 118, 68, 30, 55, 50, 46, 74, 65, 49, 39, 24, 16, 22, 13,
+      14, 7, 91, 44, 39, 38, 34, 63, 52, 45, 31, 52, 28, 19, 14, 8, 9, 3, 123, 60, 58, 53, 47, 43,
+      32, 22, 37, 24, 17, 12, 15, 10, 2, 1, 71, 37, 34, 30, 28, 20, 17, 26, 21, 16, 10, 6, 8, 6, 2,
+      0,
+    ],
+    lengths: [
+      3, 4, 5, 7, 7, 8, 9, 9, 9, 10, 10, 11, 11, 11, 12, 13, 4, 3, 5, 6, 7, 7, 8, 8, 8, 9, 9, 10,
+      10, 10, 11, 11, 5, 5, 5, 6, 7, 7, 8, 8, 8, 9, 9, 10, 10, 11, 11, 11, 6, 6, 6, 7, 7, 8, 8, 9,
+      9, 9, 10, 10, 10, 11, 11, 11, 7, 6, 7, 7, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11, 11, 8, 7, 7,
+      8, 8, 8, 9, 9, 9, 9, 10, 10, 11, 11, 11, 12, 9, 7, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11,
+      12, 12, 9, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 12, 9, 8, 8, 9, 9, 9, 9, 10, 10,
+      10, 10, 11, 11, 12, 12, 12, 9, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11, 11, 11, 12, 12, 12, 10, 9,
+      9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 11, 12, 13, 12, 10, 9, 9, 9, 10, 10, 10, 10, 11, 11, 11,
+      11, 12, 12, 12, 13, 11, 10, 9, 10, 10, 10, 11, 11, 11, 11, 11, 11, 12, 12, 13, 13, 11, 10, 10,
+      10, 10, 11, 11, 11, 11, 12, 12, 12, 12, 12, 13, 13, 12, 11, 11, 11, 11, 11, 11, 11, 12, 12,
+      12, 12, 13, 13, 12, 13, 12, 11, 11, 11, 11, 11, 11, 12, 12, 12, 12, 12, 13, 13, 13, 13,
+    ],
+  },
+  16: {
+    codes: [
+      1, 5, 14, 44, 74, 63, 110, 93, 172, 149, 138, 242, 225, 195, 376, 17, 3, 4, 12, 20, 35, 62,
+      53, 47, 83, 75, 68, 119, 201, 107, 207, 9, 15, 13, 23, 38, 67, 58, 103, 90, 161, 72, 127, 117,
+      110, 209, 206, 16, 45, 21, 39, 69, 64, 114, 99, 87, 158, 140, 252, 212, 199, 387, 365, 26, 75,
+      36, 68, 65, 115, 101, 179, 164, 155, 264, 246, 226, 395, 382, 362, 9, 66, 30, 59, 56, 102,
+      185, 173, 265, 142, 253, 232, 400, 388, 378, 445, 16, 111, 54, 52, 100, 184, 178, 160, 133,
+      257, 244, 228, 217, 385, 366, 715, 10, 98, 48, 91, 88, 165, 157, 148, 261, 248, 407, 397, 372,
+      380, 889, 884, 8, 85, 84, 81, 159, 156, 143, 260, 249, 427, 401, 392, 383, 727, 713, 708, 7,
+      154, 76, 73, 141, 131, 256, 245, 426, 406, 394, 384, 735, 359, 710, 352, 11, 139, 129, 67,
+      125, 247, 233, 229, 219, 393, 743, 737, 720, 885, 882, 439, 4, 243, 120, 118, 115, 227, 223,
+      396, 746, 742, 736, 721, 712, 706, 223, 436, 6, 202, 224, 222, 218, 216, 389, 386, 381, 364,
+      888, 443, 707, 440, 437, 1728, 4, 747, 211, 210, 208, 370, 379, 734, 723, 714, 1735, 883, 877,
+      876, 3459, 865, 2, 377, 369, 102, 187, 726, 722, 358, 711, 709, 866, 1734, 871, 3458, 870,
+      434, 0, 12, 10, 7, 11, 10, 17, 11, 9, 13, 12, 10, 7, 5, 3, 1, 3,
+    ],
+    lengths: [
+      1, 4, 6, 8, 9, 9, 10, 10, 11, 11, 11, 12, 12, 12, 13, 9, 3, 4, 6, 7, 8, 9, 9, 9, 10, 10, 10,
+      11, 12, 11, 12, 8, 6, 6, 7, 8, 9, 9, 10, 10, 11, 10, 11, 11, 11, 12, 12, 9, 8, 7, 8, 9, 9, 10,
+      10, 10, 11, 11, 12, 12, 12, 13, 13, 10, 9, 8, 9, 9, 10, 10, 11, 11, 11, 12, 12, 12, 13, 13,
+      13, 9, 9, 8, 9, 9, 10, 11, 11, 12, 11, 12, 12, 13, 13, 13, 14, 10, 10, 9, 9, 10, 11, 11, 11,
+      11, 12, 12, 12, 12, 13, 13, 14, 10, 10, 9, 10, 10, 11, 11, 11, 12, 12, 13, 13, 13, 13, 15, 15,
+      10, 10, 10, 10, 11, 11, 11, 12, 12, 13, 13, 13, 13, 14, 14, 14, 10, 11, 10, 10, 11, 11, 12,
+      12, 13, 13, 13, 13, 14, 13, 14, 13, 11, 11, 11, 10, 11, 12, 12, 12, 12, 13, 14, 14, 14, 15,
+      15, 14, 10, 12, 11, 11, 11, 12, 12, 13, 14, 14, 14, 14, 14, 14, 13, 14, 11, 12, 12, 12, 12,
+      12, 13, 13, 13, 13, 15, 14, 14, 14, 14, 16, 11, 14, 12, 12, 12, 13, 13, 14, 14, 14, 16, 15,
+      15, 15, 17, 15, 11, 13, 13, 11, 12, 14, 14, 13, 14, 14, 15, 16, 15, 17, 15, 14, 11, 9, 8, 8,
+      9, 9, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 8,
+    ],
+  },
+  24: {
+    codes: [
+      15, 13, 46, 80, 146, 262, 248, 434, 426, 669, 653, 649, 621, 517, 1032, 88, 14, 12, 21, 38,
+      71, 130, 122, 216, 209, 198, 327, 345, 319, 297, 279, 42, 47, 22, 41, 74, 68, 128, 120, 221,
+      207, 194, 182, 340, 315, 295, 541, 18, 81, 39, 75, 70, 134, 125, 116, 220, 204, 190, 178, 325,
+      311, 293, 271, 16, 147, 72, 69, 135, 127, 118, 112, 210, 200, 188, 352, 323, 306, 285, 540,
+      14, 263, 66, 129, 126, 119, 114, 214, 202, 192, 180, 341, 317, 301, 281, 262, 12, 249, 123,
+      121, 117, 113, 215, 206, 195, 185, 347, 330, 308, 291, 272, 520, 10, 435, 115, 111, 109, 211,
+      203, 196, 187, 353, 332, 313, 298, 283, 531, 381, 17, 427, 212, 208, 205, 201, 193, 186, 177,
+      169, 320, 303, 286, 268, 514, 377, 16, 335, 199, 197, 191, 189, 181, 174, 333, 321, 305, 289,
+      275, 521, 379, 371, 11, 668, 184, 183, 179, 175, 344, 331, 314, 304, 290, 277, 530, 383, 373,
+      366, 10, 652, 346, 171, 168, 164, 318, 309, 299, 287, 276, 263, 513, 375, 368, 362, 6, 648,
+      322, 316, 312, 307, 302, 292, 284, 269, 261, 512, 376, 370, 364, 359, 4, 620, 300, 296, 294,
+      288, 282, 273, 266, 515, 380, 374, 369, 365, 361, 357, 2, 1033, 280, 278, 274, 267, 264, 259,
+      382, 378, 372, 367, 363, 360, 358, 356, 0, 43, 20, 19, 17, 15, 13, 11, 9, 7, 6, 4, 7, 5, 3, 1,
+      3,
+    ],
+    lengths: [
+      4, 4, 6, 7, 8, 9, 9, 10, 10, 11, 11, 11, 11, 11, 12, 9, 4, 4, 5, 6, 7, 8, 8, 9, 9, 9, 10, 10,
+      10, 10, 10, 8, 6, 5, 6, 7, 7, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 7, 7, 6, 7, 7, 8, 8, 8, 9, 9,
+      9, 9, 10, 10, 10, 10, 7, 8, 7, 7, 8, 8, 8, 8, 9, 9, 9, 10, 10, 10, 10, 11, 7, 9, 7, 8, 8, 8,
+      8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 7, 9, 8, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 7,
+      10, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 8, 10, 9, 9, 9, 9, 9, 9, 9, 9, 10, 10,
+      10, 10, 11, 11, 8, 10, 9, 9, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 8, 11, 9, 9, 9, 9,
+      10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 8, 11, 10, 9, 9, 9, 10, 10, 10, 10, 10, 10, 11, 11,
+      11, 11, 8, 11, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 8, 11, 10, 10, 10, 10,
+      10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 8, 12, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11,
+      11, 11, 8, 8, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 4,
+    ],
+  },
+};
+
+// Count1 table A: code and length of each quadruple vwxy (table B is the
+// four bits inverted)
+const QUAD_CODES = {
+  codes: [1, 5, 4, 5, 6, 5, 4, 4, 7, 3, 6, 0, 7, 2, 3, 1],
+  lengths: [1, 4, 4, 5, 4, 6, 5, 6, 4, 5, 5, 6, 5, 6, 6, 6],
+};
+
+// Linbits of tables 16-23 (all table 16) and 24-31 (all table 24)
+const LINBITS = [1, 2, 3, 4, 6, 8, 10, 13, 4, 5, 6, 7, 8, 9, 11, 13];
+
+// Synthesis window D[0..256] of Table 3-B.3, in units of 2^-16; the rest
+// mirrors it: D[512 - i] = -D[i], except D[512 - 64k] = D[64k]
+const SYNTH_WINDOW = [
+  0, -1, -1, -1, -1, -1, -1, -2, -2, -2, -2, -3, -3, -4, -4, -5, -5, -6, -7, -7, -8, -9, -10, -11,
+  -13, -14, -16, -17, -19, -21, -24, -26, -29, -31, -35, -38, -41, -45, -49, -53, -58, -63, -68,
+  -73, -79, -85, -91, -97, -104, -111, -117, -125, -132, -139, -147, -154, -161, -169, -176, -183,
+  -190, -196, -202, -208, 213, 218, 222, 225, 227, 228, 228, 227, 224, 221, 215, 208, 200, 189, 177,
+  163, 146, 127, 106, 83, 57, 29, -2, -36, -72, -111, -153, -197, -244, -294, -347, -401, -459,
+  -519, -581, -645, -711, -779, -848, -919, -991, -1064, -1137, -1210, -1283, -1356, -1428, -1498,
+  -1567, -1634, -1698, -1759, -1817, -1870, -1919, -1962, -2001, -2032, -2057, -2075, -2085, -2087,
+  -2080, -2063, 2037, 2000, 1952, 1893, 1822, 1739, 1644, 1535, 1414, 1280, 1131, 970, 794, 605,
+  402, 185, -45, -288, -545, -814, -1095, -1388, -1692, -2006, -2330, -2663, -3004, -3351, -3705,
+  -4063, -4425, -4788, -5153, -5517, -5879, -6237, -6589, -6935, -7271, -7597, -7910, -8209, -8491,
+  -8755, -8998, -9219, -9416, -9585, -9727, -9838, -9916, -9959, -9966, -9935, -9863, -9750, -9592,
+  -9389, -9139, -8840, -8492, -8092, -7640, -7134, 6574, 5959, 5288, 4561, 3776, 2935, 2037, 1082,
+  70, -998, -2122, -3300, -4533, -5818, -7154, -8540, -9975, -11455, -12980, -14548, -16155, -17799,
+  -19478, -21189, -22929, -24694, -26482, -28289, -30112, -31947, -33791, -35640, -37489, -39336,
+  -41176, -43006, -44821, -46617, -48390, -50137, -51853, -53534, -55178, -56778, -58333, -59838,
+  -61289, -62684, -64019, -65290, -66494, -67629, -68692, -69679, -70590, -71420, -72169, -72835,
+  -73415, -73908, -74313, -74630, -74856, -74992, 75038,
+];
+
+// Alias reduction coefficients c[i] of Table 3-B.9
+const ALIAS_COEFFS = [-0.6, -0.535, -0.33, -0.185, -0.095, -0.041, -0.0142, -0.0037];
+
+interface HuffmanTable {
+  tree: Int16Array; // Two children per node; a leaf is -(value + 1)
+  size: number; // Values per row: the value of (x, y) is x * size + y
+  linbits: number;
+}
+
+// Decoding tree for a prefix code: node n has children tree[2n] and tree[2n + 1]
+function buildTree(codes: number[], lengths: number[]): Int16Array {
+  const tree = new Int16Array(codes.length * 2);
+  let nodes = 1;
+  codes.forEach((code, value) => {
+    let node = 0;
+    for (let bit = lengths[value]! - 1; bit > 0; bit--) {
+      const slot = node * 2 + ((code >> bit) & 1);
+      if (tree[slot] === 0) tree[slot] = nodes++;
+      node = tree[slot]!;
+    }
+    tree[node * 2 + (code & 1)] = -(value + 1);
+  });
+  return tree;
+}
+
+// Tables by table_select, built on first use (null: all zero, or unused)
+let pairTables: (HuffmanTable | null)[] | null = null;
+let quadTree: Int16Array | null = null;
+
+function huffmanTables(): (HuffmanTable | null)[] {
+  if (pairTables) return pairTables;
+  const build = (id: number, linbits: number): HuffmanTable => {
+    const { codes, lengths } = PAIR_CODES[id]!;
+    return { tree: buildTree(codes, lengths), size: Math.sqrt(codes.length), linbits };
+  };
+  pairTables = [];
+  for (let id = 0; id < 16; id++) pairTables.push(PAIR_CODES[id] ? build(id, 0) : null);
+  const table16 = build(16, 0);
+  const table24 = build(24, 0);
+  LINBITS.forEach((linbits, i) => {
+    pairTables!.push({ ...(i < 8 ? table16 : table24), linbits });
+  });
+  quadTree = buildTree(QUAD_CODES.codes, QUAD_CODES.lengths);
+  return pairTables;
+}
+
+// |x|^(4/3) for every value a Huffman pair can carry (15 + 13 linbits)
+let pow43: Float64Array | null = null;
+
+// cos() terms of the 36 and 12 point IMDCTs and of the synthesis matrixing,
+// the IMDCT windows by block type (2: short), and D[0..511] as fractions
+interface Transforms {
+  imdctLong: Float64Array;
+  imdctShort: Float64Array;
+  windows: Float64Array[];
+  synth: Float64Array;
+  window: Float64Array;
+  aliasCs: Float64Array;
+  aliasCa: Float64Array;
+  intensity: Float64Array;
+}
+
+let transforms: Transforms | null = null;
+
+function getTransforms(): Transforms {
+  if (transforms) return transforms;
+
+  pow43 = new Float64Array(8207);
+  for (let i = 0; i < pow43.length; i++) pow43[i] = Math.pow(i, 4 / 3);
+
+  const imdctLong = new Float64Array(36 * 18);
+  for (let i = 0; i < 36; i++) {
+    for (let k = 0; k < 18; k++) {
+      imdctLong[i * 18 + k] = Math.cos((Math.PI / 72) * (2 * i + 1 + 18) * (2 * k + 1));
+    }
+  }
+  const imdctShort = new Float64Array(12 * 6);
+  for (let i = 0; i < 12; i++) {
+    for (let k = 0; k < 6; k++) {
+      imdctShort[i * 6 + k] = Math.cos((Math.PI / 24) * (2 * i + 1 + 6) * (2 * k + 1));
+    }
+  }
+
+  const windows = [0, 1, 2, 3].map(() => new Float64Array(36));
+  for (let i = 0; i < 36; i++) {
+    const long = Math.sin((Math.PI / 36) * (i + 0.5));
+    windows[0]![i] = long;
+    windows[1]![i] =
+      i < 18 ? long : i < 24 ? 1 : i < 30 ? Math.sin((Math.PI / 12) * (i - 18 + 0.5)) : 0;
+    windows[3]![i] =
+      i < 6 ? 0 : i < 12 ? Math.sin((Math.PI / 12) * (i - 6 + 0.5)) : i < 18 ? 1 : long;
+  }
+  for (let i = 0; i < 12; i++) windows[2]![i] = Math.sin((Math.PI / 12) * (i + 0.5));
+
+  const synth = new Float64Array(64 * 32);
+  for (let i = 0; i < 64; i++) {
+    for (let k = 0; k < 32; k++) {
+      synth[i * 32 + k] = Math.cos(((16 + i) * (2 * k + 1) * Math.PI) / 64);
+    }
+  }
+  const window = new Float64Array(512);
+  for (let i = 0; i <= 256; i++) window[i] = SYNTH_WINDOW[i]! / 65536;
+  for (let i = 257; i < 512; i++) window[i] = (i % 64 === 0 ? 1 : -1) * window[512 - i]!;
+
+  const aliasCs = new Float64Array(8);
+  const aliasCa = new Float64Array(8);
+  ALIAS_COEFFS.forEach((c, i) => {
+    aliasCs[i] = 1 / Math.sqrt(1 + c * c);
+    aliasCa[i] = c / Math.sqrt(1 + c * c);
+  });
+
+  // Left share k / (1 + k) of intensity position p, k = tan(p * PI / 12)
+  const intensity = new Float64Array(7);
+  for (let p = 0; p < 7; p++) {
+    const k = Math.tan((p * Math.PI) / 12);
+    intensity[p] = p === 6 ? 1 : k / (1 + k);
+  }
+
+  transforms = { imdctLong, imdctShort, windows, synth, window, aliasCs, aliasCa, intensity };
+  return transforms;
+}
+
+interface FrameHeader {
+  size: number; // Bytes, header included
+  sampleRateIndex: number;
+  channels: number;
+  mode: number; // 0 stereo, 1 joint stereo, 2 dual channel, 3 mono
+  modeExtension: number;
+  crc: boolean;
+}
+
+// The MPEG-1 Layer III frame header at `at`, or null
+function parseHeader(data: Uint8Array, at: number): FrameHeader | null {
+  if (at + 4 > data.length || data[at] !== 0xff) return null;
+  const b1 = data[at + 1]!;
+  const b2 = data[at + 2]!;
+  const b3 = data[at + 3]!;
+  // Sync, version 1 (MPEG-1), layer 01 (III)
+  if ((b1 & 0xfe) !== 0xfa) return null;
+  const bitrate = BITRATES[b2 >> 4];
+  const sampleRateIndex = (b2 >> 2) & 3;
+  if (!bitrate || sampleRateIndex === 3) return null;
+  const mode = b3 >> 6;
+  return {
+    size: Math.floor((144000 * bitrate) / SAMPLE_RATES[sampleRateIndex]!) + ((b2 >> 1) & 1),
+    sampleRateIndex,
+    channels: mode === 3 ? 1 : 2,
+    mode,
+    modeExtension: (b3 >> 4) & 3,
+    crc: (b1 & 1) === 0,
+  };
+}
+
+// Past an ID3v2 tag at the start, if there is one
+function skipId3(data: Uint8Array): number {
+  if (data.length < 10 || data[0] !== 0x49 || data[1] !== 0x44 || data[2] !== 0x33) return 0;
+  const size = (data[6]! << 21) | (data[7]! << 14) | (data[8]! << 7) | data[9]!;
+  return 10 + size + (data[5]! & 0x10 ? 10 : 0);
+}
+
+// The next frame at or after `at` whose successor (if any) is a frame too
+function findFrame(data: Uint8Array, at: number, sampleRateIndex: number = -1): number {
+  for (; at + 4 <= data.length; at++) {
+    const header = parseHeader(data, at);
+    if (!header || (sampleRateIndex >= 0 && header.sampleRateIndex !== sampleRateIndex)) continue;
+    const next = at + header.size;
+    if (next + 4 > data.length || parseHeader(data, next)) return at;
+  }
+  return -1;
+}
+
+// Side information of one channel in one granule
+interface Granule {
+  part23Length: number;
+  bigValues: number;
+  globalGain: number;
+  scalefacCompress: number;
+  windowSwitching: boolean;
+  blockType: number;
+  mixed: boolean;
+  tableSelect: number[];
+  subblockGain: number[];
+  region0Count: number;
+  region1Count: number;
+  preflag: boolean;
+  scalefacScale: boolean;
+  count1Table: number;
+}
+
+function createGranule(): Granule {
+  return {
+    part23Length: 0,
+    bigValues: 0,
+    globalGain: 0,
+    scalefacCompress: 0,
+    windowSwitching: false,
+    blockType: 0,
+    mixed: false,
+    tableSelect: [0, 0, 0],
+    subblockGain: [0, 0, 0],
+    region0Count: 0,
+    region1Count: 0,
+    preflag: false,
+    scalefacScale: false,
+    count1Table: 0,
+  };
+}
+
+/**
+ * Open an MP3 file held in memory; null if it has no MPEG-1 Layer III frames
+ */
+export function createMp3Decoder(data: Uint8Array): Mp3Decoder | null {
+  const start = findFrame(data, skipId3(data));
+  if (start < 0) return null;
+  const first = parseHeader(data, start)!;
+  const rateIndex = first.sampleRateIndex;
+  const longBands = LONG_BANDS[rateIndex]!;
+  const shortBands = SHORT_BANDS[rateIndex]!;
+  const tables = huffmanTables();
+  const quads = quadTree!;
+  const t = getTransforms();
+  const powers = pow43!;
+
+  // A Xing/Info frame first carries no audio; the LAME tag inside it (also
+  // written by ffmpeg) says how many samples the encoder added before and
+  // after the track
+  let audioStart = start;
+  let delay = 0;
+  let padding = 0;
+  const tagAt = start + 4 + (first.crc ? 2 : 0) + (first.channels === 1 ? 17 : 32);
+  const tag = String.fromCharCode(...data.subarray(tagAt, tagAt + 4));
+  if (tag === "Xing" || tag === "Info") {
+    audioStart = start + first.size;
+    const flags = data[tagAt + 7]!;
+    let lameAt = tagAt + 8;
+    if (flags & 1) lameAt += 4; // Frame count
+    if (flags & 2) lameAt += 4; // Byte count
+    if (flags & 4) lameAt += 100; // Seek table
+    if (flags & 8) lameAt += 4; // Quality
+    const encoder = String.fromCharCode(...data.subarray(lameAt, lameAt + 4));
+    if (encoder === "LAME" || encoder === "Lavc" || encoder === "Lavf") {
+      const at = lameAt + 21;
+      delay = (data[at]! << 4) | (data[at + 1]! >> 4);
+      padding = ((data[at + 1]! & 15) << 8) | data[at + 2]!;
+    }
+  }
+  // The decoder lags DECODER_DELAY behind: that much more is skipped at the
+  // start, and at the end the padding is trimmed past that lag, or the lag
+  // is drained with a silent frame if the padding is shorter
+  const startSkip = delay + DECODER_DELAY;
+  const endTrim = padding - DECODER_DELAY;
+
+  // Bit reader, over the frame for side information, then the reservoir
+  let bits = data;
+  let bitPos = 0;
+  const readBit = (): number => {
+    const bit = (bits[bitPos >> 3]! >> (7 - (bitPos & 7))) & 1;
+    bitPos++;
+    return bit;
+  };
+  const readBits = (count: number): number => {
+    let value = 0;
+    for (let i = 0; i < count; i++) value = (value << 1) | readBit();
+    return value;
+  };
+  const decodeTree = (tree: Int16Array): number => {
+    let node = 0;
+    for (;;) {
+      const next = tree[node * 2 + readBit()]!;
+      if (next < 0) return -next - 1;
+      node = next;
+    }
+  };
+
+  // Main data carried over from earlier frames (the bit reservoir)
+  const reservoir = new Uint8Array(RESERVOIR_SIZE);
+  let reservoirLength = 0;
+
+  const scfsi = [new Uint8Array(4), new Uint8Array(4)];
+  const granules = [
+    [createGranule(), createGranule()],
+    [createGranule(), createGranule()],
+  ];
+  // Scalefactors by channel: long bands, and short bands * 3 + window
+  const longScf = [new Int32Array(22), new Int32Array(22)];
+  const shortScf = [new Int32Array(39), new Int32Array(39)];
+  // Quantized values, then requantized lines, by channel
+  const values = [new Int32Array(GRANULE_SAMPLES), new Int32Array(GRANULE_SAMPLES)];
+  const lines = [new Float64Array(GRANULE_SAMPLES), new Float64Array(GRANULE_SAMPLES)];
+  const nonzero = [0, 0]; // Lines past the last non-zero one
+  const reordered = new Float64Array(GRANULE_SAMPLES);
+  const intensityDone = new Uint8Array(GRANULE_SAMPLES);
+  const imdctOut = new Float64Array(36);
+  const subbands = new Float64Array(GRANULE_SAMPLES); // [subband * 18 + time]
+  const overlap = [new Float64Array(GRANULE_SAMPLES), new Float64Array(GRANULE_SAMPLES)];
+  const synthBuffers = [new Float64Array(1024), new Float64Array(1024)];
+  const synthOffsets = [0, 0];
+  const slot = new Float64Array(32);
+
+  // Decoded frame, interleaved stereo, and what is left of it to read
+  const pcm = new Float32Array(FRAME_SAMPLES * 2);
+  let pcmAt = 0;
+  let pcmEnd = 0;
+  let position = audioStart;
+  let skip = startSkip;
+  let drained = false;
+
+  const readSideInfo = (header: FrameHeader): number => {
+    const channels = header.channels;
+    const mainDataBegin = readBits(9);
+    readBits(channels === 1 ? 5 : 3); // Private bits
+    for (let ch = 0; ch < channels; ch++) {
+      for (let band = 0; band < 4; band++) scfsi[ch]![band] = readBit();
+    }
+    for (let gr = 0; gr < 2; gr++) {
+      for (let ch = 0; ch < channels; ch++) {
+        const g = granules[gr]![ch]!;
+        g.part23Length = readBits(12);
+        g.bigValues = Math.min(readBits(9), GRANULE_SAMPLES / 2);
+        g.globalGain = readBits(8);
+        g.scalefacCompress = readBits(4);
+        g.windowSwitching = readBit() === 1;
+        if (g.windowSwitching) {
+          g.blockType = readBits(2);
+          g.mixed = readBit() === 1;
+          g.tableSelect[0] = readBits(5);
+          g.tableSelect[1] = readBits(5);
+          g.tableSelect[2] = 0;
+          for (let w = 0; w < 3; w++) g.subblockGain[w] = readBits(3);
+          g.region0Count = g.blockType === 2 && !g.mixed ? 8 : 7;
+          g.region1Count = 20 - g.region0Count;
+        } else {
+          g.blockType = 0;
+          g.mixed = false;
+          for (let r = 0; r < 3; r++) g.tableSelect[r] = readBits(5);
+          g.subblockGain.fill(0);
+          g.region0Count = readBits(4);
+          g.region1Count = readBits(3);
+        }
+        g.preflag = readBit() === 1;
+        g.scalefacScale = readBit() === 1;
+        g.count1Table = readBit();
+      }
+    }
+    return mainDataBegin;
+  };
+
+  const readScalefactors = (g: Granule, ch: number, gr: number): void => {
+    const slen1 = SLEN1[g.scalefacCompress]!;
+    const slen2 = SLEN2[g.scalefacCompress]!;
+    const long = longScf[ch]!;
+    const short = shortScf[ch]!;
+    if (g.blockType === 2) {
+      let sfb = 0;
+      if (g.mixed) {
+        for (; sfb < 8; sfb++) long[sfb] = readBits(slen1);
+        sfb = 3;
+      }
+      for (; sfb < 12; sfb++) {
+        for (let w = 0; w < 3; w++) short[sfb * 3 + w] = readBits(sfb < 6 ? slen1 : slen2);
+      }
+      short.fill(0, 36);
+      return;
+    }
+    // Bands 0-5, 6-10, 11-15 and 16-20; granule 1 may reuse granule 0's
+    const groups = [0, 6, 11, 16, 21];
+    for (let band = 0; band < 4; band++) {
+      if (gr === 1 && scfsi[ch]![band]) continue;
+      for (let sfb = groups[band]!; sfb < groups[band + 1]!; sfb++) {
+        long[sfb] = readBits(band < 2 ? slen1 : slen2);
+      }
+    }
+    long[21] = 0;
+  };
+
+  const readHuffman = (g: Granule, ch: number, end: number): void => {
+    const out = values[ch]!;
+    out.fill(0);
+    const bigEnd = g.bigValues * 2;
+    const region1 = g.windowSwitching ? 36 : longBands[g.region0Count + 1]!;
+    const region2 = g.windowSwitching
+      ? GRANULE_SAMPLES
+      : longBands[Math.min(g.region0Count + g.region1Count + 2, 22)]!;
+
+    let i = 0;
+    for (; i < bigEnd; i += 2) {
+      const table = tables[g.tableSelect[i < region1 ? 0 : i < region2 ? 1 : 2]!];
+      if (!table) continue;
+      const value = decodeTree(table.tree);
+      let x = Math.floor(value / table.size);
+      let y = value % table.size;
+      if (x === 15 && table.linbits) x += readBits(table.linbits);
+      if (x && readBit()) x = -x;
+      if (y === 15 && table.linbits) y += readBits(table.linbits);
+      if (y && readBit()) y = -y;
+      out[i] = x;
+      out[i + 1] = y;
+    }
+
+    // Quadruples of -1, 0 and 1 until the granule's bits run out
+    while (i + 4 <= GRANULE_SAMPLES && bitPos < end) {
+      const value = g.count1Table ? 15 - readBits(4) : decodeTree(quads);
+      for (let q = 0; q < 4; q++) {
+        const v = (value >> (3 - q)) & 1;
+        out[i + q] = v && readBit() ? -1 : v;
+      }
+      // A quadruple read past the end belongs to stuffing, not to the data
+      if (bitPos > end) {
+        out.fill(0, i, i + 4);
+        break;
+      }
+      i += 4;
+    }
+    nonzero[ch] = i;
+    bitPos = end;
+  };
+
+  const requantize = (g: Granule, ch: number): void => {
+    const quantized = values[ch]!;
+    const out = lines[ch]!;
+    const end = nonzero[ch]!;
+    const long = longScf[ch]!;
+    const short = shortScf[ch]!;
+    const gain = Math.pow(2, 0.25 * (g.globalGain - 210));
+    const shift = g.scalefacScale ? 1 : 0.5;
+    out.fill(0);
+
+    const scale = (i: number, factor: number): void => {
+      const q = quantized[i]!;
+      out[i] = q < 0 ? -powers[-q]! * factor : powers[q]! * factor;
+    };
+
+    let i = 0;
+    if (g.blockType !== 2 || g.mixed) {
+      const bands = g.blockType === 2 ? 8 : 22;
+      for (let sfb = 0; sfb < bands && i < end; sfb++) {
+        const sf = long[sfb]! + (g.preflag ? PRETAB[sfb]! : 0);
+        const factor = gain * Math.pow(2, -shift * sf);
+        for (; i < longBands[sfb + 1]! && i < end; i++) scale(i, factor);
+      }
+    }
+    if (g.blockType === 2) {
+      for (let sfb = g.mixed ? 3 : 0; sfb < 13 && i < end; sfb++) {
+        const width = shortBands[sfb + 1]! - shortBands[sfb]!;
+        for (let w = 0; w < 3; w++) {
+          const sf = 8 * g.subblockGain[w]! + 4 * shift * short[sfb * 3 + w]!;
+          const factor = gain * Math.pow(2, -0.25 * sf);
+          for (let k = 0; k < width && i < end; k++, i++) scale(i, factor);
+        }
+      }
+    }
+  };
+
+  // Joint stereo: intensity stereo above the right channel's last non-zero
+  // band, mid/side below it
+  const jointStereo = (header: FrameHeader, g: Granule): void => {
+    const left = lines[0]!;
+    const right = lines[1]!;
+    intensityDone.fill(0);
+
+    const intensityBand = (from: number, to: number, position: number): void => {
+      if (position >= 7) return;
+      const share = t.intensity[position]!;
+      for (let i = from; i < to; i++) {
+        const v = left[i]!;
+        left[i] = v * share;
+        right[i] = v * (1 - share);
+        intensityDone[i] = 1;
+      }
+    };
+
+    if (header.modeExtension & 1) {
+      if (g.blockType === 2) {
+        const firstBand = g.mixed ? 3 : 0;
+        const base = g.mixed ? 36 : 0;
+        for (let w = 0; w < 3; w++) {
+          // Last band of this window with anything in the right channel
+          let last = firstBand - 1;
+          let at = base;
+          for (let sfb = firstBand; sfb < 13; sfb++) {
+            const width = shortBands[sfb + 1]! - shortBands[sfb]!;
+            const from = at + w * width;
+            for (let k = 0; k < width; k++) if (right[from + k] !== 0) last = sfb;
+            at += width * 3;
+          }
+          at = base;
+          for (let sfb = firstBand; sfb < 13; sfb++) {
+            const width = shortBands[sfb + 1]! - shortBands[sfb]!;
+            if (sfb > last) {
+              const position = shortScf[1]![Math.min(sfb, 11) * 3 + w]!;
+              intensityBand(at + w * width, at + (w + 1) * width, position);
+            }
+            at += width * 3;
+          }
+        }
+      } else {
+        let last = nonzero[1]! - 1;
+        while (last >= 0 && right[last] === 0) last--;
+        let sfb = 0;
+        while (longBands[sfb + 1]! <= last) sfb++;
+        for (sfb = last < 0 ? 0 : sfb + 1; sfb < 22; sfb++) {
+          const position = longScf[1]![Math.min(sfb, 20)]!;
+          intensityBand(longBands[sfb]!, longBands[sfb + 1]!, position);
+        }
+      }
+    }
+
+    const end = Math.max(nonzero[0]!, nonzero[1]!);
+    if (header.modeExtension & 2) {
+      for (let i = 0; i < end; i++) {
+        if (intensityDone[i]) continue;
+        const mid = left[i]!;
+        const side = right[i]!;
+        left[i] = (mid + side) * Math.SQRT1_2;
+        right[i] = (mid - side) * Math.SQRT1_2;
+      }
+    }
+    nonzero[0] = nonzero[1] = header.modeExtension & 1 ? GRANULE_SAMPLES : end;
+  };
+
+  // Short block lines come band by band, window by window; the IMDCT wants
+  // them subband by subband: [subband * 18 + window * 6 + line]
+  const reorder = (g: Granule, ch: number): void => {
+    const src = lines[ch]!;
+    const base = g.mixed ? 36 : 0;
+    reordered.fill(0, base);
+    let i = base;
+    for (let sfb = g.mixed ? 3 : 0; sfb < 13; sfb++) {
+      const from = shortBands[sfb]!;
+      const width = shortBands[sfb + 1]! - from;
+      for (let w = 0; w < 3; w++) {
+        for (let k = 0; k < width; k++, i++) {
+          const line = from + k;
+          reordered[Math.floor(line / 6) * 18 + w * 6 + (line % 6)] = src[i]!;
+        }
+      }
+    }
+    src.set(reordered.subarray(base), base);
+  };
+
+  const reduceAliases = (g: Granule, ch: number): void => {
+    const x = lines[ch]!;
+    const bounds =
+      g.blockType === 2 ? (g.mixed ? 1 : 0) : Math.min(31, Math.ceil(nonzero[ch]! / 18));
+    for (let sb = 0; sb < bounds; sb++) {
+      for (let i = 0; i < 8; i++) {
+        const lo = sb * 18 + 17 - i;
+        const hi = (sb + 1) * 18 + i;
+        const a = x[lo]!;
+        const b = x[hi]!;
+        x[lo] = a * t.aliasCs[i]! - b * t.aliasCa[i]!;
+        x[hi] = b * t.aliasCs[i]! + a * t.aliasCa[i]!;
+      }
+    }
+  };
+
+  // IMDCT of one subband's 18 lines into imdctOut, windowed for its block
+  const transformSubband = (g: Granule, x: Float64Array, at: number, sb: number): void => {
+    const type = g.blockType === 2 && g.mixed && sb < 2 ? 0 : g.blockType;
+    if (type === 2) {
+      imdctOut.fill(0);
+      const win = t.windows[2]!;
+      for (let w = 0; w < 3; w++) {
+        for (let i = 0; i < 12; i++) {
+          let sum = 0;
+          for (let k = 0; k < 6; k++) sum += x[at + w * 6 + k]! * t.imdctShort[i * 6 + k]!;
+          imdctOut[6 + w * 6 + i]! += sum * win[i]!;
+        }
+      }
+    } else {
+      const win = t.windows[type]!;
+      for (let i = 0; i < 36; i++) {
+        let sum = 0;
+        for (let k = 0; k < 18; k++) sum += x[at + k]! * t.imdctLong[i * 18 + k]!;
+        imdctOut[i] = sum * win[i]!;
+      }
+    }
+  };
+
+  // IMDCT, windowing and overlap-add of each subband, into `subbands`
+  const hybrid = (g: Granule, ch: number): void => {
+    const x = lines[ch]!;
+    const prev = overlap[ch]!;
+    const active = g.blockType === 2 ? 32 : Math.min(32, Math.ceil(nonzero[ch]! / 18) + 1);
+
+    for (let sb = 0; sb < 32; sb++) {
+      const at = sb * 18;
+      if (sb >= active) {
+        for (let i = 0; i < 18; i++) {
+          subbands[at + i] = prev[at + i]!;
+          prev[at + i] = 0;
+        }
+      } else {
+        transformSubband(g, x, at, sb);
+        for (let i = 0; i < 18; i++) {
+          subbands[at + i] = imdctOut[i]! + prev[at + i]!;
+          prev[at + i] = imdctOut[18 + i]!;
+        }
+      }
+      // Frequency inversion of odd subbands
+      if (sb & 1) for (let i = 1; i < 18; i += 2) subbands[at + i] = -subbands[at + i]!;
+    }
+  };
+
+  // Polyphase synthesis of the granule's 18 time slots into `pcm`
+  const synthesize = (ch: number, gr: number, channels: number): void => {
+    const v = synthBuffers[ch]!;
+    let offset = synthOffsets[ch]!;
+    for (let time = 0; time < 18; time++) {
+      for (let k = 0; k < 32; k++) slot[k] = subbands[k * 18 + time]!;
+      offset = (offset - 64) & 1023;
+      for (let i = 0; i < 64; i++) {
+        let sum = 0;
+        for (let k = 0; k < 32; k++) sum += t.synth[i * 32 + k]! * slot[k]!;
+        v[offset + i] = sum;
+      }
+      for (let j = 0; j < 32; j++) {
+        let sum = 0;
+        for (let i = 0; i < 8; i++) {
+          sum += v[(offset + 128 * i + j) & 1023]! * t.window[64 * i + j]!;
+          sum += v[(offset + 128 * i + 96 + j) & 1023]! * t.window[64 * i + 32 + j]!;
+        }
+        const at = (gr * GRANULE_SAMPLES + time * 32 + j) * 2;
+        pcm[at + ch] = sum;
+        if (channels === 1) pcm[at + 1] = sum;
+      }
+    }
+    synthOffsets[ch] = offset;
+  };
+
+  // Run a silent granule through the filterbank, for what it still holds
+  const drain = (): void => {
+    for (let gr = 0; gr < 2; gr++) {
+      for (let ch = 0; ch < first.channels; ch++) {
+        lines[ch]!.fill(0);
+        nonzero[ch] = 0;
+        hybrid(granules[gr]![ch]!, ch);
+        synthesize(ch, gr, first.channels);
+      }
+    }
+  };
+
+  // Decode the frame at `position` into `pcm`; false at the end of the data
+  const decodeFrame = (): boolean => {
+    // Frames follow each other; after anything else, look for the next one
+    const at = parseHeader(data, position) ? position : findFrame(data, position, rateIndex);
+    if (at < 0) return false;
+    const header = parseHeader(data, at)!;
+    const channels = header.channels;
+    position = at + header.size;
+
+    bits = data;
+    bitPos = (at + 4 + (header.crc ? 2 : 0)) * 8;
+    const mainDataBegin = readSideInfo(header);
+    const mainStart = bitPos >> 3;
+    const mainEnd = Math.min(at + header.size, data.length);
+
+    // Keep the last 511 bytes for main_data_begin, then add this frame's
+    if (reservoirLength + (mainEnd - mainStart) > RESERVOIR_SIZE) {
+      reservoir.copyWithin(0, reservoirLength - 511, reservoirLength);
+      reservoirLength = 511;
+    }
+    const frameData = reservoirLength - mainDataBegin;
+    reservoir.set(data.subarray(mainStart, mainEnd), reservoirLength);
+    reservoirLength += mainEnd - mainStart;
+
+    pcmAt = 0;
+    pcmEnd = FRAME_SAMPLES;
+    if (frameData < 0) {
+      // Refers to data from before the start: nothing to decode yet
+      pcm.fill(0);
+      return true;
+    }
+
+    bits = reservoir;
+    let partStart = frameData * 8;
+    for (let gr = 0; gr < 2; gr++) {
+      for (let ch = 0; ch < channels; ch++) {
+        const g = granules[gr]![ch]!;
+        const end = partStart + g.part23Length;
+        bitPos = partStart;
+        readScalefactors(g, ch, gr);
+        readHuffman(g, ch, end);
+        requantize(g, ch);
+        partStart = end;
+      }
+      if (header.mode === 1 && channels === 2) jointStereo(header, granules[gr]![1]!);
+      for (let ch = 0; ch < channels; ch++) {
+        const g = granules[gr]![ch]!;
+        if (g.blockType === 2) reorder(g, ch);
+        reduceAliases(g, ch);
+        hybrid(g, ch);
+        synthesize(ch, gr, channels);
+      }
+    }
+    return true;
+  };
+
+  return {
+    sampleRate: SAMPLE_RATES[rateIndex]!,
+
+    read(out: Float32Array, frames: number): number {
+      let written = 0;
+      while (written < frames) {
+        if (pcmAt === pcmEnd) {
+          if (!decodeFrame()) {
+            if (drained || endTrim >= 0) break;
+            drained = true;
+            drain();
+            pcmAt = 0;
+            pcmEnd = -endTrim;
+          } else if (endTrim > 0 && !parseHeader(data, position)) {
+            // The last frame ends with the encoder's padding
+            pcmEnd -= Math.min(endTrim, pcmEnd);
+          }
+          const skipped = Math.min(skip, pcmEnd);
+          pcmAt = skipped;
+          skip -= skipped;
+          continue;
+        }
+        const count = Math.min(frames - written, pcmEnd - pcmAt);
+        out.set(pcm.subarray(pcmAt * 2, (pcmAt + count) * 2), written * 2);
+        pcmAt += count;
+        written += count;
+      }
+      return written;
+    },
+
+    rewind(): void {
+      position = audioStart;
+      reservoirLength = 0;
+      pcmAt = pcmEnd = 0;
+      skip = startSkip;
+      drained = false;
+      overlap.forEach((o) => o.fill(0));
+      synthBuffers.forEach((v) => v.fill(0));
+      synthOffsets[0] = synthOffsets[1] = 0;
+    },
+  };
+}
@@ -0,0 +1,116 @@
+/**
+ * DOOM Network Socket Bridge (worker)
+ *
+ * Carries loopback network links (doom-net.ts) between processes over a
+ * Unix socket. It runs in a worker because an engine waiting for other
+ * players blocks its own thread, so that thread cannot service sockets.
+ *
+ * listen:  on the host; every connection claims a link on the host's board
+ * connect: on a joining player; relays link 0 of its one-link board
+ *
+ * Frames on the socket: u32 length, f64 send time, payload (little endian),
+ * so delivery latency is still measured from the original send.
+ */
+
+import { connect, createServer, type Socket } from "net";
+import {
+  claimNetLink,
+  openNetLinkPort,
+  releaseNetLink,
+  type NetBridgeMessage,
+  type NetBridgeRequest,
+  type NetLinkPort,
+} from "./doom-net";
+import { removeStaleSocket } from "./doom-wire";
+
+declare var self: Worker;
+
+const FRAME_HEADER = 12;
+
+// How often outgoing rings are drained to the socket (ms)
+const PUMP_MS = 1;
+
+interface Relay {
+  socket: Socket;
+  port: NetLinkPort;
+  pending: Buffer; // Partial frame received so far
+}
+
+const relays = new Set<Relay>();
+let scratch = new Uint8Array(2048);
+
+function startRelay(socket: Socket, port: NetLinkPort, onClose: () => void): void {
+  const relay: Relay = { socket, port, pending: Buffer.alloc(0) };
+  relays.add(relay);
+  socket.setNoDelay?.(true);
+
+  socket.on("data", (data: Buffer) => {
+    let buffer = relay.pending.length > 0 ? Buffer.concat([relay.pending, data]) : data;
+    while (buffer.length >= FRAME_HEADER) {
+      const length = buffer.readUInt32LE(0);
+      if (buffer.length < FRAME_HEADER + length) break;
+      const sentAt = buffer.readDoubleLE(4);
+      port.put(buffer.subarray(FRAME_HEADER, FRAME_HEADER + length), sentAt);
+      buffer = buffer.subarray(FRAME_HEADER + length);
+    }
+    relay.pending = Buffer.from(buffer);
+  });
+  socket.on("close", () => {
+    relays.delete(relay);
+    onClose();
+  });
+  socket.on("error", () => socket.destroy());
+}
+
+// Move everything queued for the other side onto the sockets
+function pump(): void {
+  for (const relay of relays) {
+    for (;;) {
+      const length = relay.port.peek();
+      if (length < 0) break;
+      if (scratch.length < length) scratch = new Uint8Array(length * 2);
+      const packet = scratch.subarray(0, length);
+      const sentAt = relay.port.take(packet);
+      const frame = Buffer.allocUnsafe(FRAME_HEADER + length);
+      frame.writeUInt32LE(length, 0);
+      frame.writeDoubleLE(sentAt, 4);
+      frame.set(packet, FRAME_HEADER);
+      relay.socket.write(frame);
+    }
+  }
+}
+
+function fail(message: string): void {
+  postMessage({ type: "error", message } satisfies NetBridgeMessage);
+}
+
+self.onmessage = (event: MessageEvent<NetBridgeRequest>) => {
+  const { mode, path, board } = event.data;
+  setInterval(pump, PUMP_MS);
+
+  if (mode === "listen") {
+    try {
+      removeStaleSocket(path);
+    } catch (e) {
+      fail(e instanceof Error ? e.message : `${e}`);
+      return;
+    }
+    const server = createServer((socket) => {
+      const slot = claimNetLink(board);
+      if (slot < 0) {
+        socket.destroy(); // Game is full
+        return;
+      }
+      startRelay(socket, openNetLinkPort(board, slot, false), () => releaseNetLink(board, slot));
+    });
+    server.on("error", (e) => fail(`${e}`));
+    server.listen(path, () => postMessage({ type: "ready" } satisfies NetBridgeMessage));
+  } else {
+    const socket = connect(path);
+    socket.once("connect", () => {
+      startRelay(socket, openNetLinkPort(board, 0, true), () => releaseNetLink(board, 0));
+      postMessage({ type: "ready" } satisfies NetBridgeMessage);
+    });
+    socket.once("error", (e) => fail(`${e}`));
+  }
+};
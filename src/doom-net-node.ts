@@ -0,0 +1,77 @@
+/**
+ * DOOM Headless Network Node (worker)
+ *
+ * Runs one engine with no terminal on a loopback netgame board, ticking
+ * at 35 Hz. Lets several players share a process (each engine needs its
+ * own thread while it waits for the others), e.g. for local tests and
+ * the transport benchmark in scripts/net-bench.ts.
+ */
+
+import { DoomEngine } from "./doom-engine";
+import {
+  claimNetLink,
+  createNetClient,
+  createNetHost,
+  type NetBoard,
+  type NetEndpoint,
+} from "./doom-net";
+
+declare var self: Worker;
+
+export interface NetNodeRequest {
+  role: "host" | "client";
+  board: NetBoard;
+  wadPath: string;
+  sharedWad?: Uint8Array;
+  wasmModule?: WebAssembly.Module;
+  players?: number; // Host only: launch when this many have joined
+  deathmatch?: boolean; // Host only
+}
+
+export type NetNodeMessage =
+  | { type: "launched"; slot: number }
+  | { type: "error"; message: string };
+
+// DOOM's native framerate
+const TICK_MS = 1000 / 35;
+
+self.onmessage = async (event: MessageEvent<NetNodeRequest>) => {
+  const request = event.data;
+  let slot = -1;
+
+  let net: NetEndpoint;
+  if (request.role === "host") {
+    net = createNetHost(request.board, {
+      players: request.players ?? 2,
+      deathmatch: request.deathmatch,
+    });
+  } else {
+    slot = claimNetLink(request.board);
+    if (slot < 0) {
+      postMessage({ type: "error", message: "game is full" } satisfies NetNodeMessage);
+      return;
+    }
+    net = createNetClient(request.board, slot);
+  }
+
+  const engine = new DoomEngine({
+    wadPath: request.wadPath,
+    sharedWad: request.sharedWad,
+    wasmModule: request.wasmModule,
+    audio: false,
+    saves: false,
+    net,
+    print: () => {},
+    printErr: (text: string) => console.error(`[net node ${slot + 1}]`, text),
+  });
+
+  try {
+    await engine.init(); // Returns once the host has launched the game
+  } catch (e) {
+    postMessage({ type: "error", message: `${e}` } satisfies NetNodeMessage);
+    return;
+  }
+
+  postMessage({ type: "launched", slot } satisfies NetNodeMessage);
+  setInterval(() => engine.tick(), TICK_MS);
+};
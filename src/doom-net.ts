@@ -0,0 +1,463 @@
+/**
+ * DOOM Loopback Network
+ *
+ * An in-memory packet transport for DOOM's netgame code (doom/net_js.c).
+ * Instances exchange packets through a "board": one SharedArrayBuffer
+ * holding a link per client, each link a pair of packet rings (client to
+ * server "up", server to client "down"). Any thread that has the board
+ * can be a node, so several engines in one process (each in its own
+ * worker, since waiting for other players blocks) play together with no
+ * UDP stack. Across processes, doom-net-bridge.ts carries a link over a
+ * Unix socket.
+ *
+ * Every link also keeps transport metrics: packets and bytes each way,
+ * drops, and one-way delivery latency (send to receive).
+ */
+
+// Address a client passes to -connect; resolves to the server (node 0)
+export const NET_HOST_ADDRESS = "host";
+
+// Clients per board (NET_MAXPLAYERS plus drones); slots are not reused
+export const NET_MAX_LINKS = 16;
+
+// Bytes per ring (power of two); DOOM packets are well under 1 KiB
+const RING_BYTES = 64 * 1024;
+const RING_MASK = RING_BYTES - 1;
+
+// Record header: u32 length, u32 pad, f64 send time
+const RECORD_HEADER = 16;
+const RECORD_PAD = 0xffffffff; // Rest of the ring is unused, wrap to 0
+
+// Board control words
+const CTRL_SERVER_BELL = 0;
+const CTRL_LINKS = 8; // First link's words
+const LINK_WORDS = 8;
+const LINK_STATE = 0;
+const LINK_UP_HEAD = 1;
+const LINK_UP_TAIL = 2;
+const LINK_DOWN_HEAD = 3;
+const LINK_DOWN_TAIL = 4;
+const LINK_CLIENT_BELL = 5;
+
+// Link states
+const LINK_FREE = 0;
+const LINK_OPEN = 1;
+const LINK_CLOSED = 2;
+
+// Per link statistics (Float64), each field has a single writer
+const STAT_PACKETS = 0; // Sender
+const STAT_BYTES = 1; // Sender
+const STAT_DROPPED = 2; // Sender (ring full)
+const STAT_LATENCY_SUM = 3; // Receiver, ms
+const STAT_LATENCY_MAX = 4; // Receiver, ms
+const STAT_RECEIVED = 5; // Receiver
+const STAT_FIELDS = 6;
+const STAT_UP = 0;
+const STAT_DOWN = STAT_FIELDS;
+const LINK_STATS = STAT_FIELDS * 2;
+
+// One tic at DOOM's 35 Hz
+const TIC_MS = 1000 / 35;
+
+/** Shared state of one netgame (or of one bridged link) */
+export interface NetBoard {
+  buffer: SharedArrayBuffer;
+  links: number;
+}
+
+/** Sent to a doom-net-bridge.ts worker to start it */
+export interface NetBridgeRequest {
+  mode: "listen" | "connect";
+  path: string;
+  board: NetBoard;
+}
+
+/** Posted back by the bridge worker */
+export type NetBridgeMessage = { type: "ready" } | { type: "error"; message: string };
+
+/** Module callbacks and command line for an engine on the network */
+export interface NetEndpoint {
+  args: string[];
+  callbacks: Record<string, (...args: any[]) => any>;
+}
+
+export interface NetDirectionStats {
+  packets: number;
+  bytes: number;
+  dropped: number;
+  received: number;
+  latencyAvgMs: number;
+  latencyMaxMs: number;
+}
+
+export interface NetLinkStats {
+  node: number;
+  up: NetDirectionStats; // Client to server
+  down: NetDirectionStats; // Server to client
+}
+
+interface Ring {
+  control: Int32Array;
+  head: number; // Index of the head word in control
+  tail: number;
+  bytes: Uint8Array;
+  view: DataView;
+  stats: Float64Array;
+  stat: number; // STAT_UP or STAT_DOWN
+}
+
+function controlBytes(links: number): number {
+  return (CTRL_LINKS + links * LINK_WORDS) * 4;
+}
+
+function statsBytes(links: number): number {
+  return links * LINK_STATS * 8;
+}
+
+/**
+ * Wall-clock time in ms with sub-ms precision, comparable across threads
+ */
+export function netNow(): number {
+  return performance.timeOrigin + performance.now();
+}
+
+/**
+ * Allocate a board with room for the given number of client links
+ */
+export function createNetBoard(links: number = NET_MAX_LINKS): NetBoard {
+  const size = controlBytes(links) + statsBytes(links) + links * 2 * RING_BYTES;
+  return { buffer: new SharedArrayBuffer(size), links };
+}
+
+function linkWord(slot: number, word: number): number {
+  return CTRL_LINKS + slot * LINK_WORDS + word;
+}
+
+function openRing(board: NetBoard, slot: number, down: boolean): Ring {
+  const control = new Int32Array(board.buffer, 0, controlBytes(board.links) / 4);
+  const stats = new Float64Array(
+    board.buffer,
+    controlBytes(board.links) + slot * LINK_STATS * 8,
+    LINK_STATS
+  );
+  const offset =
+    controlBytes(board.links) + statsBytes(board.links) + (slot * 2 + (down ? 1 : 0)) * RING_BYTES;
+  return {
+    control,
+    head: linkWord(slot, down ? LINK_DOWN_HEAD : LINK_UP_HEAD),
+    tail: linkWord(slot, down ? LINK_DOWN_TAIL : LINK_UP_TAIL),
+    bytes: new Uint8Array(board.buffer, offset, RING_BYTES),
+    view: new DataView(board.buffer, offset, RING_BYTES),
+    stats,
+    stat: down ? STAT_DOWN : STAT_UP,
+  };
+}
+
+/**
+ * Append a packet; returns false (and counts a drop) if the ring is full,
+ * like a datagram lost on the wire
+ */
+function ringPush(ring: Ring, data: Uint8Array, sentAt: number): boolean {
+  const head = Atomics.load(ring.control, ring.head);
+  let tail = Atomics.load(ring.control, ring.tail);
+  const size = RECORD_HEADER + ((data.length + 7) & ~7);
+  let pos = tail & RING_MASK;
+  const contiguous = RING_BYTES - pos;
+  const needed = contiguous < size ? size + contiguous : size;
+
+  if (RING_BYTES - ((tail - head) | 0) < needed) {
+    ring.stats[ring.stat + STAT_DROPPED]! += 1;
+    return false;
+  }
+
+  if (contiguous < size) {
+    ring.view.setUint32(pos, RECORD_PAD, true);
+    tail = (tail + contiguous) | 0;
+    pos = 0;
+  }
+  ring.view.setUint32(pos, data.length, true);
+  ring.view.setFloat64(pos + 8, sentAt, true);
+  ring.bytes.set(data, pos + RECORD_HEADER);
+  Atomics.store(ring.control, ring.tail, (tail + size) | 0);
+
+  ring.stats[ring.stat + STAT_PACKETS]! += 1;
+  ring.stats[ring.stat + STAT_BYTES]! += data.length;
+  return true;
+}
+
+/**
+ * Length of the next packet, or -1 if the ring is empty
+ */
+function ringPeek(ring: Ring): number {
+  for (;;) {
+    const head = Atomics.load(ring.control, ring.head);
+    if (head === Atomics.load(ring.control, ring.tail)) return -1;
+    const pos = head & RING_MASK;
+    const length = ring.view.getUint32(pos, true);
+    if (length !== RECORD_PAD) return length;
+    Atomics.store(ring.control, ring.head, (head + RING_BYTES - pos) | 0);
+  }
+}
+
+/**
+ * Copy the next packet into target (sized from ringPeek) and return its send time
+ * Latency is recorded unless the caller only forwards the packet (bridge).
+ */
+function ringPop(ring: Ring, target: Uint8Array, record: boolean = true): number {
+  const length = ringPeek(ring);
+  if (length < 0) return -1;
+  const head = Atomics.load(ring.control, ring.head);
+  const pos = head & RING_MASK;
+  const sentAt = ring.view.getFloat64(pos + 8, true);
+  target.set(ring.bytes.subarray(pos + RECORD_HEADER, pos + RECORD_HEADER + length));
+  Atomics.store(ring.control, ring.head, (head + RECORD_HEADER + ((length + 7) & ~7)) | 0);
+
+  if (record) {
+    const latency = Math.max(0, netNow() - sentAt);
+    ring.stats[ring.stat + STAT_RECEIVED]! += 1;
+    ring.stats[ring.stat + STAT_LATENCY_SUM]! += latency;
+    if (latency > ring.stats[ring.stat + STAT_LATENCY_MAX]!) {
+      ring.stats[ring.stat + STAT_LATENCY_MAX] = latency;
+    }
+  }
+  return sentAt;
+}
+
+function ringBell(control: Int32Array, bell: number): void {
+  Atomics.add(control, bell, 1);
+  Atomics.notify(control, bell);
+}
+
+/**
+ * Block the calling thread until something rings the bell or ms pass
+ */
+function waitForBell(control: Int32Array, bell: number, seen: number, ms: number): void {
+  Atomics.wait(control, bell, seen, ms);
+}
+
+/**
+ * Take a free client link on the board; returns its slot, or -1 if full
+ */
+export function claimNetLink(board: NetBoard): number {
+  const control = new Int32Array(board.buffer, 0, controlBytes(board.links) / 4);
+  for (let slot = 0; slot < board.links; slot++) {
+    const state = linkWord(slot, LINK_STATE);
+    if (Atomics.compareExchange(control, state, LINK_FREE, LINK_OPEN) === LINK_FREE) {
+      return slot;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Mark a link as gone; the server stops reading it (the game times the player out)
+ */
+export function releaseNetLink(board: NetBoard, slot: number): void {
+  const control = new Int32Array(board.buffer, 0, controlBytes(board.links) / 4);
+  Atomics.store(control, linkWord(slot, LINK_STATE), LINK_CLOSED);
+  ringBell(control, CTRL_SERVER_BELL);
+}
+
+/**
+ * Endpoint for the engine hosting the game (-privateserver)
+ * It plays too, through DOOM's own loopback client; -nodes makes it launch
+ * as soon as that many players (including itself) have joined.
+ */
+export function createNetHost(
+  board: NetBoard,
+  options: { players: number; deathmatch?: boolean }
+): NetEndpoint {
+  const control = new Int32Array(board.buffer, 0, controlBytes(board.links) / 4);
+  const up: Ring[] = [];
+  const down: Ring[] = [];
+  for (let slot = 0; slot < board.links; slot++) {
+    up.push(openRing(board, slot, false));
+    down.push(openRing(board, slot, true));
+  }
+  let cursor = 0; // Round-robin over links so no client starves the others
+  let pending = -1; // Link whose packet netPeek found
+
+  const args = ["-privateserver", "-nodes", String(options.players)];
+  if (options.deathmatch) args.push("-deathmatch");
+
+  return {
+    args,
+    callbacks: {
+      netSend(node: number, data: Uint8Array): void {
+        const slot = node - 1;
+        const link = down[slot];
+        if (!link || Atomics.load(control, linkWord(slot, LINK_STATE)) !== LINK_OPEN) return;
+        ringPush(link, data, netNow());
+        ringBell(control, linkWord(slot, LINK_CLIENT_BELL));
+      },
+      netPeek(): number {
+        for (let i = 0; i < board.links; i++) {
+          const slot = (cursor + i) % board.links;
+          if (Atomics.load(control, linkWord(slot, LINK_STATE)) !== LINK_OPEN) continue;
+          const length = ringPeek(up[slot]!);
+          if (length >= 0) {
+            pending = slot;
+            cursor = (slot + 1) % board.links;
+            return length;
+          }
+        }
+        return -1;
+      },
+      netRecv(target: Uint8Array): number {
+        ringPop(up[pending]!, target);
+        return pending + 1;
+      },
+      netResolve(_address: string): number {
+        return -1; // The host only answers; it never resolves (e.g. a master server)
+      },
+      netWait(ms: number): void {
+        const seen = Atomics.load(control, CTRL_SERVER_BELL);
+        for (let slot = 0; slot < board.links; slot++) {
+          if (ringPeek(up[slot]!) >= 0) return;
+        }
+        waitForBell(control, CTRL_SERVER_BELL, seen, ms);
+      },
+    },
+  };
+}
+
+/**
+ * Endpoint for an engine joining through a claimed link (-connect host)
+ */
+export function createNetClient(board: NetBoard, slot: number): NetEndpoint {
+  const control = new Int32Array(board.buffer, 0, controlBytes(board.links) / 4);
+  const up = openRing(board, slot, false);
+  const down = openRing(board, slot, true);
+  const bell = linkWord(slot, LINK_CLIENT_BELL);
+
+  return {
+    args: ["-connect", NET_HOST_ADDRESS],
+    callbacks: {
+      netSend(_node: number, data: Uint8Array): void {
+        ringPush(up, data, netNow());
+        ringBell(control, CTRL_SERVER_BELL);
+      },
+      netPeek(): number {
+        return ringPeek(down);
+      },
+      netRecv(target: Uint8Array): number {
+        ringPop(down, target);
+        return 0;
+      },
+      netResolve(address: string): number {
+        return address === NET_HOST_ADDRESS ? 0 : -1;
+      },
+      netWait(ms: number): void {
+        const seen = Atomics.load(control, bell);
+        if (ringPeek(down) >= 0) return;
+        waitForBell(control, bell, seen, ms);
+      },
+    },
+  };
+}
+
+/**
+ * Raw access to one link for code that relays it (the socket bridge)
+ * "server side" reads up and writes down, "client side" the reverse.
+ */
+export interface NetLinkPort {
+  /** Length of the next incoming packet, or -1 */
+  peek: () => number;
+  /** Copy the next incoming packet into target, returning its send time */
+  take: (target: Uint8Array) => number;
+  /** Queue an outgoing packet with its original send time */
+  put: (data: Uint8Array, sentAt: number) => boolean;
+  /** Whether the link is still open */
+  open: () => boolean;
+}
+
+export function openNetLinkPort(board: NetBoard, slot: number, serverSide: boolean): NetLinkPort {
+  const control = new Int32Array(board.buffer, 0, controlBytes(board.links) / 4);
+  const incoming = openRing(board, slot, !serverSide);
+  const outgoing = openRing(board, slot, serverSide);
+  const bell = serverSide ? linkWord(slot, LINK_CLIENT_BELL) : CTRL_SERVER_BELL;
+
+  return {
+    peek: () => ringPeek(incoming),
+    take: (target: Uint8Array) => ringPop(incoming, target, false),
+    put(data: Uint8Array, sentAt: number): boolean {
+      const queued = ringPush(outgoing, data, sentAt);
+      ringBell(control, bell);
+      return queued;
+    },
+    open: () => Atomics.load(control, linkWord(slot, LINK_STATE)) === LINK_OPEN,
+  };
+}
+
+/**
+ * Start a socket bridge worker for the board and wait until it is listening
+ * or connected. "listen" hosts (clients claim links), "connect" joins with link 0.
+ */
+export function startNetBridge(
+  mode: NetBridgeRequest["mode"],
+  path: string,
+  board: NetBoard
+): Promise<Worker> {
+  const worker = new Worker(new URL("./doom-net-bridge.ts", import.meta.url).href);
+  return new Promise((resolveBridge, rejectBridge) => {
+    worker.onmessage = (event: MessageEvent<NetBridgeMessage>) => {
+      if (event.data.type === "ready") {
+        resolveBridge(worker);
+      } else {
+        worker.terminate();
+        rejectBridge(new Error(`Network bridge (${path}): ${event.data.message}`));
+      }
+    };
+    worker.postMessage({ mode, path, board } satisfies NetBridgeRequest);
+  });
+}
+
+function directionStats(stats: Float64Array, base: number): NetDirectionStats {
+  const received = stats[base + STAT_RECEIVED] ?? 0;
+  return {
+    packets: stats[base + STAT_PACKETS] ?? 0,
+    bytes: stats[base + STAT_BYTES] ?? 0,
+    dropped: stats[base + STAT_DROPPED] ?? 0,
+    received,
+    latencyAvgMs: received > 0 ? (stats[base + STAT_LATENCY_SUM] ?? 0) / received : 0,
+    latencyMaxMs: stats[base + STAT_LATENCY_MAX] ?? 0,
+  };
+}
+
+/**
+ * Read the transport metrics of every link that has been used
+ */
+export function getNetStats(board: NetBoard): NetLinkStats[] {
+  const control = new Int32Array(board.buffer, 0, controlBytes(board.links) / 4);
+  const result: NetLinkStats[] = [];
+  for (let slot = 0; slot < board.links; slot++) {
+    if (Atomics.load(control, linkWord(slot, LINK_STATE)) === LINK_FREE) continue;
+    const stats = new Float64Array(
+      board.buffer,
+      controlBytes(board.links) + slot * LINK_STATS * 8,
+      LINK_STATS
+    );
+    result.push({
+      node: slot + 1,
+      up: directionStats(stats, STAT_UP),
+      down: directionStats(stats, STAT_DOWN),
+    });
+  }
+  return result;
+}
+
+/**
+ * One line per link: throughput over elapsedMs and delivery latency in ms and tics
+ */
+export function formatNetStats(stats: NetLinkStats[], elapsedMs: number): string {
+  const seconds = Math.max(elapsedMs, 1) / 1000;
+  const side = (name: string, s: NetDirectionStats) =>
+    `${name} ${(s.packets / seconds).toFixed(1)} pkt/s ` +
+    `${(s.bytes / 1024 / seconds).toFixed(2)} KiB/s ` +
+    `lat ${s.latencyAvgMs.toFixed(3)}/${s.latencyMaxMs.toFixed(3)} ms ` +
+    `(${(s.latencyAvgMs / TIC_MS).toFixed(3)} tics)` +
+    (s.dropped > 0 ? ` dropped ${s.dropped}` : "");
+  return stats
+    .map((link) => `node ${link.node}: ${side("up", link.up)} | ${side("down", link.down)}`)
+    .join("\n");
+}
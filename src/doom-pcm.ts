@@ -0,0 +1,489 @@
+/**
+ * PCM Audio Sink
+ *
+ * Mixes sound effects and music in-process and streams the mix to a single
+ * raw PCM player process (pacat or aplay reading stdin). The mpv output
+ * instead spawns one mpv per sound effect, plus a resident one for music
+ * with an IPC socket to change its volume.
+ *
+ * Music is decoded in-process (doom-mp3.ts) a small window ahead into a
+ * PCM ring that the mixer drains; each mixer pass decodes only what the
+ * ring has room for. A looping track rewinds its decoder when a pass ends,
+ * so the loop has no gap and nothing is respawned. An external decoder
+ * (ffmpeg or mpg123) can stream into the same ring instead, if asked for.
+ */
+
+import { spawn } from "child_process";
+import { readFileSync } from "fs";
+import type { Readable } from "stream";
+import { createMp3Decoder, type Mp3Decoder } from "./doom-mp3";
+
+// Output format: signed 16-bit little endian stereo, at the music's rate
+export const PCM_RATE = 48000;
+
+// The mixer runs this often and keeps the player this far ahead
+const MIX_INTERVAL_MS = 10;
+const MIX_LEAD_FRAMES = Math.round(PCM_RATE * 0.08);
+// Behind by more than this (a stall), the mix skips ahead instead
+const MIX_MAX_FRAMES = Math.round(PCM_RATE * 0.5);
+
+// Music decoded ahead of the mixer, and at most this much per mixer pass
+const MUSIC_WINDOW_FRAMES = Math.round(PCM_RATE * 0.5);
+const MUSIC_PUMP_FRAMES = Math.round(PCM_RATE * 0.1);
+// Frames asked of the MP3 decoder at once
+const MUSIC_BLOCK_FRAMES = 1152;
+
+// Sound effects mixed at once; the oldest is cut beyond that
+const MAX_VOICES = 32;
+
+/**
+ * How music is decoded: in-process ("builtin", the default) or by an
+ * external ffmpeg/mpg123 process per pass ("external", opt-in)
+ */
+export type MusicDecoding = "builtin" | "external";
+
+/**
+ * A decoded sound effect: mono samples in -1..1
+ */
+export interface PcmSound {
+  samples: Float32Array;
+  rate: number;
+}
+
+export interface PcmSink {
+  /** Mix in a sound effect (volume 0-127, separation 0 = left .. 254 = right) */
+  playSound: (sound: PcmSound, volume: number, separation: number) => void;
+  /** Stream a music file, replacing the current one */
+  playMusic: (path: string, looping: boolean) => void;
+  stopMusic: () => void;
+  /** Music volume, 0-127 */
+  setMusicVolume: (volume: number) => void;
+  /** Sound effects being mixed, plus one for music */
+  voices: () => number;
+  close: () => void;
+}
+
+// Raw PCM players, tried in order
+const PLAYERS: string[][] = [
+  ["pacat", "--raw", "--format=s16le", `--rate=${PCM_RATE}`, "--channels=2", "--latency-msec=50"],
+  ["aplay", "-q", "-t", "raw", "-f", "S16_LE", "-r", `${PCM_RATE}`, "-c", "2", "-B", "50000"],
+];
+
+// External MP3 decoders, tried in order; the file goes last
+const DECODERS: string[][] = [
+  [
+    "ffmpeg",
+    "-loglevel",
+    "quiet",
+    "-i",
+    "FILE",
+    "-f",
+    "s16le",
+    "-ac",
+    "2",
+    "-ar",
+    `${PCM_RATE}`,
+    "-",
+  ],
+  ["mpg123", "-q", "-s", "-r", `${PCM_RATE}`, "--stereo", "FILE"],
+];
+
+/**
+ * The raw PCM player the sink would stream to, or undefined if none is installed
+ */
+export function findPcmPlayer(): string[] | undefined {
+  return PLAYERS.find(([name]) => Bun.which(name!));
+}
+
+/**
+ * Decode music with the first external decoder found (ffmpeg or mpg123),
+ * as s16le stereo at PCM_RATE; null if neither is installed
+ */
+export function spawnMusicDecoder(path: string): Readable | null {
+  for (const [command, ...args] of DECODERS) {
+    if (!Bun.which(command!)) continue;
+    const proc = spawn(
+      command!,
+      args.map((arg) => (arg === "FILE" ? path : arg)),
+      { stdio: ["ignore", "pipe", "ignore"] }
+    );
+    proc.on("error", () => proc.stdout.destroy());
+    proc.stdout.once("close", () => proc.kill());
+    return proc.stdout;
+  }
+  return null;
+}
+
+/**
+ * Decode a WAV file (8 or 16 bit PCM, any channel count) to mono
+ */
+export function decodeWav(data: Uint8Array): PcmSound | null {
+  const view = new DataView(data.buffer, data.byteOffset, data.byteLength);
+  const tag = (at: number) => String.fromCharCode(...data.subarray(at, at + 4));
+  if (data.length < 12 || tag(0) !== "RIFF" || tag(8) !== "WAVE") return null;
+
+  let channels = 0;
+  let rate = 0;
+  let bits = 0;
+  for (let at = 12; at + 8 <= data.length; ) {
+    const size = view.getUint32(at + 4, true);
+    const body = at + 8;
+    if (tag(at) === "fmt " && size >= 16) {
+      if (view.getUint16(body, true) !== 1) return null; // Not PCM
+      channels = view.getUint16(body + 2, true);
+      rate = view.getUint32(body + 4, true);
+      bits = view.getUint16(body + 14, true);
+    } else if (tag(at) === "data" && channels > 0 && (bits === 8 || bits === 16)) {
+      const bytes = bits / 8;
+      const frames = Math.floor(Math.min(size, data.length - body) / (bytes * channels));
+      const samples = new Float32Array(frames);
+      for (let i = 0; i < frames; i++) {
+        let sum = 0;
+        for (let c = 0; c < channels; c++) {
+          const offset = body + (i * channels + c) * bytes;
+          sum +=
+            bits === 8 ? (data[offset]! - 128) / 128 : view.getInt16(offset, true) / 32768;
+        }
+        samples[i] = sum / channels;
+      }
+      return { samples, rate };
+    }
+    at = body + size + (size & 1);
+  }
+  return null;
+}
+
+/**
+ * Ring of stereo frames between the music decoder and the mixer
+ */
+function createPcmRing(frames: number) {
+  const samples = new Float32Array(frames * 2);
+  let read = 0;
+  let count = 0;
+
+  return {
+    space: () => frames - count,
+
+    /** Write up to space() frames of stereo from `data`; returns frames written */
+    write(data: Float32Array, max: number): number {
+      const n = Math.min(max, frames - count);
+      let at = (read + count) % frames;
+      for (let i = 0; i < n; i++) {
+        samples[at * 2] = data[i * 2]!;
+        samples[at * 2 + 1] = data[i * 2 + 1]!;
+        at = at + 1 === frames ? 0 : at + 1;
+      }
+      count += n;
+      return n;
+    },
+
+    /** The same for s16le stereo from `data` */
+    writeS16(data: Buffer, start: number, max: number): number {
+      const n = Math.min(max, frames - count);
+      let at = (read + count) % frames;
+      for (let i = 0; i < n; i++) {
+        const offset = start + i * 4;
+        samples[at * 2] = data.readInt16LE(offset) / 32768;
+        samples[at * 2 + 1] = data.readInt16LE(offset + 2) / 32768;
+        at = at + 1 === frames ? 0 : at + 1;
+      }
+      count += n;
+      return n;
+    },
+
+    /** Add up to `max` frames into `out`, scaled by `gain`; returns frames read */
+    mixInto(out: Float32Array, max: number, gain: number): number {
+      const n = Math.min(max, count);
+      for (let i = 0; i < n; i++) {
+        out[i * 2]! += samples[read * 2]! * gain;
+        out[i * 2 + 1]! += samples[read * 2 + 1]! * gain;
+        read = read + 1 === frames ? 0 : read + 1;
+      }
+      count -= n;
+      return n;
+    },
+
+    clear(): void {
+      read = 0;
+      count = 0;
+    },
+  };
+}
+
+type PcmRing = ReturnType<typeof createPcmRing>;
+
+interface MusicSource {
+  /** Decode into the ring while it has room */
+  pump: () => void;
+  stop: () => void;
+}
+
+/**
+ * One music track decoded in-process into the ring, resampled to PCM_RATE
+ * if it is at another rate. Looping rewinds the decoder; the last frame of
+ * one pass is interpolated into the first of the next, as within a pass.
+ */
+function createDecodedMusic(decoder: Mp3Decoder, looping: boolean, ring: PcmRing): MusicSource {
+  const step = decoder.sampleRate / PCM_RATE;
+  const block = new Float32Array(MUSIC_BLOCK_FRAMES * 2);
+  const out = new Float32Array(Math.ceil(MUSIC_BLOCK_FRAMES / step + 1) * 2);
+  let frames = 0; // Decoded frames in block
+  let position = 0; // Source position in block; -1 is the previous block's last frame
+  let lastLeft = 0;
+  let lastRight = 0;
+  let ended = false;
+
+  const refill = (): boolean => {
+    if (frames > 0) {
+      lastLeft = block[frames * 2 - 2]!;
+      lastRight = block[frames * 2 - 1]!;
+      position -= frames;
+    }
+    frames = decoder.read(block, MUSIC_BLOCK_FRAMES);
+    if (frames === 0 && looping) {
+      decoder.rewind();
+      frames = decoder.read(block, MUSIC_BLOCK_FRAMES);
+    }
+    return frames > 0;
+  };
+
+  const pump = (): void => {
+    let budget = Math.min(ring.space(), MUSIC_PUMP_FRAMES);
+    while (budget > 0 && !ended) {
+      if (position + 1 >= frames) {
+        if (!refill()) ended = true;
+        continue;
+      }
+      let n = 0;
+      while (n < budget && n * 2 < out.length && position + 1 < frames) {
+        const index = Math.floor(position);
+        const frac = position - index;
+        const left = index < 0 ? lastLeft : block[index * 2]!;
+        const right = index < 0 ? lastRight : block[index * 2 + 1]!;
+        out[n * 2] = left + (block[index * 2 + 2]! - left) * frac;
+        out[n * 2 + 1] = right + (block[index * 2 + 3]! - right) * frac;
+        position += step;
+        n++;
+      }
+      budget -= ring.write(out, n);
+    }
+  };
+
+  return {
+    pump,
+    stop(): void {
+      ended = true;
+    },
+  };
+}
+
+/**
+ * One music track streamed by an external decoder into the ring, with the
+ * decoder started again for each pass if looping
+ */
+function createMusicStream(
+  path: string,
+  looping: boolean,
+  ring: PcmRing,
+  log: (message: string) => void
+): MusicSource {
+  let stream: Readable | null = null;
+  let pending: Buffer[] = []; // Decoded PCM waiting for room in the ring
+  let carry: Buffer | null = null; // Part of a frame split between chunks
+  let stopped = false;
+
+  const pump = (): void => {
+    while (pending.length > 0 && ring.space() > 0) {
+      const chunk = pending[0]!;
+      const frames = chunk.length >> 2;
+      const written = ring.writeS16(chunk, 0, frames);
+      if (written < frames) {
+        pending[0] = chunk.subarray(written * 4);
+      } else {
+        pending.shift();
+      }
+    }
+    if (pending.length > 0) stream?.pause();
+    else stream?.resume();
+  };
+
+  const open = (): void => {
+    stream = spawnMusicDecoder(path);
+    if (!stream) {
+      log(`No external music decoder (ffmpeg or mpg123) for ${path}`);
+      return;
+    }
+    stream.on("data", (chunk: Buffer) => {
+      if (stopped) return;
+      const data = carry ? Buffer.concat([carry, chunk]) : chunk;
+      const usable = data.length - (data.length & 3);
+      carry = usable < data.length ? Buffer.from(data.subarray(usable)) : null;
+      if (usable > 0) pending.push(data.subarray(0, usable));
+      pump();
+    });
+    stream.on("end", () => {
+      // The ring still holds a window of this pass while the next one starts
+      if (!stopped && looping) open();
+    });
+    stream.on("error", (err) => log(`Music decoder error: ${err.message}`));
+  };
+
+  open();
+
+  return {
+    pump,
+    stop(): void {
+      stopped = true;
+      pending = [];
+      stream?.destroy();
+      stream = null;
+    },
+  };
+}
+
+interface Voice {
+  sound: PcmSound;
+  position: number;
+  step: number;
+  left: number;
+  right: number;
+}
+
+/**
+ * Start the sink, or return null if no raw PCM player is installed
+ */
+export function createPcmSink(options: {
+  musicDecoding?: MusicDecoding;
+  log: (message: string) => void;
+}): PcmSink | null {
+  const { log } = options;
+  const musicDecoding = options.musicDecoding ?? "builtin";
+
+  const command = findPcmPlayer();
+  if (!command) return null;
+  const player = spawn(command[0]!, command.slice(1), { stdio: ["pipe", "ignore", "ignore"] });
+  log(`PCM sink playing through ${command[0]}`);
+
+  const ring = createPcmRing(MUSIC_WINDOW_FRAMES);
+  const voices: Voice[] = [];
+  let music: MusicSource | null = null;
+  let musicGain = 100 / 127;
+  let closed = false;
+
+  let mix = new Float32Array(0);
+  let out = Buffer.alloc(0);
+  let start = performance.now();
+  let written = 0;
+
+  const mixFrames = (frames: number): void => {
+    if (mix.length < frames * 2) {
+      mix = new Float32Array(frames * 2);
+      out = Buffer.alloc(frames * 4);
+    }
+    mix.fill(0, 0, frames * 2);
+
+    if (music) {
+      music.pump();
+      ring.mixInto(mix, frames, musicGain);
+    }
+
+    for (let v = voices.length - 1; v >= 0; v--) {
+      const voice = voices[v]!;
+      const { samples } = voice.sound;
+      for (let i = 0; i < frames; i++) {
+        const index = Math.floor(voice.position);
+        if (index + 1 >= samples.length) break;
+        const frac = voice.position - index;
+        const sample = samples[index]! + (samples[index + 1]! - samples[index]!) * frac;
+        mix[i * 2]! += sample * voice.left;
+        mix[i * 2 + 1]! += sample * voice.right;
+        voice.position += voice.step;
+      }
+      if (voice.position + 1 >= samples.length) voices.splice(v, 1);
+    }
+
+    for (let i = 0; i < frames * 2; i++) {
+      const sample = Math.max(-1, Math.min(1, mix[i]!));
+      out.writeInt16LE(Math.round(sample * 32767), i * 2);
+    }
+    player.stdin!.write(Buffer.from(out.subarray(0, frames * 4)));
+  };
+
+  const timer = setInterval(() => {
+    const now = performance.now();
+    let due = Math.floor(((now - start) * PCM_RATE) / 1000) + MIX_LEAD_FRAMES - written;
+    if (due > MIX_MAX_FRAMES) {
+      // Stalled: start again from now rather than catch up in one burst
+      start = now;
+      written = 0;
+      due = MIX_LEAD_FRAMES;
+    }
+    if (due <= 0) return;
+    mixFrames(due);
+    written += due;
+  }, MIX_INTERVAL_MS);
+
+  const close = (): void => {
+    if (closed) return;
+    closed = true;
+    clearInterval(timer);
+    music?.stop();
+    music = null;
+    voices.length = 0;
+    player.stdin!.destroy();
+    player.kill();
+  };
+  player.on("exit", () => {
+    if (!closed) log(`${command[0]} exited; audio stopped`);
+    close();
+  });
+  player.stdin!.on("error", () => close());
+
+  return {
+    playSound(sound: PcmSound, volume: number, separation: number): void {
+      if (closed || sound.samples.length < 2) return;
+      if (voices.length >= MAX_VOICES) voices.shift();
+      const gain = Math.max(0, Math.min(127, volume)) / 127;
+      const sep = Math.max(0, Math.min(254, separation));
+      voices.push({
+        sound,
+        position: 0,
+        step: sound.rate / PCM_RATE,
+        left: gain * Math.min(1, (254 - sep) / 127),
+        right: gain * Math.min(1, sep / 127),
+      });
+    },
+
+    playMusic(path: string, looping: boolean): void {
+      if (closed) return;
+      music?.stop();
+      music = null;
+      ring.clear();
+      if (musicDecoding === "external") {
+        music = createMusicStream(path, looping, ring, log);
+        return;
+      }
+      const decoder = createMp3Decoder(readFileSync(path));
+      if (!decoder) {
+        log(`Cannot decode music (not MPEG-1 Layer III?): ${path}`);
+        return;
+      }
+      music = createDecodedMusic(decoder, looping, ring);
+      music.pump();
+    },
+
+    stopMusic(): void {
+      music?.stop();
+      music = null;
+      ring.clear();
+    },
+
+    setMusicVolume(volume: number): void {
+      musicGain = Math.max(0, Math.min(127, volume)) / 127;
+    },
+
+    voices: () => voices.length + (music ? 1 : 0),
+
+    close,
+  };
+}
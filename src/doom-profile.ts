@@ -0,0 +1,147 @@
+/**
+ * DOOM Sampling Profiler
+ *
+ * Samples the main thread's stack with JavaScriptCore's sampling profiler
+ * and folds the samples into collapsed stacks ("root;caller;callee count"
+ * per line), the input format of flamegraph.pl, speedscope and inferno.
+ * WASM frames carry DOOM's C function names when doom.wasm keeps its name
+ * section (a DOOM_PROFILE=1 build, see build-doom.sh); frames that only
+ * have an index are resolved through the build's symbol map.
+ */
+
+import { existsSync, readFileSync, writeFileSync } from "fs";
+import { join } from "path";
+import { samplingProfilerStackTraces, startSamplingProfiler } from "bun:jsc";
+import { BUILD_DIR } from "./doom-engine";
+import { debugLog } from "./debug";
+
+// How often the sampled traces are folded, so the profiler's buffer stays small
+const DRAIN_INTERVAL_MS = 1000;
+
+interface SampledFrame {
+  name?: string;
+  location?: string;
+}
+
+export interface StackProfiler {
+  /** Fold the samples taken so far (also done periodically) */
+  drain: () => void;
+  /** Stop folding and write the collapsed stacks; returns the sample count */
+  write: (path: string) => number;
+  /** Self samples per function, most sampled first */
+  top: (count: number) => [string, number][];
+}
+
+/**
+ * Read the function index to name map written by --emit-symbol-map
+ */
+export function loadSymbolMap(buildDir: string): Map<number, string> {
+  const symbols = new Map<number, string>();
+  const path = join(buildDir, "doom.js.symbols");
+  if (!existsSync(path)) return symbols;
+  for (const line of readFileSync(path, "utf8").split("\n")) {
+    const colon = line.indexOf(":");
+    if (colon > 0) symbols.set(parseInt(line.slice(0, colon), 10), line.slice(colon + 1).trim());
+  }
+  return symbols;
+}
+
+function frameName(frame: SampledFrame, symbols: Map<number, string>): string {
+  let name = frame.name || "";
+  const wasm = /wasm-function\[(\d+)\]/.exec(name || frame.location || "");
+  if (wasm) {
+    name = symbols.get(parseInt(wasm[1]!, 10)) ?? (name || wasm[0]);
+  }
+  if (!name || name === "(anonymous function)") {
+    const file = frame.location?.split("/").pop();
+    name = file ? `(anonymous:${file})` : "(anonymous)";
+  }
+  // Collapsed stacks separate frames with ';' and end with ' count'
+  return name.replace(/;/g, ",").replace(/\s+/g, "_");
+}
+
+/**
+ * Fold JSC stack traces (innermost frame first) into collapsed stacks
+ */
+export function collapseStackTraces(
+  traces: unknown,
+  stacks: Map<string, number>,
+  symbols: Map<number, string>
+): number {
+  const list = (Array.isArray(traces) ? traces : ((traces as any)?.traces ?? [])) as unknown[];
+  let samples = 0;
+  for (const trace of list) {
+    const frames = (
+      Array.isArray(trace) ? trace : ((trace as any)?.frames ?? [])
+    ) as SampledFrame[];
+    if (!frames.length) continue;
+    const names = ["doom"];
+    for (let i = frames.length - 1; i >= 0; i--) names.push(frameName(frames[i]!, symbols));
+    const key = names.join(";");
+    stacks.set(key, (stacks.get(key) ?? 0) + 1);
+    samples++;
+  }
+  return samples;
+}
+
+/**
+ * Start sampling the main thread
+ * JSC's profiler cannot be stopped once started; write() stops the folding.
+ */
+export function startStackProfiler(buildDir: string = BUILD_DIR): StackProfiler {
+  const symbols = loadSymbolMap(buildDir);
+  const stacks = new Map<string, number>();
+  let samples = 0;
+
+  startSamplingProfiler();
+  debugLog("Profile", `sampling started (${symbols.size} symbols from ${buildDir})`);
+
+  function drain(): void {
+    try {
+      const traces = samplingProfilerStackTraces() as unknown;
+      samples += collapseStackTraces(
+        typeof traces === "string" ? JSON.parse(traces) : traces,
+        stacks,
+        symbols
+      );
+    } catch (e) {
+      debugLog("Profile", `failed to read samples: ${e}`);
+    }
+  }
+
+  const timer = setInterval(drain, DRAIN_INTERVAL_MS);
+  timer.unref();
+
+  return {
+    drain,
+
+    write(path: string): number {
+      clearInterval(timer);
+      drain();
+      const lines = [...stacks].sort((a, b) => b[1] - a[1]).map(([key, n]) => `${key} ${n}`);
+      writeFileSync(path, lines.join("\n") + "\n");
+      return samples;
+    },
+
+    top(count: number): [string, number][] {
+      const self = new Map<string, number>();
+      for (const [key, n] of stacks) {
+        const leaf = key.slice(key.lastIndexOf(";") + 1);
+        self.set(leaf, (self.get(leaf) ?? 0) + n);
+      }
+      return [...self].sort((a, b) => b[1] - a[1]).slice(0, count);
+    },
+  };
+}
+
+/**
+ * A short self-time summary for the console
+ */
+export function formatProfileTop(profiler: StackProfiler, samples: number, count = 10): string {
+  const lines = [`${samples} samples, top functions by self time:`];
+  for (const [name, n] of profiler.top(count)) {
+    const share = samples > 0 ? ((n * 100) / samples).toFixed(1) : "0.0";
+    lines.push(`  ${share.padStart(5)}%  ${name}`);
+  }
+  return lines.join("\n");
+}
@@ -0,0 +1,552 @@
+/**
+ * DOOM Session Recording
+ *
+ * A small, seekable record of a session, for bug reports and for replaying
+ * the same workload after a performance change:
+ *
+ *   inputs: the DOOM demo lump (one ticcmd per game tic), recorded by the
+ *           engine itself, so replaying it re-runs exactly the same game
+ *   cells:  optionally, what the terminal showed, as doom-wire cell diffs
+ *           tagged with their game tic, with a keyframe every few seconds
+ *
+ * File layout: "DREC", then chunks of u8 type, u32 length (little endian),
+ * payload:
+ *   INFO   JSON RecordingInfo
+ *   FRAME  varint tic, then one doom-wire KEYFRAME or DIFF message
+ *   DEMO   the demo lump
+ *   INDEX  varint demo offset, varint count, then per keyframe varint tic
+ *          and varint offset (both as deltas from the previous keyframe)
+ * and finally a trailer: u32 offset of the INDEX chunk, "DREC".
+ *
+ * A reader seeks through the index to the last keyframe at or before a tic
+ * and applies diffs from there. A file without a trailer (the recording was
+ * cut short) is still read front to back.
+ */
+
+import { closeSync, existsSync, openSync, readFileSync, writeFileSync, writeSync } from "fs";
+import { basename } from "path";
+import { DoomEngine } from "./doom-engine";
+import { createCellGrid, type CellGrid } from "./doom-cells";
+import { ANSI_SESSION_END, ANSI_SESSION_START, createAnsiEncoder } from "./doom-ansi";
+import { createWireDecoder, createWireEncoder, WIRE_HEADER, WIRE_KEYFRAME } from "./doom-wire";
+
+const MAGIC = new Uint8Array([0x44, 0x52, 0x45, 0x43]); // "DREC"
+const CHUNK_HEADER = 5;
+const TRAILER = 8;
+
+const CHUNK_INFO = 1;
+const CHUNK_FRAME = 2;
+const CHUNK_DEMO = 3;
+const CHUNK_INDEX = 4;
+
+export const RECORDING_VERSION = 1;
+
+// DOOM's native framerate
+const TICRATE = 35;
+const TICK_MS = 1000 / TICRATE;
+
+// Game tics between keyframes of the cell stream (seek granularity)
+const KEYFRAME_TICS = 5 * TICRATE;
+
+export interface RecordingInfo {
+  version: number;
+  wad: string; // WAD file name the demo was recorded with
+  date: string;
+  cells: boolean; // Whether a cell stream follows
+}
+
+function varint(out: number[], value: number): void {
+  while (value >= 0x80) {
+    out.push((value & 0x7f) | 0x80);
+    value >>>= 7;
+  }
+  out.push(value);
+}
+
+function readVarint(bytes: Uint8Array, at: { offset: number }): number {
+  let value = 0;
+  let scale = 1;
+  let byte: number;
+  do {
+    byte = bytes[at.offset++] ?? 0;
+    value += (byte & 0x7f) * scale;
+    scale *= 128;
+  } while (byte & 0x80 && at.offset < bytes.length);
+  return value;
+}
+
+function chunkHeader(type: number, length: number): Uint8Array {
+  const header = new Uint8Array(CHUNK_HEADER);
+  header[0] = type;
+  new DataView(header.buffer).setUint32(1, length, true);
+  return header;
+}
+
+export interface SessionRecorderOptions {
+  path: string;
+  wadPath: string;
+  cells?: boolean; // Also record the cell stream (default: false)
+}
+
+export interface SessionRecorder {
+  /** Record the frame shown at this game tic (only with a cell stream) */
+  frame: (tic: number, grid: CellGrid) => void;
+  /** Write the demo and the seek index, and close the file */
+  finish: (demo: Uint8Array | null) => void;
+}
+
+/**
+ * Start writing a session recording
+ * Frames go straight to the file (diffs are usually a few hundred bytes);
+ * the demo stays in the engine until finish().
+ */
+export function createSessionRecorder(options: SessionRecorderOptions): SessionRecorder {
+  const cells = options.cells ?? false;
+  const fd = openSync(options.path, "w");
+  const encoder = createWireEncoder();
+  const keyframes: [number, number][] = []; // [tic, offset]
+  let offset = 0;
+  let lastTic = -1;
+  let lastKeyTic = -Infinity;
+  let finished = false;
+
+  function write(bytes: Uint8Array): void {
+    writeSync(fd, bytes);
+    offset += bytes.length;
+  }
+
+  function writeChunk(type: number, ...parts: Uint8Array[]): void {
+    const length = parts.reduce((sum, part) => sum + part.length, 0);
+    write(chunkHeader(type, length));
+    for (const part of parts) write(part);
+  }
+
+  write(MAGIC);
+  const info: RecordingInfo = {
+    version: RECORDING_VERSION,
+    wad: basename(options.wadPath),
+    date: new Date().toISOString(),
+    cells,
+  };
+  writeChunk(CHUNK_INFO, new TextEncoder().encode(JSON.stringify(info)));
+
+  return {
+    frame(tic: number, grid: CellGrid): void {
+      if (!cells || finished || tic === lastTic) return;
+      lastTic = tic;
+
+      // Keyframes start the palette over, so decoding can begin at any of them
+      const key = tic - lastKeyTic >= KEYFRAME_TICS;
+      if (key) encoder.reset();
+      const message = encoder.encode(grid);
+      if (!message) return;
+      if (message[0] === WIRE_KEYFRAME) {
+        keyframes.push([tic, offset]);
+        lastKeyTic = tic;
+      }
+
+      const prefix: number[] = [];
+      varint(prefix, tic);
+      writeChunk(CHUNK_FRAME, Uint8Array.from(prefix), message);
+    },
+
+    finish(demo: Uint8Array | null): void {
+      if (finished) return;
+      finished = true;
+
+      const demoOffset = demo ? offset : 0;
+      if (demo) writeChunk(CHUNK_DEMO, demo);
+
+      const index: number[] = [];
+      varint(index, demoOffset);
+      varint(index, keyframes.length);
+      let prevTic = 0;
+      let prevOffset = 0;
+      for (const [tic, at] of keyframes) {
+        varint(index, tic - prevTic);
+        varint(index, at - prevOffset);
+        prevTic = tic;
+        prevOffset = at;
+      }
+      const indexOffset = offset;
+      writeChunk(CHUNK_INDEX, Uint8Array.from(index));
+
+      const trailer = new Uint8Array(TRAILER);
+      new DataView(trailer.buffer).setUint32(0, indexOffset, true);
+      trailer.set(MAGIC, 4);
+      write(trailer);
+      closeSync(fd);
+    },
+  };
+}
+
+export interface SessionRecording {
+  info: RecordingInfo;
+  demo: Uint8Array | null;
+  /** Game tics of the first and last recorded frames (-1 without cells) */
+  firstTic: number;
+  lastTic: number;
+  /**
+   * Bring the grid to what was shown at game tic `to`, calling onFrame for
+   * every recorded frame from `from` on. Continues from the previous call
+   * when that is closer than the nearest keyframe (same grid), so playing a
+   * recording forward decodes each frame once. Returns the tic drawn, -1 if
+   * none is recorded by then.
+   */
+  play: (grid: CellGrid, from: number, to: number, onFrame?: (tic: number) => void) => number;
+  /** Draw the frame shown at a game tic; returns the tic of that frame */
+  seek: (grid: CellGrid, tic: number) => number;
+}
+
+/**
+ * Read a session recording (the whole file is loaded, they are small)
+ */
+export function readSessionRecording(path: string): SessionRecording {
+  const bytes = new Uint8Array(readFileSync(path));
+  const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+  if (bytes.length < MAGIC.length || !MAGIC.every((b, i) => bytes[i] === b)) {
+    throw new Error(`${path} is not a session recording`);
+  }
+
+  const chunkAt = (offset: number): [number, Uint8Array] | null => {
+    if (offset + CHUNK_HEADER > bytes.length) return null;
+    const length = view.getUint32(offset + 1, true);
+    const start = offset + CHUNK_HEADER;
+    if (start + length > bytes.length) return null; // Cut short
+    return [bytes[offset]!, bytes.subarray(start, start + length)];
+  };
+  const frameTic = (payload: Uint8Array) => readVarint(payload, { offset: 0 });
+
+  let info: RecordingInfo = { version: 0, wad: "", date: "", cells: false };
+  const first = chunkAt(MAGIC.length);
+  if (first && first[0] === CHUNK_INFO) {
+    info = JSON.parse(new TextDecoder().decode(first[1]));
+  }
+
+  // Keyframe index and demo: from the trailer, or by scanning every chunk
+  let demo: Uint8Array | null = null;
+  const keyframes: [number, number][] = [];
+  let lastFrame = -1;
+  const trailerAt = bytes.length - TRAILER;
+  const indexChunk =
+    trailerAt > 0 && MAGIC.every((b, i) => bytes[trailerAt + 4 + i] === b)
+      ? chunkAt(view.getUint32(trailerAt, true))
+      : null;
+
+  if (indexChunk && indexChunk[0] === CHUNK_INDEX) {
+    const at = { offset: 0 };
+    const demoOffset = readVarint(indexChunk[1], at);
+    const count = readVarint(indexChunk[1], at);
+    let tic = 0;
+    let offset = 0;
+    for (let i = 0; i < count; i++) {
+      tic += readVarint(indexChunk[1], at);
+      offset += readVarint(indexChunk[1], at);
+      keyframes.push([tic, offset]);
+    }
+    const demoChunk = demoOffset ? chunkAt(demoOffset) : null;
+    if (demoChunk && demoChunk[0] === CHUNK_DEMO) demo = demoChunk[1];
+  } else {
+    for (let offset = MAGIC.length, chunk; (chunk = chunkAt(offset)); ) {
+      const [type, payload] = chunk;
+      if (type === CHUNK_DEMO) demo = payload;
+      if (type === CHUNK_FRAME) {
+        const at = { offset: 0 };
+        const tic = readVarint(payload, at);
+        if (payload[at.offset] === WIRE_KEYFRAME) keyframes.push([tic, offset]);
+        lastFrame = offset;
+      }
+      offset += CHUNK_HEADER + payload.length;
+    }
+  }
+
+  // The last frame is found by walking from the last keyframe
+  let lastTic = -1;
+  if (keyframes.length > 0) {
+    for (let offset = keyframes[keyframes.length - 1]![1], chunk; (chunk = chunkAt(offset)); ) {
+      if (chunk[0] !== CHUNK_FRAME) break;
+      lastFrame = offset;
+      offset += CHUNK_HEADER + chunk[1].length;
+    }
+    lastTic = frameTic(chunkAt(lastFrame)![1]);
+  }
+
+  const decoder = createWireDecoder();
+
+  // Where the last play() stopped: the next chunk, and the tic drawn so far
+  let cursorGrid: CellGrid | null = null;
+  let cursorOffset = 0;
+  let cursorTic = -1;
+
+  function play(grid: CellGrid, from: number, to: number, onFrame?: (tic: number) => void): number {
+    // Last keyframe at or before `from` (binary search, tics only grow)
+    from = Math.min(from, to);
+    let lo = 0;
+    let hi = keyframes.length - 1;
+    while (lo < hi) {
+      const mid = (lo + hi + 1) >> 1;
+      if (keyframes[mid]![0] <= from) lo = mid;
+      else hi = mid - 1;
+    }
+    const start = keyframes[lo];
+    if (!start || start[0] > to) return -1;
+
+    let offset = start[1];
+    let shown = -1;
+    if (grid === cursorGrid && cursorTic <= to && cursorTic < from && cursorOffset > offset) {
+      offset = cursorOffset;
+      shown = cursorTic;
+    }
+
+    for (let chunk; (chunk = chunkAt(offset)); ) {
+      const [type, payload] = chunk;
+      if (type !== CHUNK_FRAME) break;
+      const at = { offset: 0 };
+      const tic = readVarint(payload, at);
+      if (tic > to) break;
+
+      const message = payload.subarray(at.offset);
+      decoder.apply(message[0]!, message.subarray(WIRE_HEADER), grid);
+      offset += CHUNK_HEADER + payload.length;
+      shown = tic;
+      if (tic >= from) onFrame?.(tic);
+    }
+
+    cursorGrid = grid;
+    cursorOffset = offset;
+    cursorTic = shown;
+    return shown;
+  }
+
+  return {
+    info,
+    demo,
+    firstTic: keyframes[0]?.[0] ?? -1,
+    lastTic,
+    play,
+    seek: (grid: CellGrid, tic: number) => play(grid, tic, tic),
+  };
+}
+
+/**
+ * Read a demo lump from the host filesystem
+ * Like DOOM's -playdemo, the ".lmp" extension may be left out.
+ */
+export function readDemoFile(path: string): Uint8Array {
+  const file = !existsSync(path) && existsSync(`${path}.lmp`) ? `${path}.lmp` : path;
+  return new Uint8Array(readFileSync(file));
+}
+
+/**
+ * Write a demo lump to the host filesystem as NAME.lmp, like DOOM's -record
+ * Returns the path written.
+ */
+export function writeDemoFile(name: string, demo: Uint8Array): string {
+  const file = name.endsWith(".lmp") ? name : `${name}.lmp`;
+  writeFileSync(file, demo);
+  return file;
+}
+
+export interface ReplayOptions {
+  wadPath: string;
+  demo: Uint8Array;
+  speed?: number; // Multiple of real time; 0 runs as fast as possible (default: 1)
+  wasmModule?: WebAssembly.Module;
+  onTic?: (engine: DoomEngine, tic: number) => void;
+}
+
+export interface ReplayResult {
+  tics: number;
+  ms: number;
+}
+
+/**
+ * Re-run a recorded demo in a headless engine until it ends
+ * The engine runs on a virtual clock, so one tick is exactly one game tic
+ * and the replay takes the same course at any speed.
+ */
+export async function replayDemo(options: ReplayOptions): Promise<ReplayResult> {
+  const speed = options.speed ?? 1;
+  let ended = false;
+
+  const engine = new DoomEngine({
+    wadPath: options.wadPath,
+    wasmModule: options.wasmModule,
+    audio: false,
+    saves: false,
+    playDemo: options.demo,
+    virtualClock: true,
+    print: () => {},
+    onQuit: () => (ended = true),
+  });
+  await engine.init();
+
+  const started = performance.now();
+  let tics = 0;
+  // Frames are only drawn when someone looks at them
+  const runTics = (count: number) => {
+    const onTic = options.onTic;
+    if (!onTic) {
+      tics += engine.runTics(count);
+      return;
+    }
+    for (let i = 0; i < count && !ended; i++) {
+      tics += engine.runTics(1, true);
+      onTic(engine, engine.getGameTic());
+    }
+  };
+
+  if (speed <= 0) {
+    while (!ended) runTics(TICRATE);
+  } else {
+    await new Promise<void>((resolveReplay) => {
+      let due = 0;
+      const timer = setInterval(() => {
+        due += speed;
+        const count = Math.floor(due);
+        due -= count;
+        if (count > 0 && !ended) runTics(count);
+        if (ended) {
+          clearInterval(timer);
+          resolveReplay();
+        }
+      }, TICK_MS);
+    });
+  }
+
+  return { tics, ms: performance.now() - started };
+}
+
+/**
+ * Show the recorded cell stream in the terminal
+ * Starts at game tic `from` and plays at `speed` times real time; q or
+ * Ctrl+C stops.
+ */
+export function viewRecording(
+  recording: SessionRecording,
+  options: { from?: number; speed?: number } = {}
+): Promise<void> {
+  const { stdin, stdout } = process;
+  const speed = options.speed && options.speed > 0 ? options.speed : 1;
+  const grid = createCellGrid(0, 0);
+  const encoder = createAnsiEncoder();
+  let shown = Math.max(options.from ?? recording.firstTic, recording.firstTic);
+  let position = shown;
+
+  stdout.write(ANSI_SESSION_START);
+  if (stdin.isTTY) stdin.setRawMode(true);
+  stdin.resume();
+  recording.seek(grid, shown);
+  stdout.write(encoder.encode(grid));
+
+  return new Promise((resolveView) => {
+    const stop = () => {
+      clearInterval(timer);
+      stdin.off("data", onData);
+      stdout.write(ANSI_SESSION_END);
+      if (stdin.isTTY) stdin.setRawMode(false);
+      stdin.pause();
+      resolveView();
+    };
+    const onData = (data: Buffer) => {
+      if (data.includes(0x71) || data.includes(0x03)) stop(); // q, Ctrl+C
+    };
+    stdin.on("data", onData);
+
+    const timer = setInterval(() => {
+      position = Math.min(recording.lastTic, position + speed);
+      const target = Math.floor(position);
+      if (target > shown) {
+        recording.play(grid, shown + 1, target);
+        stdout.write(encoder.encode(grid));
+        shown = target;
+      }
+      if (shown >= recording.lastTic) stop();
+    }, TICK_MS);
+  });
+}
+
+export interface TimeDemoOptions {
+  wadPath: string;
+  demo: Uint8Array;
+  wasmModule?: WebAssembly.Module;
+  buildDir?: string; // E.g. a profiling build (default: doom/build)
+}
+
+export interface TimeDemoResult {
+  gametics: number;
+  realtics: number; // As measured by DOOM (1/35 s)
+  fps: number; // DOOM's own result: gametics per real second
+  ms: number; // Wall time of the whole run
+  tickMs: { mean: number; p50: number; p95: number; max: number }; // Per game tic
+}
+
+/**
+ * Run a demo as a DOOM timedemo in a headless engine
+ * Every tic is simulated and rendered into the framebuffer as fast as
+ * possible (nothing is drawn to the terminal), so the result measures the
+ * engine alone. DOOM's own figures come from the engine once it ends.
+ */
+export async function timeDemo(options: TimeDemoOptions): Promise<TimeDemoResult> {
+  let ended = false;
+
+  const engine = new DoomEngine({
+    wadPath: options.wadPath,
+    wasmModule: options.wasmModule,
+    buildDir: options.buildDir,
+    audio: false,
+    saves: false,
+    playDemo: options.demo,
+    timeDemo: true,
+    print: () => {},
+    printErr: (text: string) => {
+      if (text.trim()) console.error("[DOOM]", text);
+    },
+    onQuit: () => (ended = true),
+  });
+  await engine.init();
+
+  const tickMs: number[] = [];
+  const started = performance.now();
+  while (!ended) {
+    const before = performance.now();
+    engine.tick();
+    tickMs.push(performance.now() - before);
+  }
+  const ms = performance.now() - started;
+
+  const timed = engine.getTimeDemoResult();
+  if (!timed) {
+    throw new Error("The timedemo ended without a result (wrong WAD for this demo?)");
+  }
+  const { gametics, realtics } = timed;
+
+  tickMs.sort((a, b) => a - b);
+  const percentile = (p: number) =>
+    tickMs[Math.min(tickMs.length - 1, Math.floor(tickMs.length * p))] ?? 0;
+  return {
+    gametics,
+    realtics,
+    fps: (gametics * TICRATE) / Math.max(1, realtics),
+    ms,
+    tickMs: {
+      mean: tickMs.reduce((sum, t) => sum + t, 0) / Math.max(1, tickMs.length),
+      p50: percentile(0.5),
+      p95: percentile(0.95),
+      max: tickMs[tickMs.length - 1] ?? 0,
+    },
+  };
+}
+
+/**
+ * Format a timedemo result for the terminal
+ */
+export function formatTimeDemo(name: string, result: TimeDemoResult): string {
+  const { mean, p50, p95, max } = result.tickMs;
+  return [
+    `Timedemo ${name}: ${result.gametics} gametics in ${result.realtics} realtics`,
+    `  ${result.fps.toFixed(1)} fps, ${(result.ms / 1000).toFixed(2)} s wall`,
+    `  per tic: mean ${mean.toFixed(2)} ms, p50 ${p50.toFixed(2)} ms, ` +
+      `p95 ${p95.toFixed(2)} ms, max ${max.toFixed(2)} ms`,
+  ].join("\n");
+}
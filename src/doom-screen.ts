@@ -0,0 +1,72 @@
+/**
+ * DOOM Screen Presenter
+ *
+ * Copies a cell grid into an OpenTUI framebuffer, touching only the cells
+ * that changed since the previous frame.
+ */
+
+import { RGBA, type OptimizedBuffer } from "@opentui/core";
+import { createCellGrid, resizeCellGrid, type CellGrid } from "./doom-cells";
+import { glyph } from "./doom-glyphs";
+
+export interface ScreenPresenter {
+  /** Copy changed cells of the grid into the framebuffer */
+  present: (grid: CellGrid, fb: OptimizedBuffer) => void;
+  /** Force every cell to be copied next time (e.g. after a resize) */
+  invalidate: () => void;
+  /** Cells copied by the last present */
+  readonly changedCells: number;
+}
+
+function toRGBA(color: number): RGBA {
+  return RGBA.fromInts((color >> 16) & 0xff, (color >> 8) & 0xff, color & 0xff);
+}
+
+/**
+ * Create a presenter that remembers what it last wrote to the framebuffer
+ */
+export function createScreenPresenter(): ScreenPresenter {
+  const shown = createCellGrid(0, 0);
+  let valid = false;
+  let changedCells = 0;
+
+  return {
+    get changedCells(): number {
+      return changedCells;
+    },
+
+    present(grid: CellGrid, fb: OptimizedBuffer): void {
+      const width = Math.min(grid.width, fb.width);
+      const height = Math.min(grid.height, fb.height);
+
+      if (shown.width !== grid.width || shown.height !== grid.height) {
+        resizeCellGrid(shown, grid.width, grid.height);
+        valid = false;
+      }
+
+      changedCells = 0;
+      for (let y = 0; y < height; y++) {
+        let cell = y * grid.width;
+        for (let x = 0; x < width; x++, cell++) {
+          const ch = grid.chars[cell] ?? 0x20;
+          const fg = grid.fg[cell] ?? 0;
+          const bg = grid.bg[cell] ?? 0;
+          if (valid && shown.chars[cell] === ch && shown.fg[cell] === fg && shown.bg[cell] === bg) {
+            continue;
+          }
+          shown.chars[cell] = ch;
+          shown.fg[cell] = fg;
+          shown.bg[cell] = bg;
+          changedCells++;
+          fb.setCell(x, y, glyph(ch), toRGBA(fg), toRGBA(bg));
+        }
+      }
+
+      valid = true;
+    },
+
+    invalidate(): void {
+      valid = false;
+    },
+  };
+}
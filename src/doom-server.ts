@@ -0,0 +1,429 @@
+/**
+ * DOOM Session Server
+ *
+ * Serves DOOM to many terminals from one process. Each client that connects
+ * to the Unix or TCP socket gets its own game: a fresh instance of the WASM
+ * module (compiled once for the whole server), driven by the keystrokes it
+ * sends back. Frames go out in one of two protocols:
+ *
+ * ansi: escape-sequence cell diffs for any raw terminal, e.g.
+ *       socat -,raw,echo=0 UNIX-CONNECT:/tmp/doom.sock
+ * thin: the binary cell-diff protocol (doom-wire.ts) for the thin client
+ *       (doom-client.ts), which also reports its terminal size
+ */
+
+import { createServer, type Socket } from "net";
+import { existsSync, unlinkSync } from "fs";
+import { compileDoomModule, DoomEngine, loadSharedWad } from "./doom-engine";
+import { createCellGrid, resizeCellGrid, type CellGrid } from "./doom-cells";
+import { createFrameComposer, type FrameComposer } from "./doom-frame";
+import { ANSI_SESSION_END, ANSI_SESSION_START, createAnsiEncoder } from "./doom-ansi";
+import { createBroadcaster, type Broadcaster } from "./doom-broadcast";
+import {
+  createDoomInputHandler,
+  createKeyReleaseScheduler,
+  parseTerminalInput,
+  type DoomKeyInput,
+  type KeyReleaseScheduler,
+} from "./doom-input";
+import {
+  createWireEncoder,
+  createWireReader,
+  parseSocketAddress,
+  readWireResize,
+  removeStaleSocket,
+  WIRE_INPUT,
+  WIRE_MAX_INPUT,
+  WIRE_RESIZE,
+} from "./doom-wire";
+import {
+  createEngineMetrics,
+  createMetricsRegistry,
+  PHASE_COMPOSE,
+  PHASE_ENCODE,
+  serveMetrics,
+  type EngineMetrics,
+  type MetricsRegistry,
+} from "./doom-metrics";
+import { defaultKeyBindings, type KeyBindings } from "./doom-bindings";
+import { debugLog } from "./debug";
+
+export type SessionProtocol = "ansi" | "thin";
+
+export interface DoomServerOptions {
+  listen: string; // Unix socket path or host:port
+  protocol?: SessionProtocol; // Frame encoding sent to clients (default: ansi)
+  wadPath: string;
+  cols?: number; // Session screen size in cells (default: 120x40)
+  rows?: number;
+  vectorAutomap?: boolean; // Draw the automap as braille lines (default: true)
+  textHud?: boolean; // Draw the status bar as a text strip (default: true)
+  flashStrip?: boolean; // Palette flashes as one tinted row, not a recoloured screen
+  bindings?: KeyBindings; // Key bindings for every session (default: built-in ones)
+  broadcast?: string; // Let spectators watch session N on the socket <broadcast>.N
+  metrics?: string; // Serve Prometheus metrics for every session on this Unix socket
+  warmEngines?: number; // Engines of closed sessions kept to reset for new ones (default: 2)
+}
+
+interface Session {
+  id: number;
+  socket: Socket;
+  engine: DoomEngine;
+  grid: CellGrid;
+  composer: FrameComposer;
+  codec: SessionCodec;
+  broadcaster: Broadcaster | null;
+  metrics: EngineMetrics | null;
+  onKey: ((key: DoomKeyInput) => void) | null;
+  releases: KeyReleaseScheduler | null;
+  ready: boolean;
+  closed: boolean;
+  failed: boolean; // The engine threw; it is not reused
+  ticking: boolean; // Inside engine.tick(); pooled only once it returns
+  blocked: boolean; // Socket buffer is full; frames are dropped until it drains
+  wasmBytes: number;
+  rssBytes: number; // Process RSS growth while this session started
+}
+
+/**
+ * How frames go out and input comes in for one connection
+ */
+interface SessionCodec {
+  start: string | Uint8Array;
+  end: string | Uint8Array;
+  /** Encode what changed since the last frame; null if nothing did */
+  encode: (grid: CellGrid) => string | Uint8Array | null;
+  /** The client missed frames: send everything next time */
+  reset: () => void;
+  /** Feed bytes received from the client; throws if they break the protocol */
+  read: (data: Buffer) => void;
+  /** Cells that changed in the last encoded frame */
+  changedCells: () => number;
+}
+
+interface SessionInput {
+  onKey: (key: DoomKeyInput) => void;
+  onResize: (cols: number, rows: number) => void;
+}
+
+function createAnsiCodec(input: SessionInput): SessionCodec {
+  const encoder = createAnsiEncoder();
+  return {
+    start: ANSI_SESSION_START,
+    end: ANSI_SESSION_END,
+    encode(grid: CellGrid): string | null {
+      const frame = encoder.encode(grid);
+      return frame.length > 0 ? frame : null;
+    },
+    reset: () => encoder.reset(),
+    read(data: Buffer): void {
+      for (const key of parseTerminalInput(data.toString("latin1"))) input.onKey(key);
+    },
+    changedCells: () => encoder.changedCells,
+  };
+}
+
+function createThinCodec(input: SessionInput): SessionCodec {
+  const encoder = createWireEncoder();
+  const reader = createWireReader((type, payload) => {
+    if (type === WIRE_INPUT) {
+      const text = Buffer.from(payload.buffer, payload.byteOffset, payload.length);
+      for (const key of parseTerminalInput(text.toString("latin1"))) input.onKey(key);
+    } else if (type === WIRE_RESIZE) {
+      const [cols, rows] = readWireResize(payload);
+      input.onResize(cols, rows);
+    }
+  }, WIRE_MAX_INPUT);
+  return {
+    start: new Uint8Array(0), // The thin client sets up its own terminal
+    end: new Uint8Array(0),
+    encode: (grid: CellGrid) => encoder.encode(grid),
+    reset: () => encoder.reset(),
+    read: (data: Buffer) => reader(data),
+    changedCells: () => encoder.changedCells,
+  };
+}
+
+// DOOM's native framerate
+const TICK_MS = 1000 / 35;
+
+// Limits for the screen size a thin client may ask for
+const MIN_COLS = 20;
+const MAX_COLS = 400;
+const MIN_ROWS = 10;
+const MAX_ROWS = 200;
+
+function formatMB(bytes: number): string {
+  return `${(bytes / (1024 * 1024)).toFixed(1)} MB`;
+}
+
+// Bytes an encoded frame puts on the socket (byteLength scans, it does not copy)
+function frameBytes(frame: string | Uint8Array | null): number {
+  if (!frame) return 0;
+  return typeof frame === "string" ? Buffer.byteLength(frame) : frame.length;
+}
+
+/**
+ * Run the session server until SIGINT/SIGTERM
+ */
+export async function runServer(options: DoomServerOptions): Promise<void> {
+  const {
+    listen,
+    protocol = "ansi",
+    cols = 120,
+    rows = 40,
+    vectorAutomap = true,
+    textHud = true,
+    flashStrip = false,
+    broadcast,
+    warmEngines = 2,
+    bindings = defaultKeyBindings(),
+  } = options;
+  const registry: MetricsRegistry | null = options.metrics ? createMetricsRegistry() : null;
+
+  // Everything sessions can share is loaded once: compiled code and WAD bytes
+  // (instances read lumps from the shared WAD instead of keeping their own copy)
+  const [wasmModule, sharedWad] = await Promise.all([
+    compileDoomModule(),
+    loadSharedWad(options.wadPath),
+  ]);
+
+  const sessions = new Set<Session>();
+  let nextId = 1;
+  // Engines whose sessions ended: a warm reset starts the next session in
+  // them without loading and instantiating the module again
+  const idleEngines: DoomEngine[] = [];
+
+  function report(event: string, session: Session): void {
+    let wasmTotal = 0;
+    for (const s of sessions) wasmTotal += s.wasmBytes;
+    console.log(
+      `[server] session ${session.id} ${event}: wasm ${formatMB(session.wasmBytes)}, ` +
+        `rss +${formatMB(session.rssBytes)} | ${sessions.size} active, ` +
+        `wasm ${formatMB(wasmTotal)}, rss ${formatMB(process.memoryUsage().rss)}`
+    );
+  }
+
+  function poolEngine(session: Session): void {
+    if (!session.failed && idleEngines.length < warmEngines) {
+      idleEngines.push(session.engine);
+    }
+  }
+
+  function closeSession(session: Session): void {
+    if (session.closed) return;
+    session.closed = true;
+    const wasActive = sessions.delete(session);
+    if (wasActive) report("closed", session);
+    if (session.metrics) registry?.remove(session.metrics);
+    session.broadcaster?.close();
+    // Reset when reused, not now. onQuit closes the session from inside the
+    // module: the ticker pools it if tick() then returns cleanly
+    if (wasActive && !session.ticking) poolEngine(session);
+    if (!session.socket.destroyed) {
+      session.socket.end(session.codec.end);
+    }
+  }
+
+  async function openSession(socket: Socket): Promise<void> {
+    const id = nextId++;
+    const rssBefore = process.memoryUsage().rss;
+
+    const input: SessionInput = {
+      onKey: (key) => session.onKey?.(key),
+      onResize(newCols: number, newRows: number): void {
+        const width = Math.min(MAX_COLS, Math.max(MIN_COLS, newCols));
+        const height = Math.min(MAX_ROWS, Math.max(MIN_ROWS, newRows));
+        resizeCellGrid(session.grid, width, height);
+        session.composer.invalidate();
+        session.codec.reset();
+      },
+    };
+
+    const metrics = registry
+      ? createEngineMetrics(
+          { session: String(id) },
+          { wasmBytes: () => session.engine.getWasmMemoryBytes() }
+        )
+      : null;
+
+    const engineOptions = {
+      print: (text: string) => debugLog(`Session ${id}`, text),
+      printErr: (text: string) => debugLog(`Session ${id}`, text),
+      onQuit: () => closeSession(session),
+    };
+    const idleEngine = idleEngines.pop();
+
+    const session: Session = {
+      id,
+      socket,
+      engine:
+        idleEngine ??
+        new DoomEngine({
+          wadPath: options.wadPath,
+          sharedWad,
+          wasmModule,
+          audio: false,
+          saves: false,
+          bindings,
+          metrics: metrics ?? undefined,
+          ...engineOptions,
+        }),
+      grid: createCellGrid(cols, rows),
+      composer: createFrameComposer({ vectorAutomap, textHud, flashStrip }),
+      codec: protocol === "thin" ? createThinCodec(input) : createAnsiCodec(input),
+      broadcaster: null,
+      metrics,
+      onKey: null,
+      releases: null,
+      ready: false,
+      closed: false,
+      failed: false,
+      ticking: false,
+      blocked: false,
+      wasmBytes: 0,
+      rssBytes: 0,
+    };
+
+    socket.on("data", (data: Buffer) => {
+      try {
+        session.codec.read(data);
+      } catch (e) {
+        debugLog(`Session ${id}`, `dropping the client: ${e}`);
+        socket.destroy();
+      }
+    });
+    socket.on("drain", () => {
+      session.blocked = false;
+      session.codec.reset(); // Dropped frames left the client behind
+    });
+    socket.on("close", () => closeSession(session));
+    socket.on("error", (e) => debugLog(`Session ${id}`, `socket error: ${e}`));
+
+    socket.write(session.codec.start);
+
+    try {
+      if (idleEngine) {
+        await idleEngine.reset({ ...engineOptions, metrics });
+      } else {
+        await session.engine.init();
+      }
+    } catch (e) {
+      console.error(`[server] session ${id} failed to start: ${e}`);
+      session.failed = true;
+      closeSession(session);
+      return;
+    }
+    if (session.closed) {
+      // Gone while starting: the engine can still serve the next one
+      if (idleEngines.length < warmEngines) idleEngines.push(session.engine);
+      return;
+    }
+
+    if (textHud) session.engine.setTextHud(true);
+    if (flashStrip) session.engine.setSteadyPalette(true);
+    session.releases = createKeyReleaseScheduler(session.engine);
+    session.onKey = createDoomInputHandler({
+      engine: session.engine,
+      releases: session.releases,
+      bindings,
+      onExit: () => closeSession(session),
+    });
+    session.wasmBytes = session.engine.getWasmMemoryBytes();
+    session.rssBytes = Math.max(0, process.memoryUsage().rss - rssBefore);
+    if (broadcast) {
+      session.broadcaster = createBroadcaster(`${broadcast}.${id}`);
+    }
+    session.ready = true;
+    sessions.add(session);
+    if (metrics) registry?.add(metrics);
+    report(idleEngine ? "started (warm)" : "started", session);
+  }
+
+  // One clock ticks every session, so they all stay at 35 Hz together
+  const ticker = setInterval(() => {
+    for (const session of sessions) {
+      if (!session.ready || session.closed) continue;
+      session.ticking = true;
+      try {
+        session.engine.tick();
+      } catch (e) {
+        // exit() inside the module (quit, I_Error) unwinds as an exception
+        debugLog(`Session ${session.id}`, `tick stopped: ${e}`);
+        session.ticking = false;
+        session.failed = true;
+        const pooled = idleEngines.indexOf(session.engine);
+        if (pooled >= 0) idleEngines.splice(pooled, 1);
+        closeSession(session);
+        continue;
+      }
+      session.ticking = false;
+      if (session.closed) {
+        poolEngine(session);
+        continue;
+      }
+      session.releases?.advance();
+      if (session.closed || (session.blocked && !session.broadcaster)) continue;
+
+      const metrics = session.metrics;
+      const composeStart = metrics ? performance.now() : 0;
+      session.composer.compose(session.engine, session.grid);
+      if (metrics) metrics.phase(PHASE_COMPOSE, performance.now() - composeStart);
+      session.broadcaster?.publish(session.grid);
+      if (session.blocked) continue;
+
+      const encodeStart = metrics ? performance.now() : 0;
+      const frame = session.codec.encode(session.grid);
+      if (metrics) {
+        const now = performance.now();
+        metrics.phase(PHASE_ENCODE, now - encodeStart);
+        metrics.frame(now, frameBytes(frame), session.codec.changedCells());
+      }
+      if (frame && !session.socket.write(frame)) {
+        session.blocked = true;
+      }
+    }
+  }, TICK_MS);
+
+  const address = parseSocketAddress(listen);
+  if ("path" in address) removeStaleSocket(address.path);
+
+  const server = createServer((socket) => {
+    openSession(socket).catch((e) => console.error(`[server] session error: ${e}`));
+  });
+
+  await new Promise<void>((resolveListen, rejectListen) => {
+    server.once("error", rejectListen);
+    if ("path" in address) {
+      server.listen(address.path, () => resolveListen());
+    } else {
+      server.listen(address.port, address.host, () => resolveListen());
+    }
+  });
+  console.log(
+    `[server] DOOM listening on ${listen} (${protocol}, ${cols}x${rows} cells per session)`
+  );
+  if (broadcast) {
+    console.log(`[server] spectators can watch session N on ${broadcast}.N`);
+  }
+  const metricsServer = registry ? serveMetrics(options.metrics!, registry) : null;
+  if (metricsServer) {
+    console.log(`[server] Prometheus metrics on ${options.metrics}`);
+  }
+
+  // Serve until asked to stop
+  await new Promise<void>((resolveStop) => {
+    process.once("SIGINT", () => resolveStop());
+    process.once("SIGTERM", () => resolveStop());
+  });
+
+  clearInterval(ticker);
+  for (const session of [...sessions]) {
+    closeSession(session);
+  }
+  server.close();
+  metricsServer?.close();
+  if ("path" in address && existsSync(address.path)) {
+    unlinkSync(address.path);
+  }
+}
@@ -0,0 +1,82 @@
+/**
+ * DOOM Vectorized Environment Worker
+ *
+ * Hosts a contiguous range of environments for doom-vecenv.ts. After its
+ * engines are up the worker never returns to its event loop: it sleeps on
+ * the step generation, runs every engine for the step, copies observations
+ * and game variables into the shared batch and counts itself off the
+ * barrier.
+ */
+
+import { DoomEngine, STEP_VARS_SIZE } from "./doom-engine";
+import {
+  CTRL_COMMAND,
+  CTRL_ERROR,
+  CTRL_GENERATION,
+  CTRL_REMAINING,
+  CTRL_TICS,
+  VECENV_CLOSE,
+  type VecEnvWorkerMessage,
+  type VecEnvWorkerRequest,
+} from "./doom-vecenv";
+
+declare var self: Worker;
+
+self.onmessage = async (event: MessageEvent<VecEnvWorkerRequest>) => {
+  const request = event.data;
+  const { control, actions, observations, gamevars } = request.buffers;
+
+  const engines: DoomEngine[] = [];
+  try {
+    for (let i = 0; i < request.count; i++) {
+      const engine = new DoomEngine({
+        wadPath: request.wadPath,
+        sharedWad: request.sharedWad,
+        wasmModule: request.wasmModule,
+        audio: false,
+        saves: false,
+        virtualClock: true,
+        observation: { shrink: request.shrink, gray: request.gray },
+        args: request.args,
+        print: () => {},
+        printErr: (text: string) => console.error(`[env ${request.first + i}]`, text),
+      });
+      await engine.init();
+      engines.push(engine);
+    }
+  } catch (e) {
+    postMessage({ type: "error", message: `${e}` } satisfies VecEnvWorkerMessage);
+    return;
+  }
+  // Taken before reporting ready: the first step may start right after
+  let generation = Atomics.load(control, CTRL_GENERATION);
+  postMessage({ type: "ready" } satisfies VecEnvWorkerMessage);
+
+  // Let the ready message go out before blocking this thread for good
+  await Bun.sleep(0);
+
+  for (;;) {
+    Atomics.wait(control, CTRL_GENERATION, generation);
+    const next = Atomics.load(control, CTRL_GENERATION);
+    if (next === generation) continue;
+    generation = next;
+    if (Atomics.load(control, CTRL_COMMAND) === VECENV_CLOSE) break;
+
+    const tics = Atomics.load(control, CTRL_TICS);
+    for (let i = 0; i < engines.length; i++) {
+      const env = request.first + i;
+      try {
+        const result = engines[i]!.step(Atomics.load(actions, env), tics);
+        observations.set(result.frame, env * result.frame.length);
+        gamevars.set(result.gamevars, env * STEP_VARS_SIZE);
+      } catch (e) {
+        console.error(`[env ${env}]`, e);
+        Atomics.compareExchange(control, CTRL_ERROR, 0, env + 1);
+      }
+    }
+
+    if (Atomics.sub(control, CTRL_REMAINING, 1) === 1) {
+      Atomics.notify(control, CTRL_REMAINING);
+    }
+  }
+};
@@ -0,0 +1,207 @@
+/**
+ * DOOM Vectorized Environments
+ *
+ * Runs many independent headless engines for automated play, spread over
+ * a pool of workers (several engines per worker, see doom-vecenv-worker.ts).
+ * All environments step in lockstep: the caller writes one packed action
+ * per environment, and a single Atomics barrier releases every worker and
+ * waits for the last one to finish. Observations and game variables land
+ * in one shared batched buffer, laid out environment by environment.
+ *
+ * Every engine runs on its own virtual clock, so simulation is as fast as
+ * the CPU allows rather than 35 tics per second.
+ */
+
+import { availableParallelism } from "os";
+import {
+  compileDoomModule,
+  loadSharedWad,
+  NATIVE_HEIGHT,
+  NATIVE_WIDTH,
+  STEP_VARS_SIZE,
+} from "./doom-engine";
+
+// Control block (Int32Array) indices
+export const CTRL_GENERATION = 0; // Bumped by the caller to start a step
+export const CTRL_REMAINING = 1; // Workers still busy with the current step
+export const CTRL_COMMAND = 2;
+export const CTRL_TICS = 3;
+export const CTRL_ERROR = 4; // 1 + index of the first environment whose engine failed
+const CTRL_SIZE = 8;
+
+export const VECENV_STEP = 1;
+export const VECENV_CLOSE = 2;
+
+export interface VecEnvBuffers {
+  control: Int32Array;
+  actions: Int32Array; // One packed DoomAction mask per environment
+  observations: Uint8Array; // envs * observationSize
+  gamevars: Int32Array; // envs * STEP_VARS_SIZE, indexed by StepVar
+}
+
+export interface VecEnvWorkerRequest {
+  wadPath: string;
+  sharedWad: Uint8Array;
+  wasmModule: WebAssembly.Module;
+  first: number; // First environment this worker runs
+  count: number;
+  shrink: number;
+  gray: boolean;
+  args: string[];
+  buffers: VecEnvBuffers;
+}
+
+export type VecEnvWorkerMessage = { type: "ready" } | { type: "error"; message: string };
+
+export interface VecEnvOptions {
+  wadPath: string;
+  envs: number;
+  workers?: number; // Default: one per core, at most one per environment
+  observation?: { shrink?: number; gray?: boolean }; // As for DoomEngine (default: shrink 2)
+  args?: string[]; // DOOM arguments for every engine (default: warp to E1M1)
+}
+
+export interface VecEnv extends VecEnvBuffers {
+  envs: number;
+  workers: number;
+  width: number;
+  height: number;
+  channels: number;
+  observationSize: number; // Bytes per environment in observations
+  /**
+   * Run `tics` game tics in every environment with the current actions.
+   * Throws a VecEnvError naming the first environment whose engine failed
+   * during this step; each failure is reported by the step it happened in.
+   */
+  step: (tics?: number) => void;
+  /** Observation of one environment (a view into the batch) */
+  observation: (env: number) => Uint8Array;
+  close: () => void;
+}
+
+/**
+ * An environment's engine failed during step(); `env` is its index
+ */
+export class VecEnvError extends Error {
+  env: number;
+
+  constructor(env: number) {
+    super(`VecEnv environment ${env} failed (see worker output)`);
+    this.name = "VecEnvError";
+    this.env = env;
+  }
+}
+
+function sharedInt32(length: number): Int32Array {
+  return new Int32Array(new SharedArrayBuffer(length * 4));
+}
+
+/**
+ * Start the workers and their engines
+ * Resolves once every engine has initialized.
+ */
+export async function createVecEnv(options: VecEnvOptions): Promise<VecEnv> {
+  const envs = Math.max(1, options.envs);
+  const workers = Math.min(envs, Math.max(1, options.workers ?? availableParallelism()));
+  const shrink = Math.max(1, options.observation?.shrink ?? 2);
+  const gray = options.observation?.gray ?? false;
+  const width = Math.floor(NATIVE_WIDTH / shrink);
+  const height = Math.floor(NATIVE_HEIGHT / shrink);
+  const channels = gray ? 1 : 3;
+  const observationSize = width * height * channels;
+
+  const buffers: VecEnvBuffers = {
+    control: sharedInt32(CTRL_SIZE),
+    actions: sharedInt32(envs),
+    observations: new Uint8Array(new SharedArrayBuffer(envs * observationSize)),
+    gamevars: sharedInt32(envs * STEP_VARS_SIZE),
+  };
+  const { control } = buffers;
+
+  const [sharedWad, wasmModule] = await Promise.all([
+    loadSharedWad(options.wadPath),
+    compileDoomModule(),
+  ]);
+
+  // Contiguous ranges of environments, as even as possible
+  const pool: Worker[] = [];
+  const ready: Promise<void>[] = [];
+  for (let w = 0; w < workers; w++) {
+    const first = Math.floor((w * envs) / workers);
+    const count = Math.floor(((w + 1) * envs) / workers) - first;
+    const worker = new Worker(new URL("./doom-vecenv-worker.ts", import.meta.url).href);
+    pool.push(worker);
+    ready.push(
+      new Promise((resolveReady, rejectReady) => {
+        worker.onmessage = (event: MessageEvent<VecEnvWorkerMessage>) => {
+          if (event.data.type === "ready") resolveReady();
+          else rejectReady(new Error(event.data.message));
+        };
+        worker.onerror = (event) => rejectReady(new Error(event.message));
+      })
+    );
+    worker.postMessage({
+      wadPath: options.wadPath,
+      sharedWad,
+      wasmModule,
+      first,
+      count,
+      shrink,
+      gray,
+      args: options.args ?? ["-warp", "1", "1", "-skill", "3"],
+      buffers,
+    } satisfies VecEnvWorkerRequest);
+  }
+
+  try {
+    await Promise.all(ready);
+  } catch (e) {
+    for (const worker of pool) worker.terminate();
+    throw e;
+  }
+
+  // Release every worker, then wait until the last one is done
+  function release(command: number, tics: number): void {
+    Atomics.store(control, CTRL_COMMAND, command);
+    Atomics.store(control, CTRL_TICS, tics);
+    Atomics.store(control, CTRL_REMAINING, workers);
+    Atomics.add(control, CTRL_GENERATION, 1);
+    Atomics.notify(control, CTRL_GENERATION);
+  }
+
+  let closed = false;
+
+  return {
+    ...buffers,
+    envs,
+    workers,
+    width,
+    height,
+    channels,
+    observationSize,
+
+    step(tics: number = 1): void {
+      if (closed) throw new Error("VecEnv is closed");
+      release(VECENV_STEP, Math.max(1, tics));
+      for (;;) {
+        const remaining = Atomics.load(control, CTRL_REMAINING);
+        if (remaining === 0) break;
+        Atomics.wait(control, CTRL_REMAINING, remaining);
+      }
+      // Cleared once reported, so it is not reported again for later steps
+      const failed = Atomics.exchange(control, CTRL_ERROR, 0);
+      if (failed) throw new VecEnvError(failed - 1);
+    },
+
+    observation(env: number): Uint8Array {
+      return buffers.observations.subarray(env * observationSize, (env + 1) * observationSize);
+    },
+
+    close(): void {
+      if (closed) return;
+      closed = true;
+      release(VECENV_CLOSE, 0);
+      for (const worker of pool) worker.terminate();
+    },
+  };
+}
@@ -0,0 +1,466 @@
+/**
+ * DOOM Thin-Client Wire Protocol
+ *
+ * A compact binary cell-diff stream for remote terminals that only draw:
+ * the server composes frames and sends what changed, the client applies
+ * it to its own grid and forwards keystrokes.
+ *
+ * Messages: u8 type, u32 payload length (little endian), payload.
+ *   KEYFRAME (server): u8 flags, varint width, varint height, ops
+ *   DIFF     (server): ops against the previous frame
+ *   INPUT    (client): raw terminal input bytes
+ *   RESIZE   (client): varint cols, varint rows
+ *
+ * Ops (one byte: op << 6 | count, count 0 means a varint count follows):
+ *   SKIP n       leave n cells as they are
+ *   LITERAL n    n cells follow
+ *   REPEAT n     one cell follows, repeated n times
+ *   COLOR        varint index, r, g, b: define a palette entry
+ * A cell is varint glyph (0 = half block, else code point + 1), varint fg
+ * index, varint bg index. Colors are palette indexed: each 24-bit color
+ * is sent once per connection and then referenced by a small index.
+ */
+
+import { lstatSync, unlinkSync, type Stats } from "fs";
+import { createCellGrid, HALF_BLOCK, resizeCellGrid, type CellGrid } from "./doom-cells";
+
+export const WIRE_KEYFRAME = 1;
+export const WIRE_DIFF = 2;
+export const WIRE_INPUT = 3;
+export const WIRE_RESIZE = 4;
+
+// Message header: type byte, then payload length (u32 LE)
+export const WIRE_HEADER = 5;
+
+// Largest payload a reader accepts by default: a keyframe of the biggest
+// screen with a full palette is well under this
+export const WIRE_MAX_MESSAGE = 16 * 1024 * 1024;
+// Largest INPUT or RESIZE payload: one read of the client's terminal
+export const WIRE_MAX_INPUT = 64 * 1024;
+
+const OP_SKIP = 0;
+const OP_LITERAL = 1;
+const OP_REPEAT = 2;
+const OP_COLOR = 3;
+const OP_COUNT_MAX = 63;
+
+// Keyframe flag: the palette starts over
+const FLAG_PALETTE_RESET = 1;
+
+// Palette entries before the encoder starts over with a keyframe
+const PALETTE_MAX = 4096;
+
+// Identical cells needed before a REPEAT beats a LITERAL
+const REPEAT_MIN = 3;
+
+/**
+ * Growable byte buffer with varint support
+ */
+class ByteWriter {
+  bytes = new Uint8Array(4096);
+  length = 0;
+
+  private reserve(extra: number): void {
+    if (this.length + extra <= this.bytes.length) return;
+    let size = this.bytes.length * 2;
+    while (size < this.length + extra) size *= 2;
+    const grown = new Uint8Array(size);
+    grown.set(this.bytes.subarray(0, this.length));
+    this.bytes = grown;
+  }
+
+  byte(value: number): void {
+    this.reserve(1);
+    this.bytes[this.length++] = value;
+  }
+
+  varint(value: number): void {
+    this.reserve(5);
+    while (value >= 0x80) {
+      this.bytes[this.length++] = (value & 0x7f) | 0x80;
+      value >>>= 7;
+    }
+    this.bytes[this.length++] = value;
+  }
+
+  op(op: number, count: number): void {
+    if (count > 0 && count <= OP_COUNT_MAX) {
+      this.byte((op << 6) | count);
+    } else {
+      this.byte(op << 6);
+      this.varint(count);
+    }
+  }
+}
+
+/**
+ * Cursor over a payload with varint support
+ */
+class ByteReader {
+  private bytes: Uint8Array;
+  offset = 0;
+
+  constructor(bytes: Uint8Array) {
+    this.bytes = bytes;
+  }
+
+  get done(): boolean {
+    return this.offset >= this.bytes.length;
+  }
+
+  byte(): number {
+    return this.bytes[this.offset++] ?? 0;
+  }
+
+  varint(): number {
+    let value = 0;
+    let scale = 1;
+    let byte: number;
+    do {
+      byte = this.byte();
+      value += (byte & 0x7f) * scale;
+      scale *= 128;
+    } while (byte & 0x80 && !this.done);
+    return value;
+  }
+}
+
+/**
+ * Wrap a payload as a wire message
+ */
+export function wireMessage(type: number, payload: Uint8Array): Uint8Array {
+  const message = new Uint8Array(WIRE_HEADER + payload.length);
+  message[0] = type;
+  new DataView(message.buffer).setUint32(1, payload.length, true);
+  message.set(payload, WIRE_HEADER);
+  return message;
+}
+
+/**
+ * RESIZE message for a terminal of the given size
+ */
+export function wireResize(cols: number, rows: number): Uint8Array {
+  const writer = new ByteWriter();
+  writer.varint(cols);
+  writer.varint(rows);
+  return wireMessage(WIRE_RESIZE, writer.bytes.subarray(0, writer.length));
+}
+
+/**
+ * Read the terminal size from a RESIZE payload
+ */
+export function readWireResize(payload: Uint8Array): [number, number] {
+  const reader = new ByteReader(payload);
+  const cols = reader.varint();
+  return [cols, reader.varint()];
+}
+
+/**
+ * Split a byte stream into messages, calling onMessage for each complete one
+ * The payload is only valid during the call. Throws (and forgets what it
+ * had) when a message announces more than maxLength bytes: the peer is
+ * broken or hostile, and the caller should drop the connection.
+ */
+export function createWireReader(
+  onMessage: (type: number, payload: Uint8Array) => void,
+  maxLength: number = WIRE_MAX_MESSAGE
+): (chunk: Uint8Array) => void {
+  // Bytes of an incomplete message, grown by doubling so a large message
+  // arriving in many chunks is copied a bounded number of times
+  let pending = new Uint8Array(0);
+  let used = 0;
+
+  const keep = (bytes: Uint8Array) => {
+    if (used + bytes.length > pending.length) {
+      const grown = new Uint8Array(Math.max(pending.length * 2, used + bytes.length));
+      grown.set(pending.subarray(0, used));
+      pending = grown;
+    }
+    pending.set(bytes, used);
+    used += bytes.length;
+  };
+
+  return (chunk: Uint8Array) => {
+    // Messages that arrive whole are read straight from the chunk
+    let data = chunk;
+    if (used > 0) {
+      keep(chunk);
+      data = pending.subarray(0, used);
+    }
+
+    const view = new DataView(data.buffer, data.byteOffset, data.byteLength);
+    let offset = 0;
+    while (data.length - offset >= WIRE_HEADER) {
+      const length = view.getUint32(offset + 1, true);
+      if (length > maxLength) {
+        used = 0;
+        throw new Error(`Wire message of ${length} bytes, over the ${maxLength} byte limit`);
+      }
+      if (data.length - offset < WIRE_HEADER + length) break;
+      const start = offset + WIRE_HEADER;
+      onMessage(data[offset]!, data.subarray(start, start + length));
+      offset = start + length;
+    }
+
+    if (data === chunk) {
+      keep(chunk.subarray(offset));
+    } else {
+      pending.copyWithin(0, offset, used);
+      used -= offset;
+    }
+  };
+}
+
+/**
+ * Parse "host:port" (TCP) or anything else as a Unix socket path
+ * Shared by the server and the thin client.
+ */
+export function parseSocketAddress(
+  address: string
+): { path: string } | { host: string; port: number } {
+  const match = /^([\w.-]*):(\d+)$/.exec(address);
+  if (match) {
+    return { host: match[1] || "127.0.0.1", port: parseInt(match[2]!, 10) };
+  }
+  return { path: address };
+}
+
+/**
+ * Remove the socket a previous run left at path, before listening there
+ * Throws if something other than a socket is there, so a mistyped path
+ * (a WAD, a save) is never deleted.
+ */
+export function removeStaleSocket(path: string): void {
+  let stats: Stats;
+  try {
+    stats = lstatSync(path);
+  } catch (_e) {
+    return; // Nothing there
+  }
+  if (!stats.isSocket()) {
+    throw new Error(`${path} exists and is not a socket; not replacing it`);
+  }
+  unlinkSync(path);
+}
+
+// Whether cells a and b of the grid look the same
+function sameCell(grid: CellGrid, a: number, b: number): boolean {
+  return grid.chars[a] === grid.chars[b] && grid.fg[a] === grid.fg[b] && grid.bg[a] === grid.bg[b];
+}
+
+// Whether cell i of the grid differs from what the client shows
+function cellChanged(grid: CellGrid, shown: CellGrid, i: number): boolean {
+  return (
+    grid.chars[i] !== shown.chars[i] || grid.fg[i] !== shown.fg[i] || grid.bg[i] !== shown.bg[i]
+  );
+}
+
+export interface WireEncoder {
+  /** Encode the frame as a KEYFRAME or DIFF message; null if nothing changed */
+  encode: (grid: CellGrid, full?: boolean) => Uint8Array | null;
+  /** Forget what the client shows, so the next frame is a keyframe */
+  reset: () => void;
+  /** Cells written by the last encode */
+  readonly changedCells: number;
+}
+
+/**
+ * Create a server-side encoder for one client connection
+ */
+export function createWireEncoder(): WireEncoder {
+  const shown = createCellGrid(0, 0);
+  const palette = new Map<number, number>();
+  const writer = new ByteWriter();
+  let valid = false;
+  let changedCells = 0;
+  // Color indexes of a literal run (fg, bg per cell), kept between frames
+  let runIndexes = new Uint32Array(0);
+
+  function writeCell(ch: number, fgIndex: number, bgIndex: number): void {
+    writer.varint(ch === HALF_BLOCK ? 0 : ch + 1);
+    writer.varint(fgIndex);
+    writer.varint(bgIndex);
+  }
+
+  function colorIndex(color: number): number {
+    let index = palette.get(color);
+    if (index === undefined) {
+      index = palette.size;
+      palette.set(color, index);
+      writer.byte(OP_COLOR << 6);
+      writer.varint(index);
+      writer.byte((color >> 16) & 0xff);
+      writer.byte((color >> 8) & 0xff);
+      writer.byte(color & 0xff);
+    }
+    return index;
+  }
+
+  return {
+    get changedCells(): number {
+      return changedCells;
+    },
+
+    encode(grid: CellGrid, full: boolean = false): Uint8Array | null {
+      if (shown.width !== grid.width || shown.height !== grid.height) {
+        resizeCellGrid(shown, grid.width, grid.height);
+        valid = false;
+      }
+      let key = !valid || full;
+      if (palette.size > PALETTE_MAX) {
+        key = true;
+      }
+
+      writer.length = 0;
+      if (key) {
+        const reset = palette.size > PALETTE_MAX || !valid;
+        if (reset) palette.clear();
+        writer.byte(reset ? FLAG_PALETTE_RESET : 0);
+        writer.varint(grid.width);
+        writer.varint(grid.height);
+      }
+      const headerLength = writer.length;
+
+      const { chars, fg, bg } = grid;
+      const cells = grid.width * grid.height;
+
+      let skipped = 0;
+      let i = 0;
+      changedCells = 0;
+      while (i < cells) {
+        if (!key && !cellChanged(grid, shown, i)) {
+          skipped++;
+          i++;
+          continue;
+        }
+        if (skipped > 0) {
+          writer.op(OP_SKIP, skipped);
+          skipped = 0;
+        }
+
+        // Run of identical changed cells; color definitions go before the
+        // op that uses them, so the run is indexed first
+        let end = i + 1;
+        while (end < cells && (key || cellChanged(grid, shown, end)) && sameCell(grid, end, i)) {
+          end++;
+        }
+        if (end - i >= REPEAT_MIN) {
+          const fgIndex = colorIndex(fg[i]!);
+          const bgIndex = colorIndex(bg[i]!);
+          writer.op(OP_REPEAT, end - i);
+          writeCell(chars[i]!, fgIndex, bgIndex);
+          changedCells += end - i;
+          i = end;
+          continue;
+        }
+
+        // Literal run up to the next unchanged cell or repeat
+        end = i + 1;
+        while (
+          end < cells &&
+          (key || cellChanged(grid, shown, end)) &&
+          !(
+            end + 2 < cells &&
+            sameCell(grid, end, end + 1) &&
+            sameCell(grid, end, end + 2) &&
+            (key || cellChanged(grid, shown, end + 2))
+          )
+        ) {
+          end++;
+        }
+        const run = end - i;
+        if (runIndexes.length < run * 2) runIndexes = new Uint32Array(cells * 2);
+        for (let j = 0; j < run; j++) {
+          runIndexes[j * 2] = colorIndex(fg[i + j]!);
+          runIndexes[j * 2 + 1] = colorIndex(bg[i + j]!);
+        }
+        writer.op(OP_LITERAL, run);
+        for (let j = 0; j < run; j++) {
+          writeCell(chars[i + j]!, runIndexes[j * 2]!, runIndexes[j * 2 + 1]!);
+        }
+        changedCells += run;
+        i = end;
+      }
+
+      shown.chars.set(chars.subarray(0, cells));
+      shown.fg.set(fg.subarray(0, cells));
+      shown.bg.set(bg.subarray(0, cells));
+      valid = true;
+
+      if (!key && writer.length === headerLength) return null;
+      return wireMessage(key ? WIRE_KEYFRAME : WIRE_DIFF, writer.bytes.subarray(0, writer.length));
+    },
+
+    reset(): void {
+      valid = false;
+    },
+  };
+}
+
+export interface WireDecoder {
+  /** Apply a KEYFRAME or DIFF payload to the grid */
+  apply: (type: number, payload: Uint8Array, grid: CellGrid) => void;
+}
+
+/**
+ * Create a client-side decoder (keeps the palette across frames)
+ */
+export function createWireDecoder(): WireDecoder {
+  let palette: number[] = [];
+
+  return {
+    apply(type: number, payload: Uint8Array, grid: CellGrid): void {
+      const reader = new ByteReader(payload);
+
+      if (type === WIRE_KEYFRAME) {
+        const flags = reader.byte();
+        if (flags & FLAG_PALETTE_RESET) palette = [];
+        const width = reader.varint();
+        const height = reader.varint();
+        resizeCellGrid(grid, width, height);
+      } else if (type !== WIRE_DIFF) {
+        return;
+      }
+
+      // After a keyframe's resize, which may replace the arrays
+      const { chars, fg, bg } = grid;
+      const cells = grid.width * grid.height;
+      let cell = 0;
+      while (!reader.done) {
+        const opByte = reader.byte();
+        const op = opByte >> 6;
+        if (op === OP_COLOR) {
+          const index = reader.varint();
+          const r = reader.byte();
+          const g = reader.byte();
+          const b = reader.byte();
+          palette[index] = (r << 16) | (g << 8) | b;
+          continue;
+        }
+
+        const count = opByte & OP_COUNT_MAX || reader.varint();
+        if (op === OP_SKIP) {
+          cell += count;
+        } else if (op === OP_REPEAT) {
+          const glyph = reader.varint();
+          const end = Math.min(cells, cell + count);
+          chars.fill(glyph === 0 ? HALF_BLOCK : glyph - 1, cell, end);
+          fg.fill(palette[reader.varint()] ?? 0, cell, end);
+          bg.fill(palette[reader.varint()] ?? 0, cell, end);
+          cell += count;
+        } else {
+          for (let n = 0; n < count; n++, cell++) {
+            const glyph = reader.varint();
+            const fgColor = palette[reader.varint()] ?? 0;
+            const bgColor = palette[reader.varint()] ?? 0;
+            if (cell < cells) {
+              chars[cell] = glyph === 0 ? HALF_BLOCK : glyph - 1;
+              fg[cell] = fgColor;
+              bg[cell] = bgColor;
+            }
+          }
+        }
+      }
+    },
+  };
+}
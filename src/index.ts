@@ -15,12 +15,58 @@ import {
   RGBA,
   TextAttributes,
 } from "@opentui/core";
-import { DoomEngine, DOOM_WIDTH, DOOM_HEIGHT } from "./doom-engine";
-import { createDoomInputHandler, getControlsHelp } from "./doom-input";
+import { DoomEngine, formatLevelTimings, LevelTiming } from "./doom-engine";
+import {
+  createDoomInputHandler,
+  createKeyReleaseScheduler,
+  getControlsHelp,
+  type KeyReleaseScheduler,
+} from "./doom-input";
 import { createDoomMouseHandler, type DoomMouseHandler } from "./doom-mouse";
-import { shutdownAudio } from "./doom-audio";
+import { createCellGrid, resizeCellGrid } from "./doom-cells";
+import { createFrameComposer } from "./doom-frame";
+import { createScreenPresenter } from "./doom-screen";
+import { runServer, type SessionProtocol } from "./doom-server";
+import { runThinClient } from "./doom-client";
+import { createBroadcaster, type Broadcaster } from "./doom-broadcast";
+import {
+  createSessionRecorder,
+  formatTimeDemo,
+  readDemoFile,
+  readSessionRecording,
+  replayDemo,
+  timeDemo,
+  viewRecording,
+  writeDemoFile,
+  type SessionRecorder,
+} from "./doom-record";
+import {
+  claimNetLink,
+  createNetBoard,
+  createNetClient,
+  createNetHost,
+  formatNetStats,
+  getNetStats,
+  netNow,
+  startNetBridge,
+  type NetBoard,
+  type NetEndpoint,
+} from "./doom-net";
+import { formatProfileTop, startStackProfiler, type StackProfiler } from "./doom-profile";
+import {
+  createEngineMetrics,
+  createMetricsRegistry,
+  PHASE_COMPOSE,
+  PHASE_PRESENT,
+  serveMetrics,
+  type MetricsServer,
+} from "./doom-metrics";
+import { getActiveVoices, setAudioOutput, shutdownAudio, type AudioOutput } from "./doom-audio";
+import { findPcmPlayer, type MusicDecoding } from "./doom-pcm";
+import { loadKeyBindings, type KeyBindings } from "./doom-bindings";
 import { debugLog } from "./debug";
 import { parseArgs } from "util";
+import { basename } from "path";
 
 // Parse command line arguments
 const { values } = parseArgs({
@@ -41,6 +87,107 @@ const { values } = parseArgs({
       short: "m",
       default: true,
     },
+    automap: {
+      type: "string",
+      default: "vector",
+    },
+    hud: {
+      type: "string",
+      default: "text",
+    },
+    flash: {
+      type: "string",
+      default: "full",
+    },
+    fps: {
+      type: "string",
+      default: "35",
+    },
+    bindings: {
+      type: "string",
+    },
+    audio: {
+      type: "string",
+      default: "mpv",
+    },
+    "music-decoder": {
+      type: "string",
+      default: "builtin",
+    },
+    serve: {
+      type: "string",
+    },
+    protocol: {
+      type: "string",
+      default: "ansi",
+    },
+    connect: {
+      type: "string",
+    },
+    broadcast: {
+      type: "string",
+    },
+    "net-host": {
+      type: "string",
+    },
+    "net-join": {
+      type: "string",
+    },
+    players: {
+      type: "string",
+      default: "2",
+    },
+    deathmatch: {
+      type: "boolean",
+      default: false,
+    },
+    cols: {
+      type: "string",
+      default: "120",
+    },
+    rows: {
+      type: "string",
+      default: "40",
+    },
+    "save-session": {
+      type: "string",
+    },
+    "session-cells": {
+      type: "boolean",
+      default: false,
+    },
+    replay: {
+      type: "string",
+    },
+    record: {
+      type: "string",
+    },
+    playdemo: {
+      type: "string",
+    },
+    timedemo: {
+      type: "string",
+    },
+    view: {
+      type: "boolean",
+      default: false,
+    },
+    speed: {
+      type: "string",
+      default: "1",
+    },
+    from: {
+      type: "string",
+    },
+    profile: {
+      type: "string",
+    },
+    "build-dir": {
+      type: "string",
+    },
+    metrics: {
+      type: "string",
+    },
   },
 });
 
@@ -51,18 +198,168 @@ DOOM for OpenTUI
 Usage: bun run dev -- --wad <path-to-wad-file>
 
 Options:
-  -w, --wad    Path to DOOM WAD file (default: doom1.wad)
-  -h, --help   Show this help message
+  -w, --wad       Path to DOOM WAD file (default: doom1.wad)
+  --automap MODE  Automap drawing: vector (braille lines) or raster (default: vector)
+  --hud MODE      Status bar: text (terminal text strip) or pixel (default: text)
+  --flash MODE    Damage/pickup flashes: full (recolor the view) or strip (one row) (default: full)
+  --fps N         Frames per second; above 35, frames between tics are interpolated (default: 35)
+  --bindings FILE Key bindings to use (default: ~/.opentui-doom/bindings.cfg if it exists)
+  --audio MODE    Sound output: mpv (a process per sound) or pcm (one in-process mix) (default: mpv)
+  --music-decoder D  With --audio pcm: builtin, or external (ffmpeg/mpg123) (default: builtin)
+  --serve ADDR    Serve a separate game to each client of a Unix socket (or host:port)
+  --protocol P    What --serve sends: ansi (any raw terminal) or thin (default: ansi)
+  --connect ADDR  Play on a --protocol thin server; DOOM runs there, not here
+  --cols, --rows  Screen size of each served session in cells (default: 120x40)
+  --broadcast PATH  Let spectators watch on a Unix socket (with --serve: PATH.N per session)
+  --net-host PATH   Host a multiplayer game on a Unix socket
+  --players N       Players to wait for before the hosted game starts (default: 2)
+  --deathmatch      Host a deathmatch instead of a cooperative game
+  --net-join PATH   Join a multiplayer game hosted on a Unix socket
+  --save-session FILE  Record this session (a new game) to FILE: inputs as a DOOM demo
+  --session-cells      Also record what the terminal showed, to watch it back with --view
+  --replay FILE     Re-run a recorded session headlessly and report how long it took
+  --view            With --replay: show the recorded screen instead (q to stop)
+  --speed N         Replay speed, a multiple of real time; 0 = as fast as possible (default: 1)
+  --from TIC        With --view: start at this game tic
+  --record NAME     Record a new game as a DOOM demo, written to NAME.lmp on exit
+  --playdemo FILE   Watch a DOOM demo (.lmp)
+  --timedemo FILE   Play a DOOM demo headlessly as fast as possible and report the timing
+  --profile FILE    Sample the game's stacks and write them to FILE as collapsed stacks
+  --build-dir DIR   Load doom.wasm from DIR, e.g. a DOOM_PROFILE=1 build (default: doom/build)
+  --metrics PATH    Serve Prometheus metrics on a Unix socket (with --serve: per session)
+  -h, --help      Show this help message
 
 ${getControlsHelp()}${values.mouse ? "\n  Mouse=Aim/Fire" : ""}
 `);
   process.exit(0);
 }
 
+// Options that pick one of a few modes: a typo is an error, not the other mode
+const CHOICES = {
+  automap: ["vector", "raster"],
+  hud: ["text", "pixel"],
+  flash: ["full", "strip"],
+  audio: ["mpv", "pcm"],
+  "music-decoder": ["builtin", "external"],
+  protocol: ["ansi", "thin"],
+} as const;
+for (const [name, choices] of Object.entries(CHOICES)) {
+  const value = values[name as keyof typeof CHOICES]!;
+  if (!(choices as readonly string[]).includes(value)) {
+    console.error(`--${name} must be ${choices.join(" or ")} (got ${value})`);
+    process.exit(1);
+  }
+}
+
+// Thin client: draw what a server renders, nothing runs locally
+if (values.connect) {
+  try {
+    await runThinClient(values.connect);
+  } catch (e) {
+    console.error(`Failed to connect to ${values.connect}: ${e}`);
+    process.exit(1);
+  }
+  process.exit(0);
+}
+
+// Replay a session recording: re-run its demo, or show its recorded screen
+if (values.replay) {
+  const speed = Number(values.speed);
+  if (!values.speed || !Number.isFinite(speed) || speed < 0) {
+    console.error(`--speed must be a number of times real time, 0 or more (got ${values.speed})`);
+    process.exit(1);
+  }
+  const recording = readSessionRecording(values.replay);
+
+  if (values.view) {
+    if (!recording.info.cells) {
+      console.error(`${values.replay} has no recorded screen (record with --session-cells)`);
+      process.exit(1);
+    }
+    const from = values.from ? parseInt(values.from, 10) : undefined;
+    await viewRecording(recording, { from, speed });
+    process.exit(0);
+  }
+
+  if (!recording.demo) {
+    console.error(`${values.replay} has no demo (the recording was cut short)`);
+    process.exit(1);
+  }
+  if (recording.info.wad && recording.info.wad !== basename(values.wad!)) {
+    console.warn(`Recorded with ${recording.info.wad}, replaying with ${values.wad}`);
+  }
+  const { tics, ms } = await replayDemo({ wadPath: values.wad!, demo: recording.demo, speed });
+  const rate = ms > 0 ? (tics * 1000) / ms : 0;
+  console.log(`Replayed ${tics} tics in ${(ms / 1000).toFixed(2)} s (${rate.toFixed(0)} tics/s)`);
+  process.exit(0);
+}
+
+// Timedemo: a reproducible, headless workload with a timing summary
+if (values.timedemo) {
+  try {
+    const demo = readDemoFile(values.timedemo);
+    const profiler = values.profile ? startStackProfiler(values["build-dir"]) : null;
+    const result = await timeDemo({ wadPath: values.wad!, demo, buildDir: values["build-dir"] });
+    console.log(formatTimeDemo(basename(values.timedemo), result));
+    if (profiler) {
+      const samples = profiler.write(values.profile!);
+      console.log(formatProfileTop(profiler, samples));
+      console.log(`Collapsed stacks written to ${values.profile}`);
+    }
+  } catch (e) {
+    console.error(`Timedemo failed: ${e}`);
+    process.exit(1);
+  }
+  process.exit(0);
+}
+
+// Key bindings, loaded once for the game (or every served session)
+let bindings: KeyBindings;
+try {
+  bindings = loadKeyBindings(values.bindings);
+} catch (e) {
+  console.error(`Key bindings: ${e instanceof Error ? e.message : e}`);
+  process.exit(1);
+}
+
+// Before the engine starts its audio
+if (values.audio === "pcm" && !findPcmPlayer()) {
+  console.error("--audio pcm: no raw PCM player found (pacat or aplay), using mpv per sound");
+}
+setAudioOutput(values.audio as AudioOutput, values["music-decoder"] as MusicDecoding);
+
+// Server mode: no local terminal, one game per socket connection
+if (values.serve) {
+  try {
+    await runServer({
+      listen: values.serve,
+      protocol: values.protocol as SessionProtocol,
+      wadPath: values.wad!,
+      cols: parseInt(values.cols!, 10) || 120,
+      rows: parseInt(values.rows!, 10) || 40,
+      vectorAutomap: values.automap === "vector",
+      textHud: values.hud === "text",
+      flashStrip: values.flash === "strip",
+      bindings,
+      broadcast: values.broadcast,
+      metrics: values.metrics,
+    });
+  } catch (e) {
+    console.error(`Server failed: ${e instanceof Error ? e.message : e}`);
+    process.exit(1);
+  }
+  process.exit(0);
+}
+
+// Above DOOM's 35 tics a second, frames between tics are interpolated
+const TIC_MS = 1000 / 35;
+const FPS = Math.max(35, parseInt(values.fps!, 10) || 35);
+const UNCAPPED = FPS > 35;
+
 // Initialize renderer
 const renderer = await createCliRenderer({
   exitOnCtrlC: false, // We handle exit manually to cleanup audio
-  targetFps: 35, // DOOM's native framerate
+  targetFps: FPS, // DOOM's native framerate unless --fps asks for more
 });
 
 // Handle graceful shutdown
@@ -83,6 +380,39 @@ const cleanup = (signal?: string) => {
     }
   }
 
+  // The demo recorded so far, copied once for --record and the session recording
+  const demo = doomEngine?.getDemo() ?? null;
+
+  // Write the demo recorded with --record to the host filesystem
+  if (values.record && demo) {
+    const file = writeDemoFile(values.record, demo);
+    process.on("exit", () => console.log(`Demo recorded to ${file}`));
+  }
+
+  // Close the session recording with the demo recorded so far
+  if (recorder) {
+    try {
+      recorder.finish(demo);
+      debugLog("Exit", "session recording written");
+    } catch (e) {
+      debugLog("Exit", `failed to write session recording: ${e}`);
+    }
+    recorder = null;
+  }
+
+  // Write the sampled stacks for a flamegraph
+  if (profiler) {
+    try {
+      const samples = profiler.write(values.profile!);
+      const summary = formatProfileTop(profiler, samples);
+      const file = values.profile;
+      process.on("exit", () => console.log(`${summary}\nCollapsed stacks written to ${file}`));
+    } catch (e) {
+      debugLog("Exit", `failed to write profile: ${e}`);
+    }
+    profiler = null;
+  }
+
   // Clear the frame callback to stop DOOM from ticking
   try {
     renderer.setFrameCallback(null as any);
@@ -94,6 +424,16 @@ const cleanup = (signal?: string) => {
   shutdownAudio();
   debugLog("Exit", "shutdownAudio completed");
 
+  broadcaster?.close();
+  metricsServer?.close();
+
+  // Report what the netgame transport carried
+  if (netBoard) {
+    const stats = formatNetStats(getNetStats(netBoard), netNow() - netStarted);
+    debugLog("Net", stats);
+    process.on("exit", () => console.log(stats));
+  }
+
   try {
     renderer.stop();
     debugLog("Exit", "renderer.stop completed");
@@ -135,18 +475,104 @@ let doomEngine: DoomEngine | null = null;
 let framebufferRenderable: FrameBufferRenderable | null = null;
 let isExiting = false; // Flag to stop the game loop when exiting
 let lastSaveSyncTime = 0; // Track when we last synced saves
+let levelLoads = 0; // Level loads already logged
 const SAVE_SYNC_INTERVAL = 5000; // Sync saves every 5 seconds
+let lastTicAt = 0; // When the last tick ran (uncapped rendering)
 let mouseHandler: DoomMouseHandler | null = null;
+let keyReleases: KeyReleaseScheduler | null = null;
+const composer = createFrameComposer({
+  vectorAutomap: values.automap === "vector",
+  textHud: values.hud === "text",
+  flashStrip: values.flash === "strip",
+});
+const presenter = createScreenPresenter();
+const grid = createCellGrid(0, 0);
+let broadcaster: Broadcaster | null = null;
+let netBoard: NetBoard | null = null;
+let netStarted = 0;
+let recorder: SessionRecorder | null = null;
+let profiler: StackProfiler | null = null;
+const metrics = values.metrics
+  ? createEngineMetrics(
+      { session: "local" },
+      { wasmBytes: () => doomEngine?.getWasmMemoryBytes() ?? 0, voices: getActiveVoices }
+    )
+  : null;
+let metricsServer: MetricsServer | null = null;
+
+/**
+ * Set up the netgame transport for --net-host / --net-join
+ * The socket bridge runs in a worker, since engine init blocks until everyone joined.
+ */
+async function startNet(): Promise<NetEndpoint | undefined> {
+  const hostPath = values["net-host"];
+  const joinPath = values["net-join"];
+  netStarted = netNow();
+
+  if (hostPath) {
+    const players = Math.max(1, parseInt(values.players!, 10) || 2);
+    netBoard = createNetBoard();
+    await startNetBridge("listen", hostPath, netBoard);
+    loadingText.content = `Waiting for ${players - 1} more player(s) on ${hostPath}...`;
+    return createNetHost(netBoard, { players, deathmatch: values.deathmatch });
+  }
+
+  if (joinPath) {
+    netBoard = createNetBoard(1);
+    const slot = claimNetLink(netBoard);
+    await startNetBridge("connect", joinPath, netBoard);
+    loadingText.content = `Joined ${joinPath}, waiting for the game to start...`;
+    return createNetClient(netBoard, slot);
+  }
+
+  return undefined;
+}
 
 async function initDoom() {
   try {
     loadingText.content = `Loading DOOM from: ${values.wad}`;
 
+    if (values.broadcast) broadcaster = createBroadcaster(values.broadcast);
+    if (metrics) {
+      const registry = createMetricsRegistry();
+      registry.add(metrics);
+      metricsServer = serveMetrics(values.metrics!, registry);
+    }
+    const net = await startNet();
+    // Let the status text render before init blocks waiting for other players
+    if (net) await Bun.sleep(100);
+
+    const sessionPath = values["save-session"];
     doomEngine = new DoomEngine({
       wadPath: values.wad!,
+      net,
+      recordDemo: !!sessionPath || !!values.record,
+      playDemo: values.playdemo ? readDemoFile(values.playdemo) : undefined,
+      buildDir: values["build-dir"],
+      metrics: metrics ?? undefined,
+      bindings,
       onQuit: cleanup,
     });
     await doomEngine.init();
+    if (values.profile) {
+      profiler = startStackProfiler(values["build-dir"]);
+    }
+    if (sessionPath) {
+      recorder = createSessionRecorder({
+        path: sessionPath,
+        wadPath: values.wad!,
+        cells: values["session-cells"],
+      });
+    }
+    if (values.hud === "text") {
+      doomEngine.setTextHud(true);
+    }
+    if (values.flash === "strip") {
+      doomEngine.setSteadyPalette(true);
+    }
+    if (UNCAPPED) {
+      doomEngine.setUncapped(true);
+    }
 
     // Remove loading text
     container.remove("loading");
@@ -180,8 +606,11 @@ async function initDoom() {
     renderer.root.add(controlsText);
 
     // Set up input handler
+    keyReleases = createKeyReleaseScheduler(doomEngine);
     const inputHandler = createDoomInputHandler({
       engine: doomEngine,
+      releases: keyReleases,
+      bindings,
       onExit: cleanup,
     });
     renderer.keyInput.on("keypress", inputHandler);
@@ -190,6 +619,7 @@ async function initDoom() {
     if (values.mouse) {
       mouseHandler = createDoomMouseHandler({
         engine: doomEngine,
+        releases: keyReleases,
         sensitivity: 2, // Adjust for terminal cell size
       });
 
@@ -247,8 +677,24 @@ async function gameLoop(_deltaMs: number) {
 
   if (!doomEngine || !framebufferRenderable) return;
 
-  // Run DOOM tick
-  doomEngine.tick();
+  // Run DOOM tick; uncapped, frames before the next tic is due draw the
+  // view between tics instead. With no view to draw (a menu, the automap,
+  // a wipe) the last frame stays up until the tic is due.
+  const fraction = (performance.now() - lastTicAt) / TIC_MS;
+  if (!UNCAPPED || fraction >= 1) {
+    doomEngine.tick();
+    lastTicAt = performance.now();
+    keyReleases?.advance();
+  } else if (!doomEngine.renderBetweenTics(fraction)) {
+    return;
+  }
+
+  // Log where the time went each time a level loads
+  const levelTimings = doomEngine.getLevelTimings();
+  if (levelTimings && levelTimings[LevelTiming.LOADS] !== levelLoads) {
+    levelLoads = levelTimings[LevelTiming.LOADS]!;
+    debugLog("Level", formatLevelTimings(levelTimings));
+  }
 
   // Periodic save sync (every 5 seconds)
   const now = Date.now();
@@ -257,46 +703,29 @@ async function gameLoop(_deltaMs: number) {
     lastSaveSyncTime = now;
   }
 
-  // Get framebuffer from DOOM
-  const pixels = doomEngine.getFrameBuffer();
+  // Compose the frame as cells, then copy what changed into the framebuffer
   const fb = framebufferRenderable.frameBuffer;
-
-  // With half-block rendering, each terminal cell represents 2 vertical pixels
-  // So we need to scale DOOM to (fb.width * 1) x (fb.height * 2) source pixels
-  const scaleX = DOOM_WIDTH / fb.width;
-  const scaleY = DOOM_HEIGHT / (fb.height * 2); // *2 because each cell = 2 vertical pixels
-
-  // Render to OpenTUI framebuffer using half-block characters
-  // The upper half-block character (▀) uses foreground for top pixel, background for bottom
-  for (let y = 0; y < fb.height; y++) {
-    const srcY1 = Math.floor(y * 2 * scaleY); // Top pixel row
-    const srcY2 = Math.floor((y * 2 + 1) * scaleY); // Bottom pixel row
-
-    for (let x = 0; x < fb.width; x++) {
-      const srcX = Math.floor(x * scaleX);
-
-      // Top pixel (foreground)
-      const srcIdx1 = (srcY1 * DOOM_WIDTH + srcX) * 4;
-      const r1 = pixels[srcIdx1] ?? 0;
-      const g1 = pixels[srcIdx1 + 1] ?? 0;
-      const b1 = pixels[srcIdx1 + 2] ?? 0;
-
-      // Bottom pixel (background)
-      const srcIdx2 = (srcY2 * DOOM_WIDTH + srcX) * 4;
-      const r2 = pixels[srcIdx2] ?? 0;
-      const g2 = pixels[srcIdx2 + 1] ?? 0;
-      const b2 = pixels[srcIdx2 + 2] ?? 0;
-
-      // Use upper half-block: ▀ (foreground = top, background = bottom)
-      fb.setCell(x, y, "▀", RGBA.fromInts(r1, g1, b1), RGBA.fromInts(r2, g2, b2));
-    }
+  resizeCellGrid(grid, fb.width, fb.height);
+  const composeStart = metrics ? performance.now() : 0;
+  composer.compose(doomEngine, grid);
+  const presentStart = metrics ? performance.now() : 0;
+  presenter.present(grid, fb);
+  if (metrics) {
+    const now = performance.now();
+    metrics.phase(PHASE_COMPOSE, presentStart - composeStart);
+    metrics.phase(PHASE_PRESENT, now - presentStart);
+    metrics.frame(now, 0, presenter.changedCells);
   }
+  broadcaster?.publish(grid);
+  recorder?.frame(doomEngine.getGameTic(), grid);
 }
 
 // Handle resize
 renderer.on("resize", (width, height) => {
   if (framebufferRenderable) {
     framebufferRenderable.frameBuffer.resize(width, height);
+    composer.invalidate();
+    presenter.invalidate();
   }
 });
 